@@ -0,0 +1,152 @@
+// Host microbenchmarks for the code that runs on every wake. Built by the
+// bench PlatformIO environment against the native simulation's stand-ins.
+#include "bench.hpp"
+#include "sim.hpp"
+#include <Arduino.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+HeapCounters heapCounters;
+volatile int benchSink;
+
+// glibc's allocator behind a counting front end
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void __libc_free(void* pointer);
+
+static void countAllocation(void* pointer) {
+    if (pointer == nullptr) return;
+    const size_t size = malloc_usable_size(pointer);
+    heapCounters.allocations++;
+    heapCounters.bytesAllocated += size;
+    heapCounters.liveBytes += size;
+    if (heapCounters.liveBytes > heapCounters.peakBytes) heapCounters.peakBytes = heapCounters.liveBytes;
+}
+
+static void countRelease(void* pointer) {
+    if (pointer != nullptr) heapCounters.liveBytes -= malloc_usable_size(pointer);
+}
+
+extern "C" void* malloc(size_t size) {
+    void* pointer = __libc_malloc(size);
+    countAllocation(pointer);
+    return pointer;
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    void* pointer = __libc_calloc(count, size);
+    countAllocation(pointer);
+    return pointer;
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    const size_t previous = pointer != nullptr ? malloc_usable_size(pointer) : 0;
+    void* resized = __libc_realloc(pointer, size);
+    if (resized == nullptr && size > 0) return nullptr;  // The old block is untouched
+    heapCounters.liveBytes -= previous;
+    countAllocation(resized);
+    return resized;
+}
+
+extern "C" void free(void* pointer) {
+    countRelease(pointer);
+    __libc_free(pointer);
+}
+
+static uint64_t monotonicNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+BenchRunner::BenchRunner(FILE* out, const char* label, const char* filter, uint32_t minTimeMs)
+    : out(out), label(label), filter(filter), minTimeMs(minTimeMs) {}
+
+void BenchRunner::run(const BenchCase& benchCase) {
+    if (filter != nullptr && strstr(benchCase.name, filter) == nullptr) return;
+
+    static const int MIN_BATCHES = 3;
+    uint64_t elapsedNs = 0;
+    uint64_t ops = 0;
+    uint64_t allocations = 0;
+    uint64_t bytesAllocated = 0;
+    uint64_t outputBytes = 0;
+    size_t peakBytes = 0;
+
+    // Untimed warm-up, so one-off setup like loading the time zone is not counted
+    benchCase.reset();
+    benchCase.batch();
+
+    for (int batches = 0; batches < MIN_BATCHES || elapsedNs < minTimeMs * 1000000ULL; batches++) {
+        benchCase.reset();
+
+        const HeapCounters before = heapCounters;
+        heapCounters.peakBytes = heapCounters.liveBytes;
+        const uint64_t start = monotonicNs();
+        outputBytes += benchCase.batch();
+        elapsedNs += monotonicNs() - start;
+
+        allocations += heapCounters.allocations - before.allocations;
+        bytesAllocated += heapCounters.bytesAllocated - before.bytesAllocated;
+        if (heapCounters.peakBytes - before.liveBytes > peakBytes) peakBytes = heapCounters.peakBytes - before.liveBytes;
+        ops += benchCase.opsPerBatch;
+    }
+
+    fprintf(out, "{\"bench\":\"%s\",\"label\":\"%s\",\"params\":{", benchCase.name, label);
+    for (size_t i = 0; i < benchCase.params.size(); i++) {
+        fprintf(out, "%s\"%s\":%d", i > 0 ? "," : "", benchCase.params[i].key, benchCase.params[i].value);
+    }
+    fprintf(out, "},\"ops\":%llu,\"ns_per_op\":%.1f,\"allocs_per_op\":%.3f,\"bytes_allocated_per_op\":%.1f,"
+                 "\"peak_heap_bytes\":%zu,\"output_bytes_per_op\":%.1f}\n",
+            static_cast<unsigned long long>(ops), static_cast<double>(elapsedNs) / ops,
+            static_cast<double>(allocations) / ops, static_cast<double>(bytesAllocated) / ops,
+            peakBytes, static_cast<double>(outputBytes) / ops);
+    fflush(out);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--filter NAME] [--min-time-ms N] [--label TEXT]\n", program);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    const char* label = "";
+    uint32_t minTimeMs = 200;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) {
+            minTimeMs = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            label = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Results keep the real stdout, firmware logging goes to /dev/null
+    FILE* results = fdopen(dup(STDOUT_FILENO), "w");
+    if (results == nullptr || freopen("/dev/null", "w", stdout) == nullptr) {
+        perror("stdout");
+        return 1;
+    }
+
+    // A deep sleep wake at a fixed time, so the device clock is set
+    static sim::BootRecord boot;
+    boot.trueTimeUs = 1704067200ULL * 1000000;
+    boot.resetReason = ESP_RST_DEEPSLEEP;
+    sim::boot = &boot;
+
+    BenchRunner runner(results, label, filter, minTimeMs);
+    runStorageBenchmarks(runner);
+    runRegistryBenchmarks(runner);
+    runPayloadBenchmarks(runner);
+    runTimeBenchmarks(runner);
+    return 0;
+}
@@ -0,0 +1,63 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <vector>
+
+// Heap use seen by the counting malloc in bench.cpp
+struct HeapCounters {
+    uint64_t allocations;
+    uint64_t bytesAllocated;
+    size_t liveBytes;
+    size_t peakBytes;
+};
+
+extern HeapCounters heapCounters;
+extern volatile int benchSink;   // Keeps results the optimiser could drop
+
+struct BenchParam {
+    const char* key;
+    int value;
+};
+
+// One benchmark configuration. reset runs untimed before every batch,
+// batch performs opsPerBatch operations and returns the bytes they produced
+// (0 when there is no output worth reporting).
+struct BenchCase {
+    const char* name;
+    std::vector<BenchParam> params;
+    int opsPerBatch;
+    std::function<void()> reset;
+    std::function<size_t()> batch;
+};
+
+// Times cases and prints one JSON object per line:
+//   {"bench", "label", "params": {...}, "ops", "ns_per_op",
+//    "allocs_per_op", "bytes_allocated_per_op", "peak_heap_bytes", "output_bytes_per_op"}
+class BenchRunner {
+public:
+    BenchRunner(FILE* out, const char* label, const char* filter, uint32_t minTimeMs);
+
+    void run(const BenchCase& benchCase);
+
+private:
+    FILE* out;
+    const char* label;
+    const char* filter;
+    uint32_t minTimeMs;
+};
+
+void runStorageBenchmarks(BenchRunner& runner);
+void runRegistryBenchmarks(BenchRunner& runner);
+void runPayloadBenchmarks(BenchRunner& runner);
+void runTimeBenchmarks(BenchRunner& runner);
+
+// Shared fixtures
+void benchPrepareStorage();               // Empty RTC buffer and spill log
+void benchFillStorage(int readings, int points);
+void benchReading(int index, int points, struct SensorData& data);
+
+#endif
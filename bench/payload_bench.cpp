@@ -0,0 +1,170 @@
+// Upload body encoding: decoding stored readings and writing them as JSON
+// (one localtime_r/strftime per reading) or CBOR, optionally gzipped, peak
+// heap for payloads far larger than the RTC buffer holds, and compressed
+// size against time for every gzip level
+#include "bench.hpp"
+#include <string.h>
+#include <vector>
+#include "data_manager.hpp"
+#include "gzip_writer.hpp"
+#include "payload_encoder.hpp"
+
+// Sink standing in for the HTTP connection
+class CountingSink : public Print {
+public:
+    CountingSink() : bytes(0) {}
+
+    size_t write(uint8_t) override {
+        bytes++;
+        return 1;
+    }
+    size_t write(const uint8_t*, size_t size) override {
+        bytes += size;
+        return size;
+    }
+
+    size_t bytes;
+};
+
+// Keeps what is written, to compress the same body at every level
+class BufferSink : public Print {
+public:
+    size_t write(uint8_t c) override {
+        bytes.push_back(c);
+        return 1;
+    }
+    size_t write(const uint8_t* data, size_t size) override {
+        bytes.insert(bytes.end(), data, data + size);
+        return size;
+    }
+
+    std::vector<uint8_t> bytes;
+};
+
+static void encodeStored(PayloadEncoder& encoder, int readings) {
+    StoredReadingReader reader;
+    StoredReading reading;
+    encoder.begin();
+    for (int i = 0; i < readings && reader.next(reading); i++) encoder.writeReading(reading);
+    encoder.end();
+}
+
+static size_t encodeBody(PayloadFormat format, int gzipLevel, int readings) {
+    static GzipWriter compressor;
+    CountingSink sink;
+    Print* out = &sink;
+    if (gzipLevel > 0) {
+        compressor.begin(sink, gzipLevel);
+        out = &compressor;
+    }
+
+    if (format == PayloadFormat::CBOR) {
+        CborPayloadEncoder encoder(*out, "bench-device");
+        encodeStored(encoder, readings);
+    } else {
+        JsonPayloadEncoder encoder(*out, "bench-device");
+        encodeStored(encoder, readings);
+    }
+
+    if (gzipLevel > 0) compressor.finish();
+    return sink.bytes;
+}
+
+// Generated readings, so the body size is not capped by storage
+static void encodeGeneratedReadings(PayloadEncoder& encoder, int readings, int points) {
+    SensorData data;
+    StoredReading reading;
+    encoder.begin();
+    for (int i = 0; i < readings; i++) {
+        benchReading(i, points, data);
+        memcpy(reading.dataPoints, data.dataPoints, sizeof(reading.dataPoints));
+        reading.numDataPoints = data.numDataPoints;
+        reading.timestamp = 1704067200 + i * 15;
+        encoder.writeReading(reading);
+    }
+    encoder.end();
+}
+
+static size_t encodeGenerated(PayloadFormat format, int gzipLevel, int readings, int points) {
+    static GzipWriter compressor;
+    CountingSink sink;
+    Print* out = &sink;
+    if (gzipLevel > 0) {
+        compressor.begin(sink, gzipLevel);
+        out = &compressor;
+    }
+
+    if (format == PayloadFormat::CBOR) {
+        CborPayloadEncoder encoder(*out, "bench-device");
+        encodeGeneratedReadings(encoder, readings, points);
+    } else {
+        JsonPayloadEncoder encoder(*out, "bench-device");
+        encodeGeneratedReadings(encoder, readings, points);
+    }
+
+    if (gzipLevel > 0) compressor.finish();
+    return sink.bytes;
+}
+
+void runPayloadBenchmarks(BenchRunner& runner) {
+    static const int POINTS[] = {1, 5, 10};
+    static const int READINGS[] = {1, 16, UPLOAD_CHUNK_READINGS};
+    static const int GZIP_LEVELS[] = {0, 1, 6};
+
+    for (int points : POINTS) {
+        for (int stored : READINGS) {
+            benchPrepareStorage();
+            benchFillStorage(stored, points);
+            // Larger readings may not all fit raw, only the raw ones are encoded
+            const int readings = stored < storedReadings.count ? stored : storedReadings.count;
+
+            for (int level : GZIP_LEVELS) {
+                runner.run({"payload_json", {{"points", points}, {"readings", readings}, {"gzip", level}},
+                            readings, []() {},
+                            [=]() { return encodeBody(PayloadFormat::JSON, level, readings); }});
+                runner.run({"payload_cbor", {{"points", points}, {"readings", readings}, {"gzip", level}},
+                            readings, []() {},
+                            [=]() { return encodeBody(PayloadFormat::CBOR, level, readings); }});
+            }
+        }
+    }
+
+    // The same encoded body at every gzip level; only the match search depth changes
+    for (PayloadFormat format : {PayloadFormat::JSON, PayloadFormat::CBOR}) {
+        static BufferSink body;
+        body.bytes.clear();
+        if (format == PayloadFormat::CBOR) {
+            CborPayloadEncoder encoder(body, "bench-device");
+            encodeGeneratedReadings(encoder, UPLOAD_CHUNK_READINGS, 5);
+        } else {
+            JsonPayloadEncoder encoder(body, "bench-device");
+            encodeGeneratedReadings(encoder, UPLOAD_CHUNK_READINGS, 5);
+        }
+
+        for (int level = 1; level <= 9; level++) {
+            runner.run({format == PayloadFormat::CBOR ? "gzip_level_cbor" : "gzip_level_json",
+                        {{"level", level}, {"input_bytes", static_cast<int>(body.bytes.size())}}, 1, []() {},
+                        [level]() {
+                            static GzipWriter compressor;
+                            CountingSink sink;
+                            compressor.begin(sink, level);
+                            compressor.write(body.bytes.data(), body.bytes.size());
+                            compressor.finish();
+                            return sink.bytes;
+                        }});
+        }
+    }
+
+    // Peak heap must stay flat as the body grows
+    static const int LARGE_READINGS[] = {24, 240, 2400};
+    for (int readings : LARGE_READINGS) {
+        for (int level : GZIP_LEVELS) {
+            runner.run({"payload_large_json", {{"points", 5}, {"readings", readings}, {"gzip", level}},
+                        readings, []() {},
+                        [=]() { return encodeGenerated(PayloadFormat::JSON, level, readings, 5); }});
+            runner.run({"payload_large_cbor", {{"points", 5}, {"readings", readings}, {"gzip", level}},
+                        readings, []() {},
+                        [=]() { return encodeGenerated(PayloadFormat::CBOR, level, readings, 5); }});
+        }
+    }
+}
@@ -0,0 +1,48 @@
+// SensorRegistry::read() with instant stand-in drivers, so only the
+// registry's layout, polling and compaction are measured
+#include "bench.hpp"
+#include "sensor_registry.hpp"
+
+template <bool Succeeds>
+struct InstantRead {
+    static bool initialize() { return true; }
+    static bool start(unsigned long&) { return true; }
+    static bool read(DataPoint* points) {
+        points[0].value = 1.0f;
+        return Succeeds;
+    }
+};
+
+struct BenchClimate : SensorDriver<SensorId::BME680, MetricId::TEMPERATURE, MetricId::HUMIDITY,
+                                   MetricId::PRESSURE, MetricId::GAS>, InstantRead<true> {};
+struct BenchSoil : SensorDriver<SensorId::SOIL_MOISTURE, MetricId::SOIL_MOISTURE_RAW,
+                                MetricId::SOIL_MOISTURE_PERCENT>, InstantRead<true> {};
+struct BenchBattery : SensorDriver<SensorId::BATTERY, MetricId::BATTERY_VOLTAGE, MetricId::BATTERY_PERCENT,
+                                   MetricId::BATTERY_TYPE>, InstantRead<true> {};
+struct BenchFailingBattery : SensorDriver<SensorId::BATTERY, MetricId::BATTERY_VOLTAGE,
+                                          MetricId::BATTERY_PERCENT, MetricId::BATTERY_TYPE>,
+                             InstantRead<false> {};
+struct BenchNetwork : SensorDriver<SensorId::NETWORK, MetricId::WIFI_RSSI>, InstantRead<true> {};
+
+static const int REGISTRY_READS_PER_BATCH = 256;
+
+template <typename List>
+static void benchRegistry(BenchRunner& runner, int failed) {
+    typedef SensorRegistry<List> Registry;
+    runner.run({"sensor_registry_read", {{"points", Registry::DATA_POINTS}, {"failed", failed}},
+                REGISTRY_READS_PER_BATCH,
+                []() { Registry::initialize(); },
+                []() -> size_t {
+                    SensorData data;
+                    for (int i = 0; i < REGISTRY_READS_PER_BATCH; i++) Registry::read(data);
+                    return 0;
+                }});
+}
+
+void runRegistryBenchmarks(BenchRunner& runner) {
+    benchRegistry<SensorList<BenchSoil>>(runner, 0);
+    benchRegistry<SensorList<BenchSoil, BenchBattery>>(runner, 0);
+    benchRegistry<SensorList<BenchClimate, BenchSoil, BenchBattery>>(runner, 0);
+    benchRegistry<SensorList<BenchClimate, BenchSoil, BenchBattery, BenchNetwork>>(runner, 0);
+    benchRegistry<SensorList<BenchClimate, BenchSoil, BenchFailingBattery, BenchNetwork>>(runner, 1);
+}
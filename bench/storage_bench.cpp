@@ -0,0 +1,102 @@
+// storeReading() from an empty buffer up to well past RTC capacity, where
+// blocks are decimated and spilled to flash, and the deadband filter in front of it
+#include "bench.hpp"
+#include <Arduino.h>
+#include <dirent.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "data_manager.hpp"
+#include "reading_filter.hpp"
+#include "spill_log.hpp"
+#include "time_manager.hpp"
+
+static const char* BENCH_SPILL_DIR = "bench_fs";
+static const time_t BENCH_START_TIME = 1704067200;
+static const uint32_t BENCH_INTERVAL_SECONDS = 15;
+
+static const MetricId BENCH_METRICS[MAX_DATA_POINTS_PER_READING] = {
+    MetricId::TEMPERATURE, MetricId::HUMIDITY, MetricId::PRESSURE, MetricId::GAS,
+    MetricId::SOIL_MOISTURE_RAW, MetricId::SOIL_MOISTURE_PERCENT, MetricId::BATTERY_VOLTAGE,
+    MetricId::BATTERY_PERCENT, MetricId::WIFI_RSSI, MetricId::STORED_READINGS_COUNT
+};
+
+// Slowly varying values with some noise, like real sensors
+void benchReading(int index, int points, SensorData& data) {
+    data.numDataPoints = points;
+    for (int i = 0; i < points; i++) {
+        const float noise = ((index * 7919 + i * 104729) % 1000) / 1000.0f;
+        data.dataPoints[i] = {BENCH_METRICS[i], 100.0f * (i + 1) + 10.0f * sinf(index / 240.0f + i) + noise};
+    }
+}
+
+void benchPrepareStorage() {
+    spillLogFlush();
+    DIR* dir = opendir(BENCH_SPILL_DIR);
+    if (dir != nullptr) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (entry->d_name[0] == '.') continue;
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", BENCH_SPILL_DIR, entry->d_name);
+            unlink(path);
+        }
+        closedir(dir);
+    }
+    mkdir(BENCH_SPILL_DIR, 0755);
+
+    spillLogState.magic = 0;
+    spillLogBegin(false, BENCH_SPILL_DIR);
+    clearStoredReadings();
+    storedReadings.oldestUnsent = 0;
+    timeState.lastKnownTime = BENCH_START_TIME;
+}
+
+void benchFillStorage(int readings, int points) {
+    SensorData data;
+    for (int i = 0; i < readings; i++) {
+        benchReading(i, points, data);
+        storeReading(data);
+        timeState.lastKnownTime += BENCH_INTERVAL_SECONDS;
+    }
+}
+
+void runStorageBenchmarks(BenchRunner& runner) {
+    static const int POINTS[] = {1, 3, 5, 10};
+    static const int READINGS[] = {16, 128, 1024};
+
+    for (int points : POINTS) {
+        // Inputs are built up front so only storing is timed
+        std::vector<SensorData> inputs(READINGS[2]);
+        for (size_t i = 0; i < inputs.size(); i++) benchReading(i, points, inputs[i]);
+
+        for (int readings : READINGS) {
+            runner.run({"store_reading", {{"points", points}, {"readings", readings}}, readings,
+                        benchPrepareStorage,
+                        [&inputs, readings]() -> size_t {
+                            for (int i = 0; i < readings; i++) {
+                                storeReading(inputs[i]);
+                                timeState.lastKnownTime += BENCH_INTERVAL_SECONDS;
+                            }
+                            return 0;
+                        }});
+        }
+
+        runner.run({"filter_reading", {{"points", points}}, READINGS[1],
+                    []() {
+                        readingFilter = ReadingFilterState();
+                        timeState.lastKnownTime = BENCH_START_TIME;
+                    },
+                    [&inputs]() -> size_t {
+                        SensorData filtered;
+                        int kept = 0;
+                        for (int i = 0; i < READINGS[1]; i++) {
+                            if (filterReading(inputs[i], timeState.lastKnownTime, filtered)) kept++;
+                            timeState.lastKnownTime += BENCH_INTERVAL_SECONDS;
+                        }
+                        benchSink = kept;
+                        return 0;
+                    }});
+    }
+}
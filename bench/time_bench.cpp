@@ -0,0 +1,62 @@
+// Per-wake clock and schedule bookkeeping from time_manager.cpp, wake_schedule.cpp and cadence.cpp
+#include "bench.hpp"
+#include "cadence.hpp"
+#include "time_manager.hpp"
+#include "wake_schedule.hpp"
+
+static const int TIME_CALLS_PER_BATCH = 256;
+
+static void resetTimeState() {
+    timeState.lastKnownTime = 1704067200;
+    timeState.lastSuccessfulSync = timeState.lastKnownTime;
+    timeState.timeInitialized = true;
+    timeState.driftPpm = 52.5f;
+    timeState.driftErrorPpm = 1.5f;
+    timeState.driftSamples = 4;
+    timeState.uncertaintyUs = 0;
+    timeState.isNight = false;
+}
+
+void runTimeBenchmarks(BenchRunner& runner) {
+    runner.run({"time_update_after_sleep", {}, TIME_CALLS_PER_BATCH, resetTimeState, []() -> size_t {
+        // Sleep entry and the drift correction at the next wake
+        for (int i = 0; i < TIME_CALLS_PER_BATCH; i++) {
+            recordTimeBeforeSleep();
+            updateTimeAfterSleep();
+        }
+        return 0;
+    }});
+    runner.run({"time_schedule_next_wake", {}, TIME_CALLS_PER_BATCH, resetTimeState, []() -> size_t {
+        uint64_t sleepUs = 0;
+        for (int i = 0; i < TIME_CALLS_PER_BATCH; i++) sleepUs += scheduleNextWake();
+        benchSink = static_cast<int>(sleepUs);
+        return 0;
+    }});
+    runner.run({"time_schedule_query", {}, TIME_CALLS_PER_BATCH, resetTimeState, []() -> size_t {
+        int night = 0;
+        for (int i = 0; i < TIME_CALLS_PER_BATCH; i++) night += querySchedule(timeState.lastKnownTime + i * 97).night;
+        benchSink = night;
+        return 0;
+    }});
+    runner.run({"time_cadence_update", {}, TIME_CALLS_PER_BATCH, []() { cadenceState = {{}, 0, -1.0f, 0}; },
+                []() -> size_t {
+        // Soil and climate points wandering around their deadbands
+        SensorData data;
+        data.numDataPoints = 6;
+        int moved = 0;
+        for (int i = 0; i < TIME_CALLS_PER_BATCH; i++) {
+            for (int m = 0; m < data.numDataPoints; m++) {
+                data.dataPoints[m] = {static_cast<MetricId>(m), 100.0f + (i * 7 + m * 13) % 50 * 0.1f};
+            }
+            moved += updateCadence(data);
+        }
+        benchSink = moved;
+        return 0;
+    }});
+    runner.run({"time_state_valid", {}, TIME_CALLS_PER_BATCH, resetTimeState, []() -> size_t {
+        int valid = 0;
+        for (int i = 0; i < TIME_CALLS_PER_BATCH; i++) valid += isStateValid();
+        benchSink = valid;
+        return 0;
+    }});
+}
@@ -0,0 +1,27 @@
+#ifndef ADC_SAMPLER_HPP
+#define ADC_SAMPLER_HPP
+
+#include <stdint.h>
+#include "sample_stats.hpp"
+
+// Burst sampling of ADC1 pins through the continuous (DMA) driver, with
+// eFuse based calibration for converting raw counts to millivolts
+class AdcSampler {
+public:
+    // Loads the calibration characteristics, once per boot
+    static void begin();
+
+    // Captures ADC_SAMPLES_PER_CHANNEL conversions of pin at ADC_SAMPLE_RATE_HZ
+    // and summarises the raw counts. Falls back to one-shot reads if the
+    // continuous driver cannot be started.
+    static bool capture(int pin, SampleStats& stats);
+
+    // Calibrated voltage of a (possibly fractional) raw count
+    static float toMillivolts(float raw);
+
+private:
+    static bool captureContinuous(int channel, uint16_t* samples, size_t& count);
+    static bool initialized;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef CADENCE_HPP
+#define CADENCE_HPP
+
+#include "esp_attr.h"
+#include "config.hpp"
+#include "types.hpp"
+
+// Wake stride, adapted to how much the cadence metrics move between wakes
+struct CadenceState {
+    float reference[METRIC_COUNT];  // Value each metric's movement is measured from
+    uint16_t referenceMask;         // Metrics that have a reference yet
+    float batteryPercent;           // From the last reading, negative if unknown
+    uint8_t stride;                 // Grid slots the next sleep spans, 0 before the first reading
+} extern RTC_DATA_ATTR cadenceState;
+
+// Compares a reading with the references and doubles or resets the stride.
+// Returns true if a cadence metric moved past its deadband.
+bool updateCadence(const SensorData& data);
+
+// Grid slots the next sleep spans, 1 with CADENCE_ENABLED off
+uint32_t cadenceStride();
+// Longest stride updateCadence() can still choose this wake
+uint32_t maxCadenceStride();
+
+#endif
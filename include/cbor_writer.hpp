@@ -0,0 +1,27 @@
+#ifndef CBOR_WRITER_HPP
+#define CBOR_WRITER_HPP
+
+#include <Arduino.h>
+
+// Minimal streaming CBOR (RFC 8949) encoder writing to a Print sink
+class CborWriter {
+public:
+    explicit CborWriter(Print& out);
+
+    void writeUint(uint32_t value);
+    void writeInt(int32_t value);
+    void writeFloat(float value);
+    void writeText(const char* text);
+    void beginArray(uint32_t size);
+    void beginMap(uint32_t size);
+    void beginIndefiniteArray();
+    void beginIndefiniteMap();
+    void writeBreak();
+
+private:
+    void writeHead(uint8_t majorType, uint32_t value);
+
+    Print& out;
+};
+
+#endif
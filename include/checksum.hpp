@@ -0,0 +1,10 @@
+#ifndef CHECKSUM_HPP
+#define CHECKSUM_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3), pass the previous result to checksum data in pieces
+uint32_t crc32(const void* data, size_t length, uint32_t crc = 0);
+
+#endif
@@ -4,5 +4,9 @@
 #include "config/sensors.hpp"
 #include "config/power.hpp"
 #include "config/time.hpp"
+#include "config/storage.hpp"
+#include "config/network.hpp"
+#include "config/profiling.hpp"
+#include "config/logging.hpp"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef LOGGING_CONFIG_HPP
+#define LOGGING_CONFIG_HPP
+
+#include <stddef.h>
+
+// Log levels, see logging.hpp. Statements above their module's level are
+// compiled out; override per build with e.g. -D LOG_LEVEL_NETWORK=LOG_LEVEL_DEBUG
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_LEVEL_SYSTEM
+#define LOG_LEVEL_SYSTEM LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_TIME
+#define LOG_LEVEL_TIME LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_SENSOR
+#define LOG_LEVEL_SENSOR LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_STORAGE
+#define LOG_LEVEL_STORAGE LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_NETWORK
+#define LOG_LEVEL_NETWORK LOG_LEVEL
+#endif
+
+// Records up to this level are also printed to Serial as they are logged.
+// Serial blocks at ~11.5 bytes/ms, so this is for bench debugging only.
+#ifndef LOG_ECHO_LEVEL
+#define LOG_ECHO_LEVEL LOG_LEVEL_NONE
+#endif
+
+// Records are kept in a ring in RTC memory and printed after a wake that
+// logged an error, after a crash or watchdog reset, or when LOG_DUMP_PIN is
+// held low at wake
+static const size_t LOG_RING_BYTES = 768;
+static const size_t LOG_MAX_RECORD_BYTES = 96;     // Header and arguments
+static const size_t LOG_MAX_STRING_BYTES = 32;     // Longer string arguments are cut
+static const int LOG_DUMP_PIN = 0;                 // BOOT button
+static const unsigned long LOG_DUMP_SETTLE_MS = 1000;  // Lets a serial monitor attach after reset
+
+#endif
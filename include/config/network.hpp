@@ -0,0 +1,65 @@
+#ifndef NETWORK_CONFIG_HPP
+#define NETWORK_CONFIG_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Upload body encoding, sent as the request Content-Type
+enum class PayloadFormat {
+    JSON,  // application/json
+    CBOR   // application/cbor, compact schema in payload_encoder.hpp
+};
+
+static const PayloadFormat UPLOAD_FORMAT = PayloadFormat::JSON;
+
+// gzip level 1-9 for the upload body (Content-Encoding: gzip), 0 disables it
+static const int UPLOAD_COMPRESSION_LEVEL = 0;
+
+// WiFi connection: the fast path reuses the cached BSSID, channel and lease
+// and is abandoned for a full scan with DHCP after WIFI_FAST_CONNECT_TIMEOUT_MS
+static const unsigned long WIFI_FAST_CONNECT_TIMEOUT_MS = 1500;
+static const unsigned long WIFI_CONNECT_TIMEOUT_MS = 10000;
+static const uint32_t WIFI_LEASE_REUSE_SECONDS = 12 * 3600;  // Renew via DHCP after this
+
+// Upload scheduling, see upload_scheduler.hpp
+enum class UploadSchedulerType {
+    FIXED_RULE,  // Any backlog during the day, or a nearly full buffer
+    COST_MODEL   // Batch uploads for readings per radio-on second within a latency bound
+};
+
+static const UploadSchedulerType UPLOAD_SCHEDULER = UploadSchedulerType::COST_MODEL;
+static const uint32_t UPLOAD_MAX_LATENCY_SECONDS = 6 * 3600;  // Oldest reading must be sent by then
+static const float UPLOAD_FILL_THRESHOLD = 0.8f;              // Fraction of lossless storage
+static const float UPLOAD_TARGET_READINGS_PER_SECOND = 25.0f; // Upload early once this is reached
+static const uint32_t UPLOAD_DEFAULT_CONNECT_MS = 3000;       // Used until connects have been timed
+static const float UPLOAD_MS_PER_READING = 2.0f;
+static const float UPLOAD_LOW_BATTERY_PERCENT = 20.0f;
+static const float UPLOAD_LOW_BATTERY_LATENCY_FACTOR = 2.0f;  // Stretches the bound on low battery
+static const int CONNECT_HISTORY_SIZE = 8;
+
+// Upload wakes run WiFi, time sync and upload on PIPELINE_NETWORK_CORE while
+// the main task reads the sensors; false keeps the sequential wake
+static const bool PIPELINED_WAKE = true;
+static const int PIPELINE_NETWORK_CORE = 0;         // Core the WiFi stack runs on
+static const uint32_t PIPELINE_NETWORK_STACK_BYTES = 12288;  // Room for the TLS handshake
+static const size_t PIPELINE_QUEUE_LENGTH = 4;
+
+// Upload chunking: every POST carries at most this many raw readings from RTC
+// memory (spill log chunks are bounded by SPILL_UPLOAD_RECORDS instead)
+static const int UPLOAD_CHUNK_READINGS = 48;
+
+// Upload request configuration
+static const size_t HTTP_CHUNK_BYTES = 512;            // Body is streamed in chunks of this size
+static const size_t HTTP_HEADER_BYTES = 512;           // Request line and headers, sent in one write
+static const unsigned long HTTP_RESPONSE_TIMEOUT_MS = 10000;
+
+// Keep the connection open across retries and chunks within one wake
+static const bool HTTP_KEEP_ALIVE = true;
+
+// TLS: the last session is kept in RTC memory and resumed on the next wake.
+// Sessions larger than the cache (e.g. with a big peer certificate) are not kept.
+static const size_t TLS_SESSION_CACHE_BYTES = 1280;
+static const unsigned long TLS_HANDSHAKE_TIMEOUT_MS = 10000;
+static const unsigned long TLS_WRITE_STALL_TIMEOUT_MS = 5000;  // Socket accepting nothing, the connection is dropped
+
+#endif
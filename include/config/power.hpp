@@ -21,7 +21,33 @@ static const float AA_MAX_VOLTAGE = 4.5;
 // Device metrics configuration
 static const int BATTERY_VOLTAGE_PIN = 35;  // ADC1_CHANNEL_7
 static const float BATTERY_VOLTAGE_DIVIDER_RATIO = 2.0;
-static const float ADC_REFERENCE_VOLTAGE = 3.3;
-static const int ADC_RESOLUTION = 4095;
+
+// ADC burst sampling through the continuous (DMA) driver
+static const size_t ADC_SAMPLES_PER_CHANNEL = 256;
+static const uint32_t ADC_SAMPLE_RATE_HZ = 40000;     // 256 samples in ~6.5 ms
+static const uint32_t ADC_DMA_FRAME_BYTES = 256;
+static const unsigned long ADC_CAPTURE_TIMEOUT_MS = 50;
+static const float ADC_TRIM_FRACTION = 0.1;           // Dropped from each end for the trimmed mean
+static const uint32_t ADC_DEFAULT_VREF_MV = 1100;     // Used when eFuse holds no calibration
+
+// Wake budget, see wake_deadline.hpp. A timer puts the device to sleep
+// WAKE_DEADLINE_MS after boot, as soon as no storage write is in progress;
+// before that, phases give up once their own budget or the wake's time less
+// WAKE_SLEEP_RESERVE_MS is spent. Budgets are in WakePhase order, 0 for
+// phases without their own.
+static const uint32_t WAKE_DEADLINE_MS = 45000;
+static const uint32_t WAKE_SLEEP_RESERVE_MS = 1500;   // Storing the reading and going to sleep
+static const uint32_t WAKE_DEADLINE_RETRY_MS = 10;    // Recheck while a write holds off the deadline
+static const uint32_t WAKE_PHASE_BUDGET_MS[] = {
+    0,          // BOOT
+    0,          // SERIAL_SETTLE
+    12000,      // WIFI_CONNECT, fast path plus a full scan
+    20000,      // TIME_SYNC, reconnects and NTP
+    1000,       // SENSOR_INIT
+    2000,       // SENSOR_READ
+    0,          // STORE, flash writes run to completion
+    25000,      // UPLOAD
+    0           // AWAKE, bounded by WAKE_DEADLINE_MS
+};
 
 #endif 
\ No newline at end of file
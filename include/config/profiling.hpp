@@ -0,0 +1,20 @@
+#ifndef PROFILING_CONFIG_HPP
+#define PROFILING_CONFIG_HPP
+
+#include <stdint.h>
+
+// Wake phase profiling, see wake_profiler.hpp. Build with
+// -D WAKE_PROFILER_ENABLED=0 to compile the timers and the upload out.
+#ifndef WAKE_PROFILER_ENABLED
+#define WAKE_PROFILER_ENABLED 1
+#endif
+
+// Half-octave duration buckets; the first holds everything under
+// 2^PROFILE_BUCKET_BASE_SHIFT us, the last everything from 2^23 us (8.4 s)
+static const int PROFILE_HISTOGRAM_BUCKETS = 32;
+static const int PROFILE_BUCKET_BASE_SHIFT = 8;
+
+// Wakes between profile uploads, sent along with the next data upload
+static const uint16_t PROFILE_UPLOAD_WAKES = 240;
+
+#endif
@@ -1,46 +1,58 @@
 #ifndef SENSORS_CONFIG_HPP
 #define SENSORS_CONFIG_HPP
 
-#include <Arduino.h>
+#include <stdint.h>
 
-// Add this before the SensorType enum
+// Sensor identifiers reported alongside each metric
 enum class SensorId : uint8_t {
     BME680 = 1,
     SOIL_MOISTURE = 2,
     BATTERY = 3,
-    NETWORK = 4
+    NETWORK = 4,
+    DEVICE = 5     // Firmware self-measurement, e.g. the wake profile
 };
 
-// Sensor configuration
-enum class SensorType {
-    BME680,
-    SOIL_MOISTURE,
-    BATTERY_METRICS,
-    NETWORK_METRICS,
-    NONE  // Used for empty slots
-};
-
-// Maximum number of active sensors
-static const int MAX_ACTIVE_SENSORS = 3;
-
-// Active sensor configuration
-static const SensorType ACTIVE_SENSORS[MAX_ACTIVE_SENSORS] = {
-    SensorType::SOIL_MOISTURE,
-    // SensorType::BME680,
-    // SensorType::BATTERY_METRICS,
-    SensorType::NETWORK_METRICS,
-    SensorType::NONE
-};
+// Sensor drivers, defined in include/sensor_drivers.hpp
+struct Bme680Driver;
+struct SoilMoistureDriver;
+struct BatteryDriver;
+struct NetworkMetricsDriver;
+
+template <typename... Drivers>
+struct SensorList {};
+
+// Every driver, active or not. A metric is reported with the sensor whose
+// driver lists it, so readings stored by an earlier build keep their labels.
+typedef SensorList<
+    Bme680Driver,
+    SoilMoistureDriver,
+    BatteryDriver,
+    NetworkMetricsDriver
+> KnownSensors;
+
+// Active sensors, read in this order. Disabled drivers are not compiled in.
+typedef SensorList<
+    SoilMoistureDriver,
+    // Bme680Driver,
+    // BatteryDriver,
+    NetworkMetricsDriver
+> ActiveSensors;
 
 // BME680 configuration
 static const int BME_SCL = 22;
 static const int BME_SDA = 21;
 static const int BME_ADDRESS = 0x77;
+static const uint16_t BME_HEATER_TEMP_C = 320;
+static const uint16_t BME_HEATER_MS = 150;
+// The chip keeps its settings through deep sleep. Warm wakes reuse the
+// calibration cached in RTC memory and only trigger a measurement.
+static const bool BME_WARM_START = true;
 
 // Soil Moisture configuration
 static const int SOIL_MOISTURE_PIN = 32;  
 static const int SOIL_MOISTURE_POWER_PIN = 27;
 static const int SOIL_MOISTURE_AIR_VALUE = 2800;    // Reading in air
 static const int SOIL_MOISTURE_WATER_VALUE = 950;   // Reading in water
+static const unsigned long SOIL_MOISTURE_SETTLE_MS = 10;          // After powering the probe
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef STORAGE_CONFIG_HPP
+#define STORAGE_CONFIG_HPP
+
+#include <stdint.h>
+
+// What happens when the raw reading ring is full
+enum class OverflowPolicy {
+    DROP_NEWEST,  // Keep the buffer as is and discard the new reading
+    DROP_OLDEST,  // Discard the oldest block of raw readings
+    DECIMATE      // Merge the oldest block into coarser aggregate buckets
+};
+
+static const OverflowPolicy STORAGE_OVERFLOW_POLICY = OverflowPolicy::DECIMATE;
+
+// Deadband filter in front of storage: a metric is stored when it moves more
+// than its deadband away from the last stored value, or as the mean of its
+// window once it has been quiet for maxSilenceSeconds. A silence of 0 stores
+// every reading of that metric. Metrics marked cadence also set the wake rate
+// (CADENCE_LIMITS): moving past the deadband brings the next wake forward.
+struct MetricFilter {
+    float deadband;
+    uint32_t maxSilenceSeconds;
+    bool cadence;
+};
+
+static const bool READING_FILTER_ENABLED = true;
+static const MetricFilter METRIC_FILTERS[] = {   // In MetricId order
+    {0.2f, 60 * 60, true},          // TEMPERATURE, deg C
+    {1.0f, 60 * 60, true},          // HUMIDITY, %
+    {0.5f, 60 * 60, true},          // PRESSURE, hPa
+    {5.0f, 60 * 60, true},          // GAS, kOhm
+    {20.0f, 60 * 60, true},         // SOIL_MOISTURE_RAW, ADC counts
+    {1.0f, 60 * 60, true},          // SOIL_MOISTURE_PERCENT
+    {0.02f, 60 * 60, false},        // BATTERY_VOLTAGE, V
+    {1.0f, 60 * 60, false},         // BATTERY_PERCENT
+    {0.0f, 6 * 60 * 60, false},     // BATTERY_TYPE, only changes with a new build
+    {5.0f, 60 * 60, false},         // WIFI_RSSI, dBm
+    {50.0f, 60 * 60, false},        // STORED_READINGS_COUNT
+    {0.0f, 60 * 60, false}          // STORED_BUCKETS_COUNT
+};
+
+// Raw readings are packed into a ring of independently decodable blocks
+static const int RAW_BLOCK_BYTES = 256;
+static const int RAW_BLOCK_COUNT = 8;
+
+// Decimated history: each tier holds averages with min/max over a fixed span.
+// Buckets falling out of a tier are merged into the next, coarser one.
+static const int AGGREGATE_TIER_COUNT = 2;
+static const int AGGREGATE_BUCKETS_PER_TIER = 4;
+static const uint32_t AGGREGATE_TIER_SPAN[AGGREGATE_TIER_COUNT] = {
+    60 * 60,     // 1 hour
+    6 * 60 * 60  // 6 hours
+};
+
+// Flash spill log: sealed RTC blocks are written to LittleFS in batches,
+// RTC memory acts as a write-back cache in front of it
+static const bool SPILL_LOG_ENABLED = true;
+#ifndef FS_MOUNT_POINT
+#define FS_MOUNT_POINT "/littlefs"   // The native simulation mounts a host directory instead
+#endif
+static const char* const SPILL_LOG_DIR = FS_MOUNT_POINT "/spill";
+static const int SPILL_FLUSH_BLOCKS = 4;        // Sealed blocks that trigger a flush
+static const int SPILL_SEGMENT_RECORDS = 15;    // Records per segment file, ~4 KB
+static const int SPILL_MAX_SEGMENTS = 64;       // Oldest segment is dropped beyond this
+static const int SPILL_UPLOAD_RECORDS = 4;      // Records sent per POST when draining
+
+#endif
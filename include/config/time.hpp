@@ -7,17 +7,65 @@
 static const uint64_t ONE_SECOND = 1000000;
 
 // Sleep configuration
-static const uint64_t SLEEP_TIME = 15 * ONE_SECOND; // 15 minutes
+static const uint64_t SLEEP_TIME = 15 * ONE_SECOND; // Default wake interval, used until the clock is set
 static const int MAX_RETRIES = 3;
 static const int RETRY_DELAY = 5000;
 
 // Time configuration
-static const char* ntpServer = "pool.ntp.org";
+static const char* const ntpServer = "pool.ntp.org";
 static const long gmtOffset_sec = 36000 + 3600;    // AEDT: UTC+11 * 3600
 static const int daylightOffset_sec = 0; 
 
+// Timekeeping. The RTC drift is learned from consecutive NTP syncs, and NTP
+// only runs once the bound on the clock error passes the tolerance.
+static const uint32_t TIME_SYNC_TOLERANCE_MS = 1000;
+static const uint32_t TIME_MAX_UNCERTAINTY_MS = 60000;  // Beyond this the clock is re-initialised at wake
+static const uint32_t TIME_SYNC_TIMEOUT_MS = 3000;      // Wait for an NTP answer
+static const float TIME_DRIFT_UNKNOWN_PPM = 500;        // Bound before the first estimate, 150 kHz RC oscillator
+static const float TIME_DRIFT_MARGIN_PPM = 10;          // Added to the recent estimate error
+static const float TIME_DRIFT_GAIN = 0.5f;              // Weight of each new drift observation
+static const uint32_t TIME_DRIFT_MIN_LEARN_S = 3600;    // Shorter spans are dominated by the NTP error
+
 // Night time parameters
 static const int NIGHT_START_HOUR = 21;
 static const int NIGHT_END_HOUR = 6;
 
+// Wake schedule. Windows start at a local hour, sorted, and the last one runs
+// past midnight into the first. Wakes fall on multiples of the window's
+// interval counted from local midnight (900 s gives :00/:15/:30/:45) and on
+// window starts, so devices on the same schedule sample together.
+struct ScheduleWindow {
+    uint8_t startHour;
+    uint32_t intervalSeconds;
+    bool night;                // Readings wait for daytime under FixedRuleScheduler
+};
+
+static const ScheduleWindow SCHEDULE_WINDOWS[] = {
+    {NIGHT_END_HOUR, SLEEP_TIME / ONE_SECOND, false},
+    {NIGHT_START_HOUR, SLEEP_TIME / ONE_SECOND, true},
+};
+static const int SCHEDULE_WINDOW_COUNT = sizeof(SCHEDULE_WINDOWS) / sizeof(SCHEDULE_WINDOWS[0]);
+static const uint32_t SCHEDULE_MIN_SLEEP_MS = 1000;      // Nearer slots are skipped
+static const uint32_t SCHEDULE_BOOT_LATENCY_MS = 250;    // Wake stub to setup(), refined from actual wakes
+
+// Adaptive cadence. A sleep spans `stride` slots of the window's grid, on
+// multiples of stride x interval from local midnight. The stride doubles after
+// every wake in which the cadence metrics (METRIC_FILTERS) stayed within their
+// deadbands, and drops to the minimum when one moves. Rows are in descending
+// battery order; the first one the battery level reaches applies, the first
+// row while the level is unknown. Powers of two keep devices aligned.
+struct CadenceLimit {
+    float batteryPercent;
+    uint8_t minStride;
+    uint8_t maxStride;
+};
+
+static const bool CADENCE_ENABLED = true;
+static const CadenceLimit CADENCE_LIMITS[] = {
+    {40.0f, 1, 8},
+    {15.0f, 2, 16},
+    {0.0f, 4, 32},
+};
+static const int CADENCE_LIMIT_COUNT = sizeof(CADENCE_LIMITS) / sizeof(CADENCE_LIMITS[0]);
+
 #endif 
\ No newline at end of file
@@ -3,7 +3,42 @@
 
 #include "types.hpp"
 #include "globals.hpp"
+#include "reading_codec.hpp"
+#include "spill_log.hpp"
 
 void storeReading(const SensorData& data);
+void clearStoredReadings();  // RTC contents only, the spill log is consumed via its cursor
+void acknowledgeStoredReadings(int readings);  // Drops the oldest raw readings after upload
+void acknowledgeSpilledReadings(const SpillLogPosition& end, int readings);
+void clearAggregateBuckets();
+bool hasStoredReadings();
+bool isStorageFull();
+size_t storageBytesUsed();
+int storedReadingCount();   // Raw, spilled and decimated readings
+int storedBucketCount();
+float storageFill();          // 0..1 of the capacity that holds readings without loss
+time_t oldestUnsentTime();    // 0 when nothing is pending
 
-#endif 
\ No newline at end of file
+// Decodes the raw block ring oldest reading first
+class StoredReadingReader {
+public:
+    StoredReadingReader();
+    bool next(StoredReading& reading);
+
+private:
+    ReadingBlockDecoder decoder;
+    int blockOffset;
+};
+
+// Walks the aggregate tiers oldest (coarsest) bucket first
+class AggregateBucketReader {
+public:
+    AggregateBucketReader();
+    bool next(const AggregateBucket*& bucket);
+
+private:
+    int tier;
+    int offset;
+};
+
+#endif 
@@ -0,0 +1,57 @@
+#ifndef GZIP_WRITER_HPP
+#define GZIP_WRITER_HPP
+
+#include <Arduino.h>
+
+// Streaming gzip compressor (RFC 1951/1952) sitting in front of another sink.
+// Uses greedy LZ77 over a small sliding window and the fixed Huffman code,
+// so memory stays at a few KB regardless of payload size.
+class GzipWriter : public Print {
+public:
+    static const int WINDOW_BITS = 10;
+    static const int WINDOW_SIZE = 1 << WINDOW_BITS;
+
+    GzipWriter();
+
+    // level 1 (fastest) to 9 (smallest), only the match search depth changes
+    void begin(Print& out, int level);
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t size) override;
+    void finish();
+
+    size_t bytesIn() const { return inputBytes; }
+
+private:
+    static const int HASH_BITS = 10;
+    static const int HASH_SIZE = 1 << HASH_BITS;
+    static const int MIN_MATCH = 3;
+    static const int MAX_MATCH = 258;
+    static const int MIN_LOOKAHEAD = MAX_MATCH + MIN_MATCH + 1;
+    static const uint16_t NIL = 0xFFFF;
+
+    void compress(bool flush);
+    void slideWindow();
+    uint32_t hashAt(int position) const;
+    void insertHash(int position);
+    int longestMatch(int position, int& distance);
+
+    void writeBits(uint32_t value, int count);
+    void writeHuffman(uint32_t code, int length);
+    void writeLiteral(int symbol);
+    void writeMatch(int length, int distance);
+    void flushBits();
+
+    Print* out;
+    int maxChain;
+    uint8_t window[2 * WINDOW_SIZE];
+    uint16_t head[HASH_SIZE];
+    uint16_t prev[WINDOW_SIZE];
+    int position;   // Next byte to compress
+    int end;        // Bytes of valid data in window
+    uint32_t bitBuffer;
+    int bitCount;
+    uint32_t crc;
+    size_t inputBytes;
+};
+
+#endif
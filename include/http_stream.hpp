@@ -0,0 +1,67 @@
+#ifndef HTTP_STREAM_HPP
+#define HTTP_STREAM_HPP
+
+#include <Arduino.h>
+#include <Client.h>
+#include <functional>
+#include "config.hpp"
+
+// Produces a request body by writing it to the given sink
+typedef std::function<void(Print&)> BodyWriter;
+
+struct ParsedUrl {
+    bool secure;
+    char host[64];
+    uint16_t port;
+    const char* path;  // Points into the original URL
+};
+
+bool parseUrl(const char* url, ParsedUrl& parsed);
+
+// Buffers body bytes and sends them as HTTP/1.1 chunks of HTTP_CHUNK_BYTES,
+// so peak memory no longer depends on payload size. Each chunk's size line,
+// data and CRLF go out in one write, one TLS record per chunk.
+class ChunkedBodyWriter : public Print {
+public:
+    explicit ChunkedBodyWriter(Client& client);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t size) override;
+    bool finish();
+
+    size_t bytesWritten() const { return total; }
+    bool failed() const { return error; }
+
+private:
+    static const size_t SIZE_LINE_BYTES = 8;  // Hex length and CRLF, right-aligned in front of the data
+
+    bool flushChunk(bool last);
+
+    Client& client;
+    uint8_t frame[SIZE_LINE_BYTES + HTTP_CHUNK_BYTES + 7];  // Size line, data, CRLF and the last-chunk marker
+    size_t used;
+    size_t total;
+    bool error;
+};
+
+// Request metadata sent ahead of the body
+struct UploadHeaders {
+    const char* contentType;
+    const char* contentEncoding;  // nullptr for an uncompressed body
+    const char* authToken;
+    const char* deviceId;
+    uint32_t sequence;            // Per-device upload chunk number, repeated on retries
+};
+
+struct HttpResult {
+    int status;        // HTTP status code, -1 if the request could not be completed
+    size_t bodyBytes;  // Request body bytes sent
+    bool keepAlive;    // Response was read completely and the server keeps the connection
+};
+
+// Sends a chunked POST on an already connected client and reads the whole
+// response, so the connection can carry another request afterwards
+void postChunked(Client& client, const ParsedUrl& url, const UploadHeaders& headers,
+                 const BodyWriter& writeBody, HttpResult& result);
+
+#endif
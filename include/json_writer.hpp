@@ -0,0 +1,34 @@
+#ifndef JSON_WRITER_HPP
+#define JSON_WRITER_HPP
+
+#include <Arduino.h>
+
+// Writes JSON straight to a Print sink without building a document in memory
+class JsonStreamWriter {
+public:
+    explicit JsonStreamWriter(Print& out);
+
+    void beginArray();
+    void beginArray(const char* key);   // Array as an object member
+    void endArray();
+    void beginObject();
+    void endObject();
+
+    void member(const char* key, const char* value);
+    void member(const char* key, float value);
+    void member(const char* key, uint32_t value);
+    void element(uint32_t value);       // Array item
+
+private:
+    static const int MAX_DEPTH = 8;
+
+    void separator();
+    void key(const char* name);
+    void string(const char* value);
+
+    Print& out;
+    uint8_t depth;
+    bool first[MAX_DEPTH];
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef LOGGING_HPP
+#define LOGGING_HPP
+
+#include <Arduino.h>
+#include <type_traits>
+#include "esp_attr.h"
+#include "config/logging.hpp"
+
+// Levelled logging into a binary ring in RTC memory. A record keeps the
+// format string's address and the raw arguments; text is only produced
+// when the ring is dumped, so logging costs a few hundred ns instead of
+// the time Serial needs to send the line.
+//
+//   LOG_INFO(NETWORK, "Connected in %lu ms", ms);
+//
+// Statements above LOG_LEVEL_<MODULE> compile to nothing, arguments included.
+
+enum LogModule : uint8_t {
+    LOG_MODULE_SYSTEM,
+    LOG_MODULE_TIME,
+    LOG_MODULE_SENSOR,
+    LOG_MODULE_STORAGE,
+    LOG_MODULE_NETWORK,
+    LOG_MODULE_COUNT  // Number of modules, not a module
+};
+
+#define LOG_AT(level, module, ...)                                                   \
+    do {                                                                             \
+        if (LOG_LEVEL_##level <= LOG_LEVEL_##module) {                               \
+            logWrite(LOG_LEVEL_##level, LOG_MODULE_##module, __VA_ARGS__);           \
+        }                                                                            \
+    } while (0)
+
+#define LOG_ERROR(module, ...) LOG_AT(ERROR, module, __VA_ARGS__)
+#define LOG_WARN(module, ...) LOG_AT(WARN, module, __VA_ARGS__)
+#define LOG_INFO(module, ...) LOG_AT(INFO, module, __VA_ARGS__)
+#define LOG_DEBUG(module, ...) LOG_AT(DEBUG, module, __VA_ARGS__)
+
+// Ring state, survives deep sleep and crash resets
+struct LogRing {
+    uint32_t magic;
+    uint32_t buildId;       // Format addresses are only valid for the same firmware
+    uint16_t head;          // Next byte to write
+    uint16_t used;          // Bytes held, the oldest record starts at head - used
+    uint16_t wake;          // Wakes since the ring was created
+    uint16_t overwritten;   // Records lost to wrap-around since the last dump
+    bool errorLogged;       // Dump before sleeping
+    uint8_t data[LOG_RING_BYTES];
+} extern RTC_DATA_ATTR logRing;
+
+// Call right after Serial.begin; dumps what the previous session left if it
+// ended in a crash, or on request via LOG_DUMP_PIN
+void logBegin(int resetReason);
+// Prints and empties the ring
+void logDump();
+// Dumps if an error was logged during this wake
+void logFlush();
+
+// Serialises one record; use the LOG_* macros instead
+class LogRecordWriter {
+public:
+    LogRecordWriter(uint8_t level, uint8_t module, const char* format);
+
+    void add(const char* value);
+    void add(char* value) { add(static_cast<const char*>(value)); }
+    void add(const String& value) { add(value.c_str()); }
+    void add(float value) { addFloat(value); }
+    void add(double value) { addFloat(static_cast<float>(value)); }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type add(T value) {
+        addInteger(static_cast<int64_t>(value), std::is_signed<T>::value, sizeof(T) > 4);
+    }
+
+    template <typename T>
+    void add(T* value) { addPointer(value); }
+
+    void commit();
+
+private:
+    void addInteger(int64_t value, bool isSigned, bool wide);
+    void addFloat(float value);
+    void addPointer(const void* value);
+    bool reserve(size_t bytes);
+
+    uint8_t record[LOG_MAX_RECORD_BYTES];
+    size_t length;     // Bytes written so far
+    bool truncated;    // An argument did not fit, later ones are dropped too
+};
+
+inline void logPack(LogRecordWriter&) {}
+
+template <typename T, typename... Rest>
+inline void logPack(LogRecordWriter& writer, const T& value, const Rest&... rest) {
+    writer.add(value);
+    logPack(writer, rest...);
+}
+
+template <typename... Args>
+void logWrite(uint8_t level, uint8_t module, const char* format, const Args&... args) {
+    LogRecordWriter writer(level, module, format);
+    logPack(writer, args...);
+    writer.commit();
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <stdint.h>
+#include "config/sensors.hpp"
+
+// Compact identifier for every metric a sensor can produce.
+// Stored readings keep this ID instead of a pointer to the metric name.
+enum class MetricId : uint8_t {
+    TEMPERATURE,
+    HUMIDITY,
+    PRESSURE,
+    GAS,
+    SOIL_MOISTURE_RAW,
+    SOIL_MOISTURE_PERCENT,
+    BATTERY_VOLTAGE,
+    BATTERY_PERCENT,
+    BATTERY_TYPE,
+    WIFI_RSSI,
+    STORED_READINGS_COUNT,
+    STORED_BUCKETS_COUNT,
+    COUNT  // Number of metrics, not a metric
+};
+
+static const int METRIC_COUNT = static_cast<int>(MetricId::COUNT);
+
+const char* getMetricName(MetricId metric);
+SensorId getMetricSensor(MetricId metric);
+
+#endif
@@ -4,8 +4,60 @@
 #include <vector>
 #include "types.hpp"
 #include "globals.hpp"
+#include "spill_log.hpp"
+#include "upload_scheduler.hpp"
+
+// Where the data of an upload chunk comes from, oldest data first
+enum class ChunkSource : uint8_t {
+    NONE,
+    SPILL_LOG,
+    AGGREGATES,
+    RAW,
+    PROFILE                     // Wake profile histograms, see wake_profiler.hpp
+};
+
+// Chunk that has been assigned a sequence number but not acknowledged yet.
+// Retries, including ones after deep sleep, resend exactly this extent.
+struct PendingChunk {
+    uint32_t sequence;
+    ChunkSource source;
+    uint16_t items;             // Log records, buckets, raw readings or profiled wakes
+    uint16_t generation;        // Storage generation the extent was taken from
+    SpillLogPosition logStart;
+    SpillLogPosition logEnd;    // Fixed when the chunk is built, so a resend never grows
+    uint16_t logReadings;       // Readings between logStart and logEnd
+};
+
+struct UploadState {
+    uint32_t magic;
+    uint32_t nextSequence;
+    PendingChunk pending;
+} extern RTC_DATA_ATTR uploadState;
+
+// Association details and DHCP lease of the last full connection
+struct WiFiCache {
+    uint32_t magic;
+    uint8_t bssid[6];
+    int32_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    time_t leaseObtained;   // Fast path stops reusing the lease after WIFI_LEASE_REUSE_SECONDS
+} extern RTC_DATA_ATTR wifiCache;
+
+// Scheduler inputs that have to be remembered from earlier wakes
+struct UploadHistory {
+    uint16_t connectMs[CONNECT_HISTORY_SIZE];  // Recent WiFi connect times, failures as the timeout
+    uint8_t nextConnect;
+    uint8_t connectCount;
+    int8_t lastRssi;        // 0 until a reading was taken while connected
+    float batteryPercent;   // Negative until the first battery reading
+} extern RTC_DATA_ATTR uploadHistory;
 
 bool connectToWiFi();
+void observeReading(const SensorData& data);  // Keeps RSSI and battery level for the scheduler
+UploadInputs gatherUploadInputs();
 bool sendDataToAPI(const StoredReading readings[], int count);
 bool sendStoredReadings();
 
@@ -0,0 +1,77 @@
+#ifndef PAYLOAD_ENCODER_HPP
+#define PAYLOAD_ENCODER_HPP
+
+#include <Arduino.h>
+#include "types.hpp"
+#include "config.hpp"
+#include "json_writer.hpp"
+#include "cbor_writer.hpp"
+#include "wake_profiler.hpp"
+
+// Turns stored readings into an upload body, one item at a time
+class PayloadEncoder {
+public:
+    virtual ~PayloadEncoder() {}
+
+    virtual void begin() = 0;
+    virtual void writeBucket(const AggregateBucket& bucket) = 0;
+    virtual void writeReading(const StoredReading& reading) = 0;
+#if WAKE_PROFILER_ENABLED
+    virtual void writeProfile(const WakeProfile& profile) = 0;
+#endif
+    virtual void end() = 0;
+};
+
+// Array of self-describing data point objects
+class JsonPayloadEncoder : public PayloadEncoder {
+public:
+    JsonPayloadEncoder(Print& out, const char* deviceId);
+
+    void begin() override;
+    void writeBucket(const AggregateBucket& bucket) override;
+    void writeReading(const StoredReading& reading) override;
+#if WAKE_PROFILER_ENABLED
+    void writeProfile(const WakeProfile& profile) override;
+#endif
+    void end() override;
+
+private:
+    JsonStreamWriter json;
+    const char* deviceId;
+};
+
+// Compact binary schema, sections are written in key order:
+//   {0: version, 1: deviceId,
+//    2: [_ [start, span, (metricId, samples, mean, min, max)...]...],
+//    3: [_ [timestamp, (metricId, value)...]...],
+//    4: [_ [since, wakes, (phaseId, samples, totalMs, maxUs, [bucket counts])...]...]}
+// Timestamps are epoch seconds, values float32, metric IDs per MetricId,
+// phase IDs per WakePhase with buckets as described in config/profiling.hpp.
+class CborPayloadEncoder : public PayloadEncoder {
+public:
+    static const uint32_t SCHEMA_VERSION = 1;
+
+    CborPayloadEncoder(Print& out, const char* deviceId);
+
+    void begin() override;
+    void writeBucket(const AggregateBucket& bucket) override;
+    void writeReading(const StoredReading& reading) override;
+#if WAKE_PROFILER_ENABLED
+    void writeProfile(const WakeProfile& profile) override;
+#endif
+    void end() override;
+
+private:
+    enum Section : uint8_t { NONE, BUCKETS, READINGS, PROFILE };
+
+    void enterSection(Section next);
+
+    CborWriter cbor;
+    const char* deviceId;
+    Section section;
+};
+
+const char* getSensorString(SensorId sensorId);
+const char* getPayloadContentType(PayloadFormat format);
+
+#endif
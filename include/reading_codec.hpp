@@ -0,0 +1,68 @@
+#ifndef READING_CODEC_HPP
+#define READING_CODEC_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.hpp"
+
+// Packed reading layout (MSB first):
+//   timestamp  '0'                       previous interval repeated
+//              '10'  + 8 bit zigzag      small deviation from that interval
+//              '110' + 16 bit zigzag     larger deviation
+//              '111' + 32 bit absolute   first reading or clock jump
+//   metrics    '0'                       same metric set as the previous reading
+//              '1' + METRIC_COUNT bits   new metric set
+//   per value  '0'                       identical to the metric's previous value
+//              '10' + bits               XOR fits the previous leading/length window
+//              '11' + 5 bit leading zeros + 5 bit (length - 1) + bits
+const int MAX_ENCODED_READING_BITS =
+    (3 + 32) + (1 + METRIC_COUNT) + MAX_DATA_POINTS_PER_READING * (2 + 5 + 5 + 32);
+
+class BitWriter {
+public:
+    BitWriter(uint8_t* buffer, size_t capacityBytes, uint32_t startBit);
+
+    bool write(uint32_t value, uint8_t numBits);
+    uint32_t position() const { return bitPos; }
+
+private:
+    uint8_t* buffer;
+    uint32_t capacityBits;
+    uint32_t bitPos;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* buffer, uint32_t endBit, uint32_t startBit = 0);
+
+    bool read(uint8_t numBits, uint32_t& value);
+    uint32_t position() const { return bitPos; }
+
+private:
+    const uint8_t* buffer;
+    uint32_t endBit;
+    uint32_t bitPos;
+};
+
+void resetCodecState(ReadingCodecState& state);
+
+// Both return false when the buffer runs out; the state is then left untouched
+bool encodeReading(BitWriter& writer, ReadingCodecState& state,
+                   const SensorData& data, time_t timestamp);
+bool decodeReading(BitReader& reader, ReadingCodecState& state, StoredReading& reading);
+
+// Decodes the readings of a single packed block in order, leaving out
+// the block's already acknowledged leading readings
+class ReadingBlockDecoder {
+public:
+    ReadingBlockDecoder();
+    ReadingBlockDecoder(const ReadingBlock& block);
+    bool next(StoredReading& reading);
+
+private:
+    BitReader reader;
+    ReadingCodecState state;
+    int remaining;
+};
+
+#endif
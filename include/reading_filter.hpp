@@ -0,0 +1,30 @@
+#ifndef READING_FILTER_HPP
+#define READING_FILTER_HPP
+
+#include "esp_attr.h"
+#include "types.hpp"
+
+// Running statistics of one metric since it was last stored
+struct MetricWindow {
+    uint16_t count;         // Readings in the window, 0 if none yet
+    float mean;
+    float m2;               // Sum of squared deviations from the mean (Welford)
+    float min;
+    float max;
+    float lastStored;       // Value the deadband is measured from
+    uint32_t lastStoredAt;  // Epoch seconds of the last stored point
+    bool stored;            // Whether the metric was ever stored
+};
+
+struct ReadingFilterState {
+    MetricWindow windows[METRIC_COUNT];
+} extern RTC_DATA_ATTR readingFilter;
+
+// Folds every point of a reading into its window and copies the points that
+// should be stored into out. Returns false if nothing is left to store.
+bool filterReading(const SensorData& data, time_t now, SensorData& out);
+
+// Sample variance of the window, 0 below two readings
+float windowVariance(const MetricWindow& window);
+
+#endif
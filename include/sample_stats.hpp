@@ -0,0 +1,21 @@
+#ifndef SAMPLE_STATS_HPP
+#define SAMPLE_STATS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Robust summary of a burst of ADC samples
+struct SampleStats {
+    size_t count;
+    float median;
+    float trimmedMean;   // Mean after dropping the trimmed fraction at both ends
+    float variance;      // Sample variance over all samples, a measure of noise
+    uint16_t min;
+    uint16_t max;
+};
+
+// Sorts samples in place. trimFraction (0..0.5) of the samples is dropped
+// from each end for the trimmed mean. Returns false for an empty burst.
+bool computeSampleStats(uint16_t* samples, size_t count, float trimFraction, SampleStats& stats);
+
+#endif
@@ -1,28 +1,19 @@
 #ifndef SENSOR_HPP
 #define SENSOR_HPP
 
-#include <Adafruit_BME680.h>
 #include "types.hpp"
-#include "config.hpp"
+#include "sensor_drivers.hpp"
+#include "sensor_registry.hpp"
+
+typedef SensorRegistry<ActiveSensors> ActiveSensorRegistry;
 
 class SensorManager {
 public:
     static bool initialize();
-    static SensorData readAll();
-    
-private:
-    static bool initializeBME680();
-    static bool initializeSoilMoisture();
-    static bool initializeBatteryMetrics();
-    static bool initializeNetworkMetrics();
-    static SensorData readBME680();
-    static SensorData readSoilMoisture();
-    static SensorData readBatteryMetrics();
-    static SensorData readNetworkMetrics();
-    static void combineSensorData(SensorData& target, const SensorData& source);
-    
-    static Adafruit_BME680 bme;
-    static bool sensorInitialized[MAX_ACTIVE_SENSORS];
+    static void readAll(SensorData& data);
+    // Runs the drivers' complete() hooks. Called by the task that stores
+    // the reading, which owns storage and the link at that point.
+    static void completeReading(SensorData& data);
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -0,0 +1,73 @@
+#ifndef SENSOR_DRIVER_HPP
+#define SENSOR_DRIVER_HPP
+
+#include <stdint.h>
+#include "metrics.hpp"
+#include "config/sensors.hpp"
+
+struct DataPoint;
+
+// Bit for every metric in the list, used to catch metrics emitted twice
+template <MetricId... Metrics>
+struct MetricMask;
+
+template <>
+struct MetricMask<> {
+    static const uint32_t value = 0;
+};
+
+template <MetricId First, MetricId... Rest>
+struct MetricMask<First, Rest...> {
+    static_assert((MetricMask<Rest...>::value & (1UL << static_cast<int>(First))) == 0,
+                  "A sensor lists the same metric twice");
+    static const uint32_t value = (1UL << static_cast<int>(First)) | MetricMask<Rest...>::value;
+};
+
+// Base for sensor drivers. A driver lists the metrics it produces, in order,
+// and provides:
+//   static bool initialize();
+//   static bool start(unsigned long& readyAt);   // Kick off a measurement, readyAt in millis()
+//   static bool read(DataPoint* points);         // Fill points[i].value for METRICS[i]
+// A metric the sensor could not measure this time is set to NAN by read()
+// and left out of the reading, the sensor's other metrics are kept.
+//
+// Values that depend on the rest of the wake (the link, stored data) are
+// filled in by complete(), called by the task that stores the reading. It
+// gets the driver's points that made it into the reading, in METRICS order.
+template <SensorId Id, MetricId... Metrics>
+struct SensorDriver {
+    static const SensorId ID = Id;
+    static const int DATA_POINTS = sizeof...(Metrics);
+    static const uint32_t METRIC_MASK = MetricMask<Metrics...>::value;
+    static const MetricId METRICS[DATA_POINTS];
+
+    static void complete(DataPoint*, int) {}
+};
+
+template <SensorId Id, MetricId... Metrics>
+const MetricId SensorDriver<Id, Metrics...>::METRICS[] = {Metrics...};
+
+// Sensor of every metric, taken from the drivers' metric lists
+template <typename List>
+struct MetricSensors;
+
+template <>
+struct MetricSensors<SensorList<>> {
+    static const uint32_t METRIC_MASK = 0;
+
+    static SensorId find(MetricId) { return static_cast<SensorId>(0); }  // Reported as "unknown"
+};
+
+template <typename Driver, typename... Rest>
+struct MetricSensors<SensorList<Driver, Rest...>> {
+    typedef MetricSensors<SensorList<Rest...>> Next;
+
+    static_assert((Driver::METRIC_MASK & Next::METRIC_MASK) == 0, "Two sensors produce the same metric");
+    static const uint32_t METRIC_MASK = Driver::METRIC_MASK | Next::METRIC_MASK;
+
+    static SensorId find(MetricId metric) {
+        return (Driver::METRIC_MASK >> static_cast<int>(metric)) & 1 ? Driver::ID : Next::find(metric);
+    }
+};
+
+#endif
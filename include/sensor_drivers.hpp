@@ -0,0 +1,42 @@
+#ifndef SENSOR_DRIVERS_HPP
+#define SENSOR_DRIVERS_HPP
+
+#include "sensor_driver.hpp"
+#include "config/sensors.hpp"
+
+// Each driver is only referenced through ActiveSensors, so disabled drivers
+// are dropped by the linker
+
+struct Bme680Driver : SensorDriver<SensorId::BME680,
+                                   MetricId::TEMPERATURE, MetricId::HUMIDITY,
+                                   MetricId::PRESSURE, MetricId::GAS> {
+    static bool initialize();
+    static bool start(unsigned long& readyAt);
+    static bool read(DataPoint* points);
+};
+
+struct SoilMoistureDriver : SensorDriver<SensorId::SOIL_MOISTURE,
+                                         MetricId::SOIL_MOISTURE_RAW, MetricId::SOIL_MOISTURE_PERCENT> {
+    static bool initialize();
+    static bool start(unsigned long& readyAt);
+    static bool read(DataPoint* points);
+};
+
+struct BatteryDriver : SensorDriver<SensorId::BATTERY,
+                                    MetricId::BATTERY_VOLTAGE, MetricId::BATTERY_PERCENT,
+                                    MetricId::BATTERY_TYPE> {
+    static bool initialize();
+    static bool start(unsigned long& readyAt);
+    static bool read(DataPoint* points);
+};
+
+struct NetworkMetricsDriver : SensorDriver<SensorId::NETWORK,
+                                           MetricId::WIFI_RSSI, MetricId::STORED_READINGS_COUNT,
+                                           MetricId::STORED_BUCKETS_COUNT> {
+    static bool initialize();
+    static bool start(unsigned long& readyAt);
+    static bool read(DataPoint* points);
+    static void complete(DataPoint* points, int count);
+};
+
+#endif
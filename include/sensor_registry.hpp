@@ -0,0 +1,203 @@
+#ifndef SENSOR_REGISTRY_HPP
+#define SENSOR_REGISTRY_HPP
+
+#include <Arduino.h>
+#include <limits.h>
+#include <math.h>
+#include "types.hpp"
+#include "payload_encoder.hpp"
+#include "logging.hpp"
+#include "sensor_driver.hpp"
+
+// Per-sensor bookkeeping while a reading is in progress
+struct SensorProgress {
+    bool ready;        // Initialised successfully
+    bool pending;      // Started, waiting for read()
+    bool succeeded;
+    bool partial;      // Succeeded with some points set to NAN
+    unsigned long startedAt;
+    unsigned long readyAt;
+    unsigned long finishedAt;
+};
+
+// Unrolled per-sensor steps. Offset is where the sensor's points start in the
+// reading, Index its position in the list.
+template <int Offset, int Index, typename... Drivers>
+struct SensorSlots {
+    static const int DATA_POINTS = 0;
+    static const uint32_t METRIC_MASK = 0;
+
+    static bool initialize(SensorProgress*) { return true; }
+    static void start(SensorProgress*, DataPoint*) {}
+    static bool poll(SensorProgress*, DataPoint*, unsigned long&) { return false; }
+    static int compact(const SensorProgress*, DataPoint*, int count) { return count; }
+    static void complete(DataPoint*, int) {}
+    static void report(const SensorProgress*) {}
+};
+
+template <int Offset, int Index, typename Driver, typename... Rest>
+struct SensorSlots<Offset, Index, Driver, Rest...> {
+    typedef SensorSlots<Offset + Driver::DATA_POINTS, Index + 1, Rest...> Next;
+
+    static_assert((Driver::METRIC_MASK & Next::METRIC_MASK) == 0,
+                  "Two active sensors produce the same metric");
+    static const int DATA_POINTS = Driver::DATA_POINTS + Next::DATA_POINTS;
+    static const uint32_t METRIC_MASK = Driver::METRIC_MASK | Next::METRIC_MASK;
+
+    static bool initialize(SensorProgress* progress) {
+        progress[Index].ready = Driver::initialize();
+        if (!progress[Index].ready) {
+            LOG_ERROR(SENSOR, "Failed to initialize sensor %s", getSensorString(Driver::ID));
+        }
+        return Next::initialize(progress) && progress[Index].ready;
+    }
+
+    static void start(SensorProgress* progress, DataPoint* points) {
+        SensorProgress& sensor = progress[Index];
+        for (int i = 0; i < Driver::DATA_POINTS; i++) {
+            points[Offset + i] = {Driver::METRICS[i], 0.0f};
+        }
+
+        sensor.startedAt = millis();
+        sensor.finishedAt = sensor.startedAt;
+        sensor.readyAt = sensor.startedAt;
+        sensor.succeeded = false;
+        sensor.partial = false;
+        sensor.pending = sensor.ready && Driver::start(sensor.readyAt);
+        Next::start(progress, points);
+    }
+
+    // Reads the sensor if it is due, otherwise folds its deadline into nextDue.
+    // Returns whether any sensor is still pending.
+    static bool poll(SensorProgress* progress, DataPoint* points, unsigned long& nextDue) {
+        SensorProgress& sensor = progress[Index];
+        bool waiting = false;
+
+        if (sensor.pending && static_cast<long>(millis() - sensor.readyAt) >= 0) {
+            sensor.succeeded = Driver::read(points + Offset);
+            for (int i = 0; i < Driver::DATA_POINTS && sensor.succeeded; i++) {
+                if (isnan(points[Offset + i].value)) sensor.partial = true;
+            }
+            sensor.pending = false;
+            sensor.finishedAt = millis();
+        } else if (sensor.pending) {
+            waiting = true;
+        }
+
+        const bool othersWaiting = Next::poll(progress, points, nextDue);
+        if (waiting && (!othersWaiting || static_cast<long>(sensor.readyAt - nextDue) < 0)) {
+            nextDue = sensor.readyAt;
+        }
+        return waiting || othersWaiting;
+    }
+
+    // Drops the slots of sensors that failed and unmeasured points, keeping the others in order
+    static int compact(const SensorProgress* progress, DataPoint* points, int count) {
+        if (progress[Index].succeeded) {
+            for (int i = 0; i < Driver::DATA_POINTS; i++) {
+                if (!isnan(points[Offset + i].value)) points[count++] = points[Offset + i];
+            }
+        }
+        return Next::compact(progress, points, count);
+    }
+
+    // Hands the driver its points, which compaction keeps together and in order
+    static void complete(DataPoint* points, int count) {
+        int first = 0;
+        while (first < count && !((Driver::METRIC_MASK >> static_cast<int>(points[first].metric)) & 1)) first++;
+        int last = first;
+        while (last < count && ((Driver::METRIC_MASK >> static_cast<int>(points[last].metric)) & 1)) last++;
+        if (last > first) Driver::complete(points + first, last - first);
+        Next::complete(points, count);
+    }
+
+    static void report(const SensorProgress* progress) {
+        LOG_DEBUG(SENSOR, "Acquisition latency - %s: %lu ms", getSensorString(Driver::ID),
+                  progress[Index].finishedAt - progress[Index].startedAt);
+        Next::report(progress);
+    }
+};
+
+template <typename List>
+class SensorRegistry;
+
+// Everything about the active sensors that can be known at compile time:
+// the data point layout, the metric set and the order sensors are serviced in
+template <typename... Drivers>
+class SensorRegistry<SensorList<Drivers...>> {
+    typedef SensorSlots<0, 0, Drivers...> Slots;
+
+public:
+    static const int SENSOR_COUNT = sizeof...(Drivers);
+    static const int DATA_POINTS = Slots::DATA_POINTS;
+    static const uint32_t METRIC_MASK = Slots::METRIC_MASK;
+    static const SensorId SENSORS[SENSOR_COUNT];
+
+    static_assert(SENSOR_COUNT > 0, "No active sensors configured");
+    static_assert(DATA_POINTS <= MAX_DATA_POINTS_PER_READING,
+                  "Active sensors produce more data points than MAX_DATA_POINTS_PER_READING");
+    static_assert(METRIC_COUNT <= 32, "METRIC_MASK holds at most 32 metrics");
+
+    static bool initialize() {
+        return Slots::initialize(progress);
+    }
+
+    // Starts every sensor, then reads each one as it becomes ready so slow
+    // conversions overlap. Points are written straight into data. Sensors
+    // still pending after timeoutMs are left out like failed ones. Returns
+    // whether every sensor delivered.
+    static bool read(SensorData& data, unsigned long timeoutMs = ULONG_MAX) {
+        const unsigned long startTime = millis();
+        Slots::start(progress, data.dataPoints);
+
+        unsigned long nextDue = 0;
+        while (Slots::poll(progress, data.dataPoints, nextDue)) {
+            const unsigned long elapsed = millis() - startTime;
+            if (elapsed >= timeoutMs) {
+                LOG_WARN(SENSOR, "Sensors still pending after %lu ms, left out", elapsed);
+                break;
+            }
+            long wait = static_cast<long>(nextDue - millis());
+            if (wait > static_cast<long>(timeoutMs - elapsed)) wait = static_cast<long>(timeoutMs - elapsed);
+            if (wait > 0) delay(wait);
+        }
+
+        const bool complete = allSucceeded();
+        data.numDataPoints = DATA_POINTS;
+        if (!complete || anyPartial()) data.numDataPoints = Slots::compact(progress, data.dataPoints, 0);
+
+        Slots::report(progress);
+        LOG_INFO(SENSOR, "Acquisition latency - total: %lu ms", millis() - startTime);
+        return complete;
+    }
+
+    // Runs the drivers' complete() hooks on a reading from read()
+    static void complete(SensorData& data) {
+        Slots::complete(data.dataPoints, data.numDataPoints);
+    }
+
+private:
+    static bool allSucceeded() {
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            if (!progress[i].succeeded) return false;
+        }
+        return true;
+    }
+
+    static bool anyPartial() {
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            if (progress[i].partial) return true;
+        }
+        return false;
+    }
+
+    static SensorProgress progress[SENSOR_COUNT];
+};
+
+template <typename... Drivers>
+const SensorId SensorRegistry<SensorList<Drivers...>>::SENSORS[] = {Drivers::ID...};
+
+template <typename... Drivers>
+SensorProgress SensorRegistry<SensorList<Drivers...>>::progress[SENSOR_COUNT];
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SPILL_LOG_HPP
+#define SPILL_LOG_HPP
+
+#include <stdio.h>
+#include "types.hpp"
+#include "config.hpp"
+
+// Location of a record in the append-only segment log
+struct SpillLogPosition {
+    uint32_t segment;
+    uint16_t record;
+};
+
+// Log bookkeeping cached in RTC memory, rebuilt from flash after power loss
+struct SpillLogState {
+    uint32_t magic;              // SPILL_LOG_MAGIC once the state is valid
+    SpillLogPosition cursor;     // Next record to upload
+    uint32_t headSegment;        // Segment currently appended to
+    uint16_t headRecords;
+    uint32_t nextSequence;
+    int pendingReadings;
+    int pendingRecords;          // From the cursor on; sealed segments may be short
+} extern RTC_DATA_ATTR spillLogState;
+
+// Pass false after anything but a deep sleep wake to rescan the log on flash
+bool spillLogBegin(bool trustCachedState, const char* directory = SPILL_LOG_DIR);
+bool spillLogAppend(const ReadingBlock& block);
+bool spillLogFlush();
+int spillLogPendingRecords();
+int spillLogPendingReadings();
+// Marks everything before position as uploaded and deletes consumed segments
+bool spillLogCommit(const SpillLogPosition& position, int readingsConsumed);
+
+// Reads records from the upload cursor onwards, skipping torn or corrupt ones
+class SpillLogReader {
+public:
+    SpillLogReader();
+    ~SpillLogReader();
+
+    bool next(ReadingBlock& block);
+    SpillLogPosition position() const { return pos; }
+    int readingsRead() const { return readings; }
+
+private:
+    FILE* file;
+    SpillLogPosition pos;
+    int readings;
+};
+
+#endif
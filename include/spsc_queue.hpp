@@ -0,0 +1,41 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <stddef.h>
+
+// Lock-free ring for exactly one producer and one consumer, which may run
+// on different cores. Holds up to Capacity - 1 items.
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer side only
+    bool push(const T& item) {
+        const size_t current = tail.load(std::memory_order_relaxed);
+        const size_t next = (current + 1) % Capacity;
+        if (next == head.load(std::memory_order_acquire)) return false;  // Full
+
+        items[current] = item;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side only
+    bool pop(T& item) {
+        const size_t current = head.load(std::memory_order_relaxed);
+        if (current == tail.load(std::memory_order_acquire)) return false;  // Empty
+
+        item = items[current];
+        head.store((current + 1) % Capacity, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[Capacity];
+    std::atomic<size_t> head;  // Next item to pop, written by the consumer
+    std::atomic<size_t> tail;  // Next free slot, written by the producer
+};
+
+#endif
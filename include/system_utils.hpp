@@ -8,6 +8,8 @@
 #include "esp_sleep.h"
 
 void goToSleep();
-void enterErrorState();
+// Arms the wake-up timer and sleeps, without logging or shutting down WiFi;
+// also used by the wake deadline timer. The caller must have claimed sleep.
+void enterDeepSleep(uint64_t sleepUs);
 
 #endif
\ No newline at end of file
@@ -10,23 +10,33 @@ struct TimeState {
     time_t lastKnownTime;
     time_t lastSuccessfulSync;
     bool isNight;
-    int wakeCyclesPerNight;
-    int nightWakeCyclesCounter;
     bool timeInitialized;
-} extern RTC_DATA_ATTR timeState;
 
-// Constants for time calculations
-static const int HOURS_IN_DAY = 24;
-static const int NIGHT_DURATION = (HOURS_IN_DAY - NIGHT_START_HOUR) + NIGHT_END_HOUR;
-static const time_t MAX_TIME_WITHOUT_SYNC = 24 * 60 * 60; // 24 hours in seconds
+    // The system clock keeps running through deep sleep on the RTC
+    // oscillator; each wake corrects the slept span by the learned drift
+    int64_t sleepStartUs;        // Clock when the last wake went to sleep, 0 if it did not
+    float driftPpm;              // Actual minus counted sleep, per million counted
+    float driftErrorPpm;         // Largest recent miss of the estimate, halves per observation
+    uint8_t driftSamples;        // Observations the estimate is based on
+    uint32_t uncertaintyUs;      // Bound on the clock error
+    uint64_t sleptSinceLearnUs;  // Counted sleep since drift was last learned
+    int64_t errorSinceLearnUs;   // Clock steps at NTP syncs over that span
+
+    // Wakes are aimed so setup() starts on the schedule grid
+    int64_t scheduledWakeUs;     // Slot the last sleep was aimed at, 0 if none
+    uint32_t bootLatencyUs;      // Timer wake-up to the clock correction in setup()
+} extern RTC_DATA_ATTR timeState;
 
 // Time management functions
 bool initializeTime();
-bool isNightTime();
 void updateTime();
 bool isStateValid();
-void calculateNightCycles();
 void handleTimeSync();
 void updateTimeAfterSleep();
+// Picks the next grid-aligned slot and returns the timer duration that
+// reaches it, net of the time already spent awake and the boot latency
+uint64_t scheduleNextWake();
+void recordTimeBeforeSleep();
+bool isTimeSyncDue();
 
 #endif 
\ No newline at end of file
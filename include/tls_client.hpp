@@ -0,0 +1,67 @@
+#ifndef TLS_CLIENT_HPP
+#define TLS_CLIENT_HPP
+
+#include <Arduino.h>
+#include <Client.h>
+#include <WiFi.h>
+#include "mbedtls/ssl.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "config.hpp"
+
+// Last negotiated TLS session, offered again on the next connection so a
+// wake can resume it instead of paying for a full handshake
+struct TlsSessionCache {
+    uint32_t hostHash;   // Session is only offered to the host it came from
+    uint16_t length;     // 0 when empty
+    uint8_t data[TLS_SESSION_CACHE_BYTES];
+    uint32_t crc;        // Over all fields above
+} extern RTC_DATA_ATTR tlsSessionCache;
+
+// TLS over a WiFiClient using mbedtls directly. WiFiClientSecure runs the
+// handshake inside connect() and has no way to inject a saved session.
+// Like the previous setInsecure() client, the server certificate is not verified.
+class TlsClient : public Client {
+public:
+    TlsClient();
+    ~TlsClient();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+    // Details of the most recent handshake
+    unsigned long handshakeMillis() const { return handshakeTime; }
+    bool offeredSession() const { return sessionOffered; }
+
+private:
+    bool setup(const char* host);
+    bool handshake();
+    void saveSession(const char* host);
+    void release();
+
+    static int sendCallback(void* context, const unsigned char* data, size_t size);
+    static int receiveCallback(void* context, unsigned char* buffer, size_t size);
+
+    WiFiClient tcp;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config config;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+    bool initialized;
+    bool open;
+    int peeked;          // Byte read ahead by peek()/available(), -1 if none
+    unsigned long handshakeTime;
+    bool sessionOffered;
+};
+
+#endif
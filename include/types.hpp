@@ -3,20 +3,18 @@
 
 #include <time.h>
 #include "esp_sleep.h"
+#include "metrics.hpp"
+#include "config/storage.hpp"
 
 // Single data point with type and value
 struct DataPoint {
-    const char* type;  // Name/type of the reading
+    MetricId metric;  // Name and sensor are looked up from the metric ID
     float value;
-    uint8_t sensorId; // Use an ID instead of string to save memory
 };
 
 // Maximum number of different readings a sensor can have
 const int MAX_DATA_POINTS_PER_READING = 10;
 
-// Maximum number of readings that can be stored
-const int MAX_READINGS = 24; // Reduced from whatever it was before to save RTC memory
-
 // A complete reading with multiple data points and metadata
 struct StoredReading {
     DataPoint dataPoints[MAX_DATA_POINTS_PER_READING];
@@ -30,10 +28,60 @@ struct SensorData {
     int numDataPoints;
 };
 
-// Buffer for storing multiple readings
+// Previous-value state the packed encoding is delta/XOR coded against
+struct ReadingCodecState {
+    uint32_t lastTimestamp;
+    int32_t lastInterval;     // Between the last two readings, 0 before the second
+    uint16_t lastMetricMask;
+    uint32_t lastValueBits[METRIC_COUNT];
+    uint8_t lastLeadingZeros[METRIC_COUNT];
+    uint8_t lastMeaningfulBits[METRIC_COUNT];
+};
+
+// Bit-packed run of readings, decodable on its own
+struct ReadingBlock {
+    uint8_t data[RAW_BLOCK_BYTES];
+    uint16_t bitsUsed;
+    uint16_t count;   // Readings encoded in data
+    uint16_t skip;    // Leading readings already acknowledged by the server
+};
+
+// Decimated statistics for one metric within a bucket
+struct AggregateValue {
+    MetricId metric;
+    uint16_t samples;
+    float mean;
+    float min;
+    float max;
+};
+
+// All readings that fell into [start, start + span)
+struct AggregateBucket {
+    uint32_t start;
+    uint32_t span;
+    uint16_t readings;
+    uint8_t numValues;
+    AggregateValue values[MAX_DATA_POINTS_PER_READING];
+};
+
+// Ring of buckets sharing the same span
+struct AggregateTier {
+    AggregateBucket buckets[AGGREGATE_BUCKETS_PER_TIER];
+    uint8_t head;   // Oldest bucket
+    uint8_t count;
+};
+
+// Ring of packed raw readings plus their decimated history
 struct StoredReadingsBuffer {
-    StoredReading readings[MAX_READINGS];
-    int count;
+    ReadingBlock blocks[RAW_BLOCK_COUNT];
+    uint8_t headBlock;   // Oldest block
+    uint8_t numBlocks;   // Blocks in use, the newest one is appended to
+    int count;           // Unacknowledged raw readings across all blocks
+    ReadingCodecState encoder;  // State after the last reading in the newest block
+    AggregateTier tiers[AGGREGATE_TIER_COUNT];
+    uint16_t headGeneration;    // Bumped whenever readings leave the front of the ring
+    uint16_t bucketGeneration;  // Bumped whenever any aggregate bucket changes
+    time_t oldestUnsent;        // Time of the oldest reading not yet acknowledged
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -0,0 +1,67 @@
+#ifndef UPLOAD_SCHEDULER_HPP
+#define UPLOAD_SCHEDULER_HPP
+
+#include <stdint.h>
+#include "config/network.hpp"
+
+// Everything a scheduler may base its decision on. Filled in by
+// gatherUploadInputs() on the device, or by hand on a host.
+struct UploadInputs {
+    float storageFill;            // 0..1 of the lossless buffer capacity
+    uint32_t oldestAgeSeconds;    // Age of the oldest unsent reading, 0 if none
+    int pendingReadings;
+    int lastRssi;                 // dBm from the last reading taken while connected, 0 if unknown
+    float batteryPercent;         // From the last reading, negative if unknown
+    uint32_t expectedConnectMs;   // From recent connect times, 0 if no history yet
+    uint32_t wakeIntervalSeconds;
+    bool isNight;
+};
+
+struct UploadDecision {
+    bool upload;
+    float readingsPerRadioSecond;  // Expected efficiency of uploading now
+    const char* reason;
+};
+
+// Decides once per wake whether the radio should be turned on.
+// Implementations must be pure functions of their inputs.
+class UploadScheduler {
+public:
+    virtual ~UploadScheduler() {}
+    virtual UploadDecision decide(const UploadInputs& inputs) const = 0;
+};
+
+// Original rule: any backlog during the day, or a nearly full buffer
+class FixedRuleScheduler : public UploadScheduler {
+public:
+    UploadDecision decide(const UploadInputs& inputs) const override;
+};
+
+// Waits until an upload carries enough readings per radio-on second, but
+// never lets the oldest reading get older than the latency bound
+class CostModelScheduler : public UploadScheduler {
+public:
+    struct Parameters {
+        uint32_t maxLatencySeconds;
+        float fillThreshold;             // Upload regardless of cost above this fill
+        float targetReadingsPerSecond;   // At full battery
+        uint32_t defaultConnectMs;       // Until connect times have been measured
+        float msPerReading;              // Transfer time per reading once connected
+        float lowBatteryPercent;         // Below this the latency bound is stretched
+        float lowBatteryLatencyFactor;
+    };
+
+    CostModelScheduler();
+    explicit CostModelScheduler(const Parameters& parameters);
+
+    UploadDecision decide(const UploadInputs& inputs) const override;
+    float estimateRadioMs(const UploadInputs& inputs) const;
+
+private:
+    Parameters params;
+};
+
+// The scheduler selected by UPLOAD_SCHEDULER
+const UploadScheduler& getUploadScheduler();
+
+#endif
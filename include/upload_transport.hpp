@@ -0,0 +1,41 @@
+#ifndef UPLOAD_TRANSPORT_HPP
+#define UPLOAD_TRANSPORT_HPP
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "http_stream.hpp"
+#include "tls_client.hpp"
+
+// Owns the connection to the ingest endpoint for one wake. Retries and
+// chunks reuse it while the server keeps it open.
+class UploadTransport {
+public:
+    UploadTransport();
+
+    // Connected client for url, nullptr on failure. reused tells whether an
+    // already open connection was handed out.
+    Client* connect(const ParsedUrl& url, bool& reused);
+    // Closes the connection unless the last response allows another request
+    void release(bool keepAlive);
+    void stop();
+
+    // Per-wake connection statistics
+    void report() const;
+
+private:
+    bool isOpenFor(const ParsedUrl& url);
+
+    WiFiClient plainClient;
+    TlsClient secureClient;
+    Client* active;
+    char host[sizeof(ParsedUrl::host)];
+    uint16_t port;
+
+    int connections;
+    int requests;
+    int sessionsOffered;
+    unsigned long setupMillis;      // TCP connect plus TLS handshake
+    unsigned long handshakeMillis;  // TLS handshake only
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef WAKE_DEADLINE_HPP
+#define WAKE_DEADLINE_HPP
+
+#include <stdint.h>
+#include "esp_attr.h"
+#include "wake_profiler.hpp"
+
+// Failures kept across wakes. A phase that runs out of time or gives up
+// degrades the reading or defers the upload; the device always sleeps again.
+struct WakeHealth {
+    uint16_t overruns[WAKE_PHASE_COUNT];   // Used up their budget
+    uint16_t failures[WAKE_PHASE_COUNT];   // Gave up, e.g. no access point or sensor
+    uint16_t deadlineWakes;                // Ended by the deadline timer
+    uint16_t deadlinePhases;               // Phases running when it last fired, one bit per WakePhase
+    bool cutShort;                         // The previous wake was ended by the timer
+} extern RTC_DATA_ATTR wakeHealth;
+
+// Arms the timer that ends the wake WAKE_DEADLINE_MS after boot
+void wakeDeadlineBegin();
+// Waits until no task holds a SleepGuard and keeps new ones from starting.
+// The caller may then put the chip to sleep; a caller that loses the race
+// to the deadline timer never returns.
+void claimSleep();
+// Time left before the reserve for going to sleep, 0 once it is reached
+uint32_t wakeRemainingMs();
+void recordPhaseFailure(WakePhase phase);
+
+// Budget of a phase for the lifetime of the enclosing scope. Blocking waits
+// in the phase are shortened with limit(), loops stop once expired().
+class PhaseBudget {
+public:
+    explicit PhaseBudget(WakePhase phase);
+    ~PhaseBudget();
+
+    // Until the phase's budget or the wake's time ends, whichever is first
+    uint32_t remainingMs() const;
+    bool expired() const { return remainingMs() == 0; }
+    uint32_t limit(uint32_t timeoutMs) const;
+
+private:
+    PhaseBudget(const PhaseBudget&);
+    PhaseBudget& operator=(const PhaseBudget&);
+
+    WakePhase phase;
+    int64_t start;
+    int64_t deadlineUs;
+};
+
+// Held while RTC or flash state is being changed, so the wake is never put
+// to sleep halfway through. Guarded sections are short, never wait on the
+// network and do not nest. A task that asks for one after sleep was claimed
+// is parked; its change waits for the next wake.
+class SleepGuard {
+public:
+    SleepGuard();
+    ~SleepGuard();
+
+private:
+    SleepGuard(const SleepGuard&);
+    SleepGuard& operator=(const SleepGuard&);
+};
+
+#endif
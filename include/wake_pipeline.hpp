@@ -0,0 +1,10 @@
+#ifndef WAKE_PIPELINE_HPP
+#define WAKE_PIPELINE_HPP
+
+// Runs an upload wake with WiFi, time sync and uploading on the network
+// core while the calling task initialises and reads the sensors. The
+// network task is the only one touching storage until it finishes.
+// Returns false if the network task could not be started.
+bool runPipelinedWake();
+
+#endif
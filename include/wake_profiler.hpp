@@ -0,0 +1,85 @@
+#ifndef WAKE_PROFILER_HPP
+#define WAKE_PROFILER_HPP
+
+#include <Arduino.h>
+#include <time.h>
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "config/profiling.hpp"
+
+// Parts of a wake that are timed separately. Phases can nest (a time sync
+// may reconnect WiFi) and, in a pipelined wake, overlap across cores.
+enum class WakePhase : uint8_t {
+    BOOT,            // Startup until setup() runs
+    SERIAL_SETTLE,   // Serial.begin to logBegin, includes any log dump
+    WIFI_CONNECT,
+    TIME_SYNC,
+    SENSOR_INIT,
+    SENSOR_READ,
+    STORE,
+    UPLOAD,
+    AWAKE,           // Startup until deep sleep, one sample per wake
+    COUNT  // Number of phases, not a phase
+};
+
+static const int WAKE_PHASE_COUNT = static_cast<int>(WakePhase::COUNT);
+
+const char* getWakePhaseName(WakePhase phase);
+
+#if WAKE_PROFILER_ENABLED
+
+// Durations of one phase, bucketed by half octaves of microseconds
+struct PhaseHistogram {
+    uint16_t buckets[PROFILE_HISTOGRAM_BUCKETS];
+    uint16_t samples;   // Saturates, later samples are dropped
+    uint32_t maxUs;
+    uint64_t totalUs;
+};
+
+// Each phase is only recorded by one task at a time, so no locking is needed
+struct WakeProfile {
+    uint32_t magic;
+    uint16_t wakes;     // Wakes recorded since the last upload
+    time_t since;       // Time the first of them started, 0 if unknown
+    PhaseHistogram phases[WAKE_PHASE_COUNT];
+} extern RTC_DATA_ATTR wakeProfile;
+
+void profilerBegin();        // First thing in setup(), records BOOT
+void profilerFinishWake();   // Just before deep sleep, records AWAKE
+void profilerRecord(WakePhase phase, uint32_t us);
+bool isProfileUploadDue();
+void clearWakeProfile();
+
+// Lower bound of a bucket in microseconds
+uint32_t profileBucketStartUs(int bucket);
+// Estimate from the bucket counts, interpolated within the bucket
+float profilePercentileMs(const PhaseHistogram& histogram, float fraction);
+
+// Records the lifetime of the enclosing scope as one sample of phase
+class PhaseTimer {
+public:
+    explicit PhaseTimer(WakePhase phase) : phase(phase), start(esp_timer_get_time()) {}
+    ~PhaseTimer() { profilerRecord(phase, static_cast<uint32_t>(esp_timer_get_time() - start)); }
+
+private:
+    PhaseTimer(const PhaseTimer&);
+    PhaseTimer& operator=(const PhaseTimer&);
+
+    WakePhase phase;
+    int64_t start;
+};
+
+#define PROFILE_PHASE_CONCAT_(a, b) a##b
+#define PROFILE_PHASE_CONCAT(a, b) PROFILE_PHASE_CONCAT_(a, b)
+#define PROFILE_PHASE(phase) PhaseTimer PROFILE_PHASE_CONCAT(phaseTimer, __LINE__)(WakePhase::phase)
+
+#else
+
+#define PROFILE_PHASE(phase) ((void)0)
+
+inline void profilerBegin() {}
+inline void profilerFinishWake() {}
+
+#endif
+
+#endif
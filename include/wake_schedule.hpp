@@ -0,0 +1,19 @@
+#ifndef WAKE_SCHEDULE_HPP
+#define WAKE_SCHEDULE_HPP
+
+#include <stdint.h>
+#include <time.h>
+#include "config/time.hpp"
+
+// Where a moment falls in SCHEDULE_WINDOWS
+struct ScheduleSlot {
+    time_t nextWake;            // First grid instant after the queried time, or window start
+    uint32_t intervalSeconds;   // Cadence of the window the queried time is in
+    bool night;
+};
+
+// Pure function of the epoch time and the configured windows. With a stride
+// above 1 the grid is stride intervals wide (see CADENCE_LIMITS).
+ScheduleSlot querySchedule(time_t now, uint32_t stride = 1);
+
+#endif
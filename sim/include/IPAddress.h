@@ -0,0 +1,21 @@
+#ifndef SIM_IPADDRESS_H
+#define SIM_IPADDRESS_H
+
+#include "Arduino.h"
+
+class IPAddress {
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint32_t address) : address(address) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : address(a | (b << 8) | (c << 16) | (static_cast<uint32_t>(d) << 24)) {}
+    operator uint32_t() const { return address; }
+    String toString() const;
+
+private:
+    uint32_t address;
+};
+
+#define INADDR_NONE IPAddress(0u)
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include "Arduino.h"
+
+// I2C master. Transfers take bus time at 100 kHz; only the BME680 address
+// acknowledges, and it does so only when the scenario has the sensor.
+class TwoWire {
+public:
+    TwoWire() : address(0), bytes(0), toRead(0) {}
+
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* data, size_t length);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t length, bool sendStop = true);
+    int available() { return toRead; }
+    int read();
+
+private:
+    uint8_t address;
+    size_t bytes;      // Queued by write() since beginTransmission()
+    int toRead;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef AUTH_CONFIG_H
+#define AUTH_CONFIG_H
+
+// Credentials for the simulated access point and ingest server
+const char* ssid = "sim";
+const char* password = "sim";
+const char* apiEndpoint = "https://ingest.sim/readings";
+const char* authToken = "sim-token";
+const char* deviceId = "sim-device";
+
+#endif
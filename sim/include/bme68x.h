@@ -0,0 +1,134 @@
+#ifndef SIM_BME68X_H
+#define SIM_BME68X_H
+
+#include <stdint.h>
+
+// Subset of the Bosch BME68x API that ships with the Adafruit BME680 library.
+// The stand-in goes through the read/write callbacks with the same register
+// accesses as the real API, so I2C traffic is counted and timed on the bus.
+
+#define BME68X_OK 0
+#define BME68X_E_NULL_PTR -1
+#define BME68X_E_COM_FAIL -2
+#define BME68X_E_DEV_NOT_FOUND -3
+#define BME68X_W_NO_NEW_DATA 2
+
+#define BME68X_CHIP_ID 0x61
+#define BME68X_SLEEP_MODE 0
+#define BME68X_FORCED_MODE 1
+
+#define BME68X_OS_NONE 0
+#define BME68X_OS_1X 1
+#define BME68X_OS_2X 2
+#define BME68X_OS_4X 3
+#define BME68X_OS_8X 4
+#define BME68X_OS_16X 5
+#define BME68X_FILTER_OFF 0
+#define BME68X_FILTER_SIZE_1 1
+#define BME68X_FILTER_SIZE_3 2
+#define BME68X_FILTER_SIZE_7 3
+#define BME68X_ODR_NONE 8
+
+#define BME68X_ENABLE 0x01
+#define BME68X_DISABLE 0x00
+
+#define BME68X_NEW_DATA_MSK 0x80
+#define BME68X_GASM_VALID_MSK 0x20
+#define BME68X_HEAT_STAB_MSK 0x10
+
+#define BME68X_INTF_RET_TYPE int8_t
+
+enum bme68x_intf {
+    BME68X_SPI_INTF,
+    BME68X_I2C_INTF
+};
+
+typedef BME68X_INTF_RET_TYPE (*bme68x_read_fn)(uint8_t reg_addr, uint8_t* reg_data, uint32_t length, void* intf_ptr);
+typedef BME68X_INTF_RET_TYPE (*bme68x_write_fn)(uint8_t reg_addr, const uint8_t* reg_data, uint32_t length,
+                                                void* intf_ptr);
+typedef void (*bme68x_delay_us_fn)(uint32_t period, void* intf_ptr);
+
+struct bme68x_data {
+    uint8_t status;
+    uint8_t gas_index;
+    uint8_t meas_index;
+    uint8_t res_heat;
+    uint8_t idac;
+    uint8_t gas_wait;
+    float temperature;      // °C
+    float pressure;         // Pa
+    float humidity;         // %RH
+    float gas_resistance;   // Ohm
+};
+
+struct bme68x_calib_data {
+    uint16_t par_h1;
+    uint16_t par_h2;
+    int8_t par_h3;
+    int8_t par_h4;
+    int8_t par_h5;
+    uint8_t par_h6;
+    int8_t par_h7;
+    int8_t par_gh1;
+    int16_t par_gh2;
+    int8_t par_gh3;
+    uint16_t par_t1;
+    int16_t par_t2;
+    int8_t par_t3;
+    uint16_t par_p1;
+    int16_t par_p2;
+    int8_t par_p3;
+    int16_t par_p4;
+    int16_t par_p5;
+    int8_t par_p6;
+    int8_t par_p7;
+    int16_t par_p8;
+    int16_t par_p9;
+    uint8_t par_p10;
+    float t_fine;
+    uint8_t res_heat_range;
+    int8_t res_heat_val;
+    int8_t range_sw_err;
+};
+
+struct bme68x_conf {
+    uint8_t os_hum;
+    uint8_t os_temp;
+    uint8_t os_pres;
+    uint8_t filter;
+    uint8_t odr;
+};
+
+struct bme68x_heatr_conf {
+    uint8_t enable;
+    uint16_t heatr_temp;
+    uint16_t heatr_dur;
+    uint16_t* heatr_temp_prof;
+    uint16_t* heatr_dur_prof;
+    uint8_t profile_len;
+    uint16_t shared_heatr_dur;
+};
+
+struct bme68x_dev {
+    uint8_t chip_id;
+    void* intf_ptr;
+    uint32_t variant_id;
+    enum bme68x_intf intf;
+    uint8_t mem_page;
+    int8_t amb_temp;
+    struct bme68x_calib_data calib;
+    bme68x_read_fn read;
+    bme68x_write_fn write;
+    bme68x_delay_us_fn delay_us;
+    BME68X_INTF_RET_TYPE intf_rslt;
+    uint8_t info_msg;
+};
+
+int8_t bme68x_init(struct bme68x_dev* dev);
+int8_t bme68x_set_conf(struct bme68x_conf* conf, struct bme68x_dev* dev);
+int8_t bme68x_set_heatr_conf(uint8_t op_mode, const struct bme68x_heatr_conf* conf, struct bme68x_dev* dev);
+int8_t bme68x_set_op_mode(const uint8_t op_mode, struct bme68x_dev* dev);
+uint32_t bme68x_get_meas_dur(const uint8_t op_mode, struct bme68x_conf* conf, struct bme68x_dev* dev);
+int8_t bme68x_get_data(uint8_t op_mode, struct bme68x_data* data, uint8_t* n_data, struct bme68x_dev* dev);
+
+#endif
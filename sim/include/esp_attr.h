@@ -0,0 +1,7 @@
+#ifndef SIM_ESP_ATTR_H
+#define SIM_ESP_ATTR_H
+
+// RTC slow memory is one linker section, so the runner can copy it between boots
+#define RTC_DATA_ATTR __attribute__((section("sim_rtc_data")))
+
+#endif
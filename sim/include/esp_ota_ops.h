@@ -0,0 +1,9 @@
+#ifndef SIM_ESP_OTA_OPS_H
+#define SIM_ESP_OTA_OPS_H
+
+#include <stddef.h>
+
+// Hex digest of the running image, fixed for the simulator build
+int esp_ota_get_app_elf_sha256(char* dst, size_t size);
+
+#endif
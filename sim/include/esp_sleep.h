@@ -0,0 +1,13 @@
+#ifndef SIM_ESP_SLEEP_H
+#define SIM_ESP_SLEEP_H
+
+#include <stdint.h>
+#include "esp_attr.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+[[noreturn]] void esp_deep_sleep_start();
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SIM_MBEDTLS_NET_SOCKETS_H
+#define SIM_MBEDTLS_NET_SOCKETS_H
+
+#define MBEDTLS_ERR_NET_CONN_RESET -0x0050
+
+#endif
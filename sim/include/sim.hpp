@@ -0,0 +1,134 @@
+#ifndef SIM_HPP
+#define SIM_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Native simulation of the wake cycle. The Arduino/ESP-IDF stand-ins in
+// sim/include run the firmware against a virtual clock. The runner in
+// sim/src/runner.cpp boots it once per simulated wake in a forked process
+// and copies RTC memory from one boot to the next.
+namespace sim {
+
+// Scripted waveform: base + amplitude * sin(2π (t - phase) / period) + trend * days + noise,
+// plus step from stepHour on (a watering, a door opening)
+struct Signal {
+    double base;
+    double amplitude;
+    double periodHours;
+    double phaseHours;
+    double noise;          // Standard deviation of Gaussian noise
+    double trendPerDay;
+    double stepHour;
+    double step;
+};
+
+enum class FaultType : uint8_t {
+    WIFI_OUTAGE,     // Access point unreachable
+    SERVER_DOWN,     // TCP connections refused
+    SERVER_ERROR     // Requests answered with 503
+};
+
+struct Fault {
+    FaultType type;
+    double startHour;  // Hours since the start of the run
+    double endHour;
+};
+
+static const int MAX_FAULTS = 32;
+
+struct Scenario {
+    time_t start;            // Wall-clock time of the first boot
+    double days;
+    Signal rtcDriftPpm;      // Positive when the sleep timer runs slow
+    Signal soilRaw;          // ADC counts on SOIL_MOISTURE_PIN
+    Signal batteryVolts;     // Before the divider on BATTERY_VOLTAGE_PIN
+    Signal temperature;      // °C
+    Signal humidity;         // %RH
+    Signal pressure;         // hPa
+    Signal gas;              // kΩ
+    Signal rssi;             // dBm
+    bool bme680Present;
+    Fault faults[MAX_FAULTS];
+    int faultCount;
+};
+
+// Virtual radio, link and server costs
+struct LinkModel {
+    uint32_t scanMs;             // Skipped when BSSID and channel are given
+    uint32_t associateMs;
+    uint32_t dhcpMs;             // Skipped with a static configuration
+    uint32_t outageTimeoutMs;    // Until the driver reports the AP missing
+    uint32_t roundTripMs;
+    uint32_t fullHandshakeMs;    // TLS, including key exchange
+    uint32_t resumedHandshakeMs;
+    uint32_t bytesPerMs;
+    uint32_t serverMs;           // Server time per request
+};
+
+enum class BootOutcome : uint8_t {
+    SLEPT,
+    HUNG,            // Error state or deadlock, reset by hand
+    HALTED           // Deep sleep without a wake-up source
+};
+
+static const int MAX_SEQUENCES_PER_BOOT = 64;
+static const uint64_t MAX_BOOT_US = 10ULL * 60 * 1000000;  // Longer is treated as hung
+static const size_t MAX_RTC_IMAGE = 16384;
+
+// Shared between a boot and the runner
+struct BootRecord {
+    // Set by the runner before the boot
+    uint64_t trueTimeUs;         // Actual wall-clock time at boot
+    int64_t deviceOffsetUs;      // Device clock minus actual time, updated by the boot
+    int resetReason;             // esp_reset_reason_t
+    uint16_t bme680HeaterMs;     // Heater duration the chip holds, 0 after power-on, updated by the boot
+
+    // Filled in by the boot
+    BootOutcome outcome;
+    uint64_t awakeUs;
+    uint64_t radioUs;
+    uint64_t sleepUs;
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+    uint32_t requests;
+    uint32_t failedRequests;     // Answered with anything but 2xx
+    uint32_t ntpSyncs;
+    uint32_t sequenceCount;
+    uint32_t sequences[MAX_SEQUENCES_PER_BOOT];
+    uint8_t rtcImage[MAX_RTC_IMAGE];
+};
+
+// Set up by the runner
+extern const Scenario* scenario;
+extern const LinkModel* linkModel;
+extern BootRecord* boot;
+
+// Virtual clock, in microseconds since the boot started
+uint64_t now();
+// Actual wall-clock time, for the scripted signals and faults
+uint64_t trueTimeUs();
+double hoursSinceStart();
+
+double sample(const Signal& signal);
+bool faultActive(FaultType type);
+
+// Blocks the calling task until the virtual clock reaches `until`,
+// letting other tasks and timed events run in the meantime
+void sleepUntil(uint64_t until);
+void sleepFor(uint64_t us);
+// Runs callback from the scheduler once the virtual clock reaches `at`
+void schedule(uint64_t at, void (*callback)(void*), void* context);
+
+void radioOn();
+void radioOff();
+// Station associated with an IP address
+bool linkUp();
+
+// Ends the boot: records the outcome and RTC image and exits the process
+[[noreturn]] void endBoot(BootOutcome outcome, uint64_t sleepUs);
+
+}  // namespace sim
+
+#endif
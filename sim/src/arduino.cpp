@@ -0,0 +1,211 @@
+// Arduino core, system time and deep sleep stand-ins
+#include "sim.hpp"
+#include <Arduino.h>
+#include <IPAddress.h>
+#include "esp_ota_ops.h"
+#include "esp_sntp.h"
+#include <unistd.h>
+
+// Bounds of the RTC_DATA_ATTR section, provided by the linker
+extern "C" uint8_t __start_sim_rtc_data[];
+extern "C" uint8_t __stop_sim_rtc_data[];
+
+HardwareSerial Serial;
+
+namespace sim {
+
+const Scenario* scenario = nullptr;
+const LinkModel* linkModel = nullptr;
+BootRecord* boot = nullptr;
+
+static uint64_t radioSince = 0;
+static bool radioActive = false;
+static uint64_t wakeupUs = 0;
+
+uint64_t trueTimeUs() {
+    return boot->trueTimeUs + now();
+}
+
+double hoursSinceStart() {
+    return (trueTimeUs() / 1e6 - scenario->start) / 3600.0;
+}
+
+static double gaussian() {
+    // Box-Muller; rand() is seeded per boot by the runner
+    const double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+double sample(const Signal& signal) {
+    const double hours = hoursSinceStart();
+    double value = signal.base + signal.trendPerDay * hours / 24.0;
+    if (signal.periodHours > 0) {
+        value += signal.amplitude * sin(2.0 * M_PI * (hours - signal.phaseHours) / signal.periodHours);
+    }
+    if (signal.step != 0 && hours >= signal.stepHour) value += signal.step;
+    if (signal.noise > 0) value += signal.noise * gaussian();
+    return value;
+}
+
+bool faultActive(FaultType type) {
+    const double hours = hoursSinceStart();
+    for (int i = 0; i < scenario->faultCount; i++) {
+        const Fault& fault = scenario->faults[i];
+        if (fault.type == type && hours >= fault.startHour && hours < fault.endHour) return true;
+    }
+    return false;
+}
+
+void radioOn() {
+    if (radioActive) return;
+    radioActive = true;
+    radioSince = now();
+}
+
+void radioOff() {
+    if (!radioActive) return;
+    radioActive = false;
+    boot->radioUs += now() - radioSince;
+}
+
+void endBoot(BootOutcome outcome, uint64_t sleepUs) {
+    radioOff();
+    boot->outcome = outcome;
+    boot->awakeUs = now();
+    boot->sleepUs = sleepUs;
+
+    const size_t rtcSize = __stop_sim_rtc_data - __start_sim_rtc_data;
+    memcpy(boot->rtcImage, __start_sim_rtc_data, rtcSize);
+
+    fflush(stdout);
+    _exit(0);
+}
+
+}  // namespace sim
+
+size_t Print::printf(const char* format, ...) {
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    return write(reinterpret_cast<const uint8_t*>(buffer),
+                 length < static_cast<int>(sizeof(buffer)) ? length : sizeof(buffer) - 1);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+String IPAddress::toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", address & 0xff, (address >> 8) & 0xff,
+             (address >> 16) & 0xff, address >> 24);
+    return String(buffer);
+}
+
+esp_reset_reason_t esp_reset_reason() {
+    return static_cast<esp_reset_reason_t>(sim::boot->resetReason);
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+    sim::wakeupUs = time_in_us;
+    return ESP_OK;
+}
+
+int esp_ota_get_app_elf_sha256(char* dst, size_t size) {
+    static const char SIM_ELF_SHA256[] = "51a0b1d2c3e4f5061728394a5b6c7d8e9fa0b1c2d3e4f5061728394a5b6c7d8e";
+    if (dst == nullptr || size == 0) return 0;
+    const size_t length = size - 1 < sizeof(SIM_ELF_SHA256) - 1 ? size - 1 : sizeof(SIM_ELF_SHA256) - 1;
+    memcpy(dst, SIM_ELF_SHA256, length);
+    dst[length] = '\0';
+    return length;
+}
+
+void esp_deep_sleep_start() {
+    sim::endBoot(sim::wakeupUs > 0 ? sim::BootOutcome::SLEPT : sim::BootOutcome::HALTED, sim::wakeupUs);
+}
+
+// The device clock is the virtual clock plus an offset that settimeofday()
+// and SNTP adjust. These replace the C library versions for the whole binary.
+static uint64_t deviceTimeUs() {
+    return sim::trueTimeUs() + sim::boot->deviceOffsetUs;
+}
+
+extern "C" time_t time(time_t* out) noexcept {
+    const time_t seconds = sim::boot != nullptr ? static_cast<time_t>(deviceTimeUs() / 1000000) : 0;
+    if (out != nullptr) *out = seconds;
+    return seconds;
+}
+
+extern "C" int gettimeofday(struct timeval* tv, void*) noexcept {
+    const uint64_t us = sim::boot != nullptr ? deviceTimeUs() : 0;
+    tv->tv_sec = static_cast<time_t>(us / 1000000);
+    tv->tv_usec = static_cast<suseconds_t>(us % 1000000);
+    return 0;
+}
+
+extern "C" int settimeofday(const struct timeval* tv, const struct timezone*) noexcept {
+    if (tv == nullptr || sim::boot == nullptr) return 0;
+    const int64_t target = static_cast<int64_t>(tv->tv_sec) * 1000000 + tv->tv_usec;
+    sim::boot->deviceOffsetUs = target - static_cast<int64_t>(sim::trueTimeUs());
+    return 0;
+}
+
+static sntp_sync_time_cb_t ntpCallback = nullptr;
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {
+    ntpCallback = callback;
+}
+
+static void completeNtpSync(void*) {
+    if (!sim::linkUp()) return;
+
+    // The answer is off by up to half the round trip, whichever way the path is slower
+    const int64_t halfTripUs = sim::linkModel->roundTripMs * 500LL;
+    sim::boot->deviceOffsetUs = rand() % (2 * halfTripUs + 1) - halfTripUs;
+    sim::boot->ntpSyncs++;
+
+    if (ntpCallback != nullptr) {
+        struct timeval tv;
+        gettimeofday(&tv, nullptr);
+        ntpCallback(&tv);
+    }
+}
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2, const char* server3) {
+    // Same POSIX TZ string the Arduino core builds
+    const long offset = gmtOffset_sec + daylightOffset_sec;
+    char tz[32];
+    snprintf(tz, sizeof(tz), "UTC%c%02ld:%02ld", offset > 0 ? '-' : '+',
+             labs(offset) / 3600, (labs(offset) % 3600) / 60);
+    setenv("TZ", tz, 1);
+    tzset();
+
+    // SNTP answers asynchronously, one round trip later
+    if (server1 != nullptr && sim::linkUp()) {
+        sim::schedule(sim::now() + sim::linkModel->roundTripMs * 1000ULL, completeNtpSync, nullptr);
+    }
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    const unsigned long start = millis();
+    while (true) {
+        const time_t now = time(nullptr);
+        localtime_r(&now, info);
+        if (info->tm_year > (2016 - 1900)) return true;
+        if (millis() - start >= ms) return false;
+        delay(10);
+    }
+}
@@ -0,0 +1,277 @@
+// GPIO, ADC, I2C and BME680 stand-ins driven by the scenario's signals
+#include "sim.hpp"
+#include <Arduino.h>
+#include <Wire.h>
+#include <bme68x.h>
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+#include "config.hpp"
+
+TwoWire Wire;
+
+static const int PIN_COUNT = 40;
+static const uint32_t ADC_FULL_SCALE_MV = 3300;   // Linear stand-in for the 11 dB range
+static const uint16_t ADC_MAX_RAW = 4095;
+static const uint16_t FLOATING_PIN_RAW = 40;      // Unpowered probe reads near zero
+
+static uint8_t pinLevels[PIN_COUNT];
+static const uint8_t ADC1_PINS[] = {36, 37, 38, 39, 32, 33, 34, 35};  // By channel
+
+static uint16_t clampRaw(double raw) {
+    if (raw < 0) return 0;
+    if (raw > ADC_MAX_RAW) return ADC_MAX_RAW;
+    return static_cast<uint16_t>(raw);
+}
+
+// Raw count the ADC would read on pin at the current virtual time
+static uint16_t sampleRaw(uint8_t pin) {
+    if (pin == SOIL_MOISTURE_PIN) {
+        if (pinLevels[SOIL_MOISTURE_POWER_PIN] != HIGH) return rand() % FLOATING_PIN_RAW;
+        return clampRaw(sim::sample(sim::scenario->soilRaw));
+    }
+    if (pin == BATTERY_VOLTAGE_PIN) {
+        const double millivolts = sim::sample(sim::scenario->batteryVolts) * 1000.0 / BATTERY_VOLTAGE_DIVIDER_RATIO;
+        return clampRaw(millivolts * ADC_MAX_RAW / ADC_FULL_SCALE_MV);
+    }
+    return rand() % FLOATING_PIN_RAW;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    // Nothing drives the pins, so a pulled-up input reads high
+    if (pin < PIN_COUNT && mode == INPUT_PULLUP) pinLevels[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < PIN_COUNT) pinLevels[pin] = value;
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < PIN_COUNT ? pinLevels[pin] : LOW;
+}
+
+uint16_t analogRead(uint8_t pin) {
+    sim::sleepFor(10);  // One-shot conversion through the legacy driver
+    return sampleRaw(pin);
+}
+
+void analogReadResolution(uint8_t bits) {}
+
+int8_t digitalPinToAnalogChannel(uint8_t pin) {
+    for (uint8_t channel = 0; channel < sizeof(ADC1_PINS); channel++) {
+        if (ADC1_PINS[channel] == pin) return channel;
+    }
+    return 10;  // Stands for any ADC2 channel
+}
+
+static struct {
+    uint32_t channelMask;
+    uint32_t bytesPerFrame;
+    uint32_t sampleRateHz;
+    int channel;
+    bool running;
+} continuousAdc;
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t* config) {
+    continuousAdc.channelMask = config->adc1_chan_mask;
+    continuousAdc.bytesPerFrame = config->conv_num_each_intr;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t* config) {
+    if (config->pattern_num != 1 || config->sample_freq_hz == 0) return -1;
+    continuousAdc.channel = config->adc_pattern[0].channel;
+    continuousAdc.sampleRateHz = config->sample_freq_hz;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_start() {
+    continuousAdc.running = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_stop() {
+    continuousAdc.running = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_deinitialize() {
+    continuousAdc.channelMask = 0;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_read_bytes(uint8_t* buffer, uint32_t maxLength, uint32_t* length, uint32_t timeoutMs) {
+    *length = 0;
+    if (!continuousAdc.running) return -1;
+
+    uint32_t samples = continuousAdc.bytesPerFrame;
+    if (samples > maxLength) samples = maxLength;
+    samples /= sizeof(adc_digi_output_data_t);
+
+    // Wait for the DMA frame to fill at the configured rate
+    sim::sleepFor(static_cast<uint64_t>(samples) * 1000000 / continuousAdc.sampleRateHz);
+
+    adc_digi_output_data_t* out = reinterpret_cast<adc_digi_output_data_t*>(buffer);
+    for (uint32_t i = 0; i < samples; i++) {
+        out[i].type1.channel = continuousAdc.channel;
+        out[i].type1.data = sampleRaw(ADC1_PINS[continuousAdc.channel & 7]);
+    }
+    *length = samples * sizeof(adc_digi_output_data_t);
+    return ESP_OK;
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t unit, adc_atten_t atten, adc_bits_width_t width,
+                                             uint32_t defaultVref, esp_adc_cal_characteristics_t* chars) {
+    chars->adc_num = unit;
+    chars->atten = atten;
+    chars->bit_width = width;
+    chars->vref = defaultVref;
+    return ESP_ADC_CAL_VAL_EFUSE_TP;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t raw, const esp_adc_cal_characteristics_t* chars) {
+    return raw * ADC_FULL_SCALE_MV / ADC_MAX_RAW;
+}
+
+// 100 kHz, 9 clocks per byte with the ACK, plus start, address and stop
+static const uint64_t I2C_US_PER_BYTE = 90;
+static const uint64_t I2C_US_PER_TRANSFER = 2 * I2C_US_PER_BYTE;
+
+static bool i2cAcknowledges(uint8_t address) {
+    return address == BME_ADDRESS && sim::scenario->bme680Present;
+}
+
+void TwoWire::beginTransmission(uint8_t target) {
+    address = target;
+    bytes = 0;
+}
+
+size_t TwoWire::write(uint8_t) {
+    bytes++;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t*, size_t length) {
+    bytes += length;
+    return length;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+    sim::sleepFor(I2C_US_PER_TRANSFER + bytes * I2C_US_PER_BYTE);
+    return i2cAcknowledges(address) ? 0 : 2;  // 2: address not acknowledged
+}
+
+uint8_t TwoWire::requestFrom(uint8_t target, uint8_t length, bool) {
+    sim::sleepFor(I2C_US_PER_TRANSFER + length * I2C_US_PER_BYTE);
+    toRead = i2cAcknowledges(target) ? length : 0;
+    return toRead;
+}
+
+// Register contents are not modelled, the bme68x stand-in below ignores them
+int TwoWire::read() {
+    if (toRead == 0) return -1;
+    toRead--;
+    return 0;
+}
+
+// Calibration the simulated chip reports, checked again on every reading
+static const bme68x_calib_data SIM_CALIB = {
+    .par_h1 = 754, .par_h2 = 1003, .par_h3 = 0, .par_h4 = 45, .par_h5 = 20, .par_h6 = 120, .par_h7 = -100,
+    .par_gh1 = -30, .par_gh2 = -5969, .par_gh3 = 18,
+    .par_t1 = 26125, .par_t2 = 26370, .par_t3 = 3,
+    .par_p1 = 36086, .par_p2 = -10370, .par_p3 = 88, .par_p4 = 6588, .par_p5 = -129, .par_p6 = 30,
+    .par_p7 = 36, .par_p8 = -3046, .par_p9 = -1781, .par_p10 = 30,
+    .t_fine = 0, .res_heat_range = 1, .res_heat_val = 46, .range_sw_err = 0
+};
+
+static const uint32_t BME68X_SOFT_RESET_US = 10000;
+static const uint8_t OS_MEAS_CYCLES[] = {0, 1, 2, 4, 8, 16};
+
+static unsigned long bme68xReadyAt = 0;   // Forced measurement in progress, in millis()
+
+// A register access through the driver's callbacks, like the real API's
+static bool chipRead(bme68x_dev* dev, uint8_t reg, uint32_t length) {
+    uint8_t buffer[32];
+    dev->intf_rslt = dev->read(reg, buffer, length, dev->intf_ptr);
+    return dev->intf_rslt == 0;
+}
+
+static bool chipWrite(bme68x_dev* dev, uint8_t reg, uint32_t length) {
+    const uint8_t buffer[32] = {0};
+    dev->intf_rslt = dev->write(reg, buffer, length, dev->intf_ptr);
+    return dev->intf_rslt == 0;
+}
+
+int8_t bme68x_init(bme68x_dev* dev) {
+    // Soft reset, chip ID, variant ID and the three calibration blocks
+    if (!chipWrite(dev, 0xE0, 1)) return BME68X_E_COM_FAIL;
+    dev->delay_us(BME68X_SOFT_RESET_US, dev->intf_ptr);
+    sim::boot->bme680HeaterMs = 0;
+    if (!chipRead(dev, 0xD0, 1) || !chipRead(dev, 0xF0, 1)) return BME68X_E_DEV_NOT_FOUND;
+    if (!chipRead(dev, 0x8A, 23) || !chipRead(dev, 0xE1, 14) || !chipRead(dev, 0x00, 5)) return BME68X_E_COM_FAIL;
+
+    dev->chip_id = BME68X_CHIP_ID;
+    dev->variant_id = 0;
+    dev->calib = SIM_CALIB;
+    return BME68X_OK;
+}
+
+int8_t bme68x_set_conf(bme68x_conf* conf, bme68x_dev* dev) {
+    // Current mode, sleep mode check, read-modify-write of the config registers
+    if (conf == nullptr) return BME68X_E_NULL_PTR;
+    if (!chipRead(dev, 0x74, 1) || !chipRead(dev, 0x74, 1) || !chipRead(dev, 0x71, 5)) return BME68X_E_COM_FAIL;
+    return chipWrite(dev, 0x71, 9) ? BME68X_OK : BME68X_E_COM_FAIL;
+}
+
+int8_t bme68x_set_heatr_conf(uint8_t, const bme68x_heatr_conf* conf, bme68x_dev* dev) {
+    // Sleep mode check, heater set-point, read-modify-write of ctrl_gas
+    if (conf == nullptr) return BME68X_E_NULL_PTR;
+    if (!chipRead(dev, 0x74, 1) || !chipWrite(dev, 0x5A, 3) || !chipRead(dev, 0x70, 2) || !chipWrite(dev, 0x70, 3)) {
+        return BME68X_E_COM_FAIL;
+    }
+    sim::boot->bme680HeaterMs = conf->enable ? conf->heatr_dur : 0;
+    return BME68X_OK;
+}
+
+int8_t bme68x_set_op_mode(const uint8_t op_mode, bme68x_dev* dev) {
+    if (!chipRead(dev, 0x74, 1)) return BME68X_E_COM_FAIL;
+    if (op_mode == BME68X_SLEEP_MODE) return BME68X_OK;
+    if (!chipWrite(dev, 0x74, 1)) return BME68X_E_COM_FAIL;
+
+    bme68xReadyAt = millis() + bme68x_get_meas_dur(op_mode, nullptr, dev) / 1000 + sim::boot->bme680HeaterMs;
+    return BME68X_OK;
+}
+
+uint32_t bme68x_get_meas_dur(const uint8_t, bme68x_conf* conf, bme68x_dev*) {
+    // Datasheet formula; without a configuration the chip's 8x/4x/2x is assumed
+    uint32_t cycles = OS_MEAS_CYCLES[BME68X_OS_8X] + OS_MEAS_CYCLES[BME68X_OS_4X] + OS_MEAS_CYCLES[BME68X_OS_2X];
+    if (conf != nullptr) {
+        cycles = OS_MEAS_CYCLES[conf->os_temp] + OS_MEAS_CYCLES[conf->os_pres] + OS_MEAS_CYCLES[conf->os_hum];
+    }
+    return cycles * 1963 + 477 * 4 + 477 * 5 + 1000;
+}
+
+int8_t bme68x_get_data(uint8_t, bme68x_data* data, uint8_t* n_data, bme68x_dev* dev) {
+    // Field data, then the heater resistance, current and wait registers
+    *n_data = 0;
+    if (!chipRead(dev, 0x1D, 17) || !chipRead(dev, 0x5A, 1) || !chipRead(dev, 0x50, 1) || !chipRead(dev, 0x64, 1)) {
+        return BME68X_E_COM_FAIL;
+    }
+    if (bme68xReadyAt == 0 || static_cast<long>(millis() - bme68xReadyAt) < 0) return BME68X_W_NO_NEW_DATA;
+    bme68xReadyAt = 0;
+
+    data->status = BME68X_NEW_DATA_MSK;
+    if (sim::boot->bme680HeaterMs > 0) data->status |= BME68X_GASM_VALID_MSK | BME68X_HEAT_STAB_MSK;
+    data->temperature = sim::sample(sim::scenario->temperature);
+    data->humidity = sim::sample(sim::scenario->humidity);
+    data->pressure = sim::sample(sim::scenario->pressure) * 100.0;
+    data->gas_resistance = sim::sample(sim::scenario->gas) * 1000.0;
+
+    // Compensating with another chip's coefficients gives plausible nonsense
+    if (dev->calib.par_t1 != SIM_CALIB.par_t1 || dev->calib.par_p1 != SIM_CALIB.par_p1 ||
+        dev->calib.par_h1 != SIM_CALIB.par_h1 || dev->calib.par_gh2 != SIM_CALIB.par_gh2) {
+        data->temperature += 40.0f;
+        data->pressure *= 0.8f;
+    }
+    *n_data = 1;
+    return BME68X_OK;
+}
@@ -0,0 +1,355 @@
+// Runs the firmware through simulated wake cycles. Each boot is a forked
+// process, so ordinary globals start fresh while the RTC_DATA_ATTR section is
+// carried over by the runner and the spill log persists in FS_MOUNT_POINT.
+#include "sim.hpp"
+#include <Arduino.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <set>
+#include <vector>
+#include "config.hpp"
+
+void setup();
+
+extern "C" uint8_t __start_sim_rtc_data[];
+extern "C" uint8_t __stop_sim_rtc_data[];
+
+static const uint64_t US_PER_DAY = 86400ULL * 1000000;
+static const uint32_t BOOT_ROM_MS = 250;   // Wake stub and bootloader before setup()
+
+struct DayStats {
+    uint32_t wakes;
+    uint32_t hung;
+    uint64_t awakeUs;
+    uint64_t maxAwakeUs;      // Longest wake, boot ROM included
+    uint64_t radioUs;
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+    uint32_t requests;
+    uint32_t failedRequests;
+    uint32_t duplicates;      // Chunks the server had already accepted
+    uint32_t ntpSyncs;
+    uint64_t maxClockErrorUs; // Device clock against actual time when going to sleep
+};
+
+static sim::Scenario defaultScenario() {
+    sim::Scenario scenario = {};
+    scenario.start = 1704067200;   // 2024-01-01 00:00 UTC
+    scenario.days = 30;
+    scenario.rtcDriftPpm = {50, 0, 0, 0, 0, 0};
+    scenario.soilRaw = {1800, 300, 24, 6, 15, 10};
+    scenario.batteryVolts = {4.4, 0, 0, 0, 0.005, -0.01};
+    scenario.temperature = {18, 6, 24, 9, 0.1, 0};
+    scenario.humidity = {60, 15, 24, 3, 0.5, 0};
+    scenario.pressure = {1013, 4, 72, 0, 0.1, 0};
+    scenario.gas = {120, 20, 24, 0, 2, 0};
+    scenario.rssi = {-67, 4, 24, 0, 2, 0};
+    scenario.bme680Present = true;
+    return scenario;
+}
+
+static const sim::LinkModel LINK = {
+    .scanMs = 1800,
+    .associateMs = 180,
+    .dhcpMs = 600,
+    .outageTimeoutMs = 4000,
+    .roundTripMs = 40,
+    .fullHandshakeMs = 900,
+    .resumedHandshakeMs = 120,
+    .bytesPerMs = 125,          // ~1 Mbit/s of useful throughput
+    .serverMs = 30
+};
+
+static bool parseSignal(const char* args, sim::Signal& signal) {
+    return sscanf(args, "%lf %lf %lf %lf %lf %lf %lf %lf", &signal.base, &signal.amplitude, &signal.periodHours,
+                  &signal.phaseHours, &signal.noise, &signal.trendPerDay, &signal.stepHour, &signal.step) >= 1;
+}
+
+// Scenario files hold one setting per line, '#' starts a comment:
+//   days 90
+//   start 1704067200
+//   drift_ppm 50 [amplitude period_h phase_h noise trend_per_day [step_h step]]
+//   bme680 absent
+//   soil|battery|temperature|humidity|pressure|gas|rssi base [amplitude period_h phase_h noise trend_per_day [step_h step]]
+//   wifi_outage|server_down|server_error start_h end_h
+static bool loadScenario(const char* path, sim::Scenario& scenario) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot open scenario %s\n", path);
+        return false;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file) != nullptr) {
+        lineNumber++;
+        char* comment = strchr(line, '#');
+        if (comment != nullptr) *comment = '\0';
+
+        char key[32];
+        int consumed = 0;
+        if (sscanf(line, "%31s %n", key, &consumed) != 1) continue;
+        const char* args = line + consumed;
+
+        struct { const char* name; sim::Signal* signal; } signals[] = {
+            {"soil", &scenario.soilRaw}, {"battery", &scenario.batteryVolts},
+            {"temperature", &scenario.temperature}, {"humidity", &scenario.humidity},
+            {"pressure", &scenario.pressure}, {"gas", &scenario.gas}, {"rssi", &scenario.rssi}
+        };
+        struct { const char* name; sim::FaultType type; } faults[] = {
+            {"wifi_outage", sim::FaultType::WIFI_OUTAGE}, {"server_down", sim::FaultType::SERVER_DOWN},
+            {"server_error", sim::FaultType::SERVER_ERROR}
+        };
+
+        bool known = false;
+        for (auto& entry : signals) {
+            if (strcmp(key, entry.name) != 0) continue;
+            *entry.signal = {0, 0, 0, 0, 0, 0, 0, 0};
+            ok = parseSignal(args, *entry.signal);
+            known = true;
+        }
+        for (auto& entry : faults) {
+            if (strcmp(key, entry.name) != 0) continue;
+            if (scenario.faultCount >= sim::MAX_FAULTS) {
+                ok = false;
+            } else {
+                sim::Fault& fault = scenario.faults[scenario.faultCount++];
+                fault.type = entry.type;
+                ok = sscanf(args, "%lf %lf", &fault.startHour, &fault.endHour) == 2;
+            }
+            known = true;
+        }
+
+        if (strcmp(key, "days") == 0) {
+            ok = sscanf(args, "%lf", &scenario.days) == 1;
+        } else if (strcmp(key, "start") == 0) {
+            long long start;
+            ok = sscanf(args, "%lld", &start) == 1;
+            scenario.start = start;
+        } else if (strcmp(key, "drift_ppm") == 0) {
+            ok = parseSignal(args, scenario.rtcDriftPpm);
+        } else if (strcmp(key, "bme680") == 0) {
+            scenario.bme680Present = strncmp(args, "absent", 6) != 0;
+        } else if (!known) {
+            ok = false;
+        }
+    }
+    fclose(file);
+
+    if (!ok) fprintf(stderr, "%s:%d: invalid scenario line\n", path, lineNumber);
+    return ok;
+}
+
+static void removeTree(const char* path) {
+    DIR* dir = opendir(path);
+    if (dir != nullptr) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            char child[512];
+            snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+            removeTree(child);
+        }
+        closedir(dir);
+        rmdir(path);
+    } else {
+        unlink(path);
+    }
+}
+
+// Runs one boot in a child process, returns false if it crashed
+static bool runBoot(bool verbose) {
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        if (!verbose && freopen("/dev/null", "w", stdout) == nullptr) _exit(1);
+        srand(static_cast<unsigned>(sim::boot->trueTimeUs / 1000000));
+        setup();
+        // setup() only returns when the firmware never went to sleep
+        sim::endBoot(sim::BootOutcome::HUNG, 0);
+    }
+
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid) return false;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) return true;
+    fprintf(stderr, "Boot at %.2f h %s %d\n", (sim::boot->trueTimeUs / 1e6 - sim::scenario->start) / 3600.0,
+            WIFSIGNALED(status) ? "killed by signal" : "exited with status",
+            WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status));
+    return false;
+}
+
+static void printRow(const char* label, const DayStats& day, double days) {
+    printf("%-8s %7.1f %8.1f %9.1f %9.1f %8.0f %10.0f %9.0f %8.1f %7.1f %6.1f %5u %6.1f %8.1f\n", label,
+           day.wakes / days, day.awakeUs / 1e6 / days, day.radioUs / 1e6 / days,
+           day.wakes > 0 ? day.awakeUs / 1e3 / day.wakes : 0.0, day.maxAwakeUs / 1e3,
+           day.bytesSent / days, day.bytesReceived / days,
+           day.requests / days, day.failedRequests / days, day.duplicates / days, day.hung,
+           day.ntpSyncs / days, day.maxClockErrorUs / 1e3);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--days N] [--scenario FILE] [--daily] [--verbose]\n", program);
+}
+
+int main(int argc, char** argv) {
+    sim::Scenario scenario = defaultScenario();
+    bool verbose = false;
+    bool daily = false;
+    double days = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            if (!loadScenario(argv[++i], scenario)) return 1;
+        } else if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+            days = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--daily") == 0) {
+            daily = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (days > 0) scenario.days = days;
+
+    const size_t rtcSize = __stop_sim_rtc_data - __start_sim_rtc_data;
+    if (rtcSize > sim::MAX_RTC_IMAGE) {
+        fprintf(stderr, "RTC data (%zu bytes) exceeds the simulator's %zu byte image\n", rtcSize, sim::MAX_RTC_IMAGE);
+        return 1;
+    }
+    std::vector<uint8_t> powerOnRtc(__start_sim_rtc_data, __stop_sim_rtc_data);
+
+    void* shared = mmap(nullptr, sizeof(sim::BootRecord), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    sim::boot = static_cast<sim::BootRecord*>(shared);
+    sim::scenario = &scenario;
+    sim::linkModel = &LINK;
+
+    // Flash starts erased
+    removeTree(FS_MOUNT_POINT);
+    mkdir(FS_MOUNT_POINT, 0755);
+
+    const uint64_t startUs = static_cast<uint64_t>(scenario.start) * 1000000;
+    const uint64_t endUs = startUs + static_cast<uint64_t>(scenario.days * US_PER_DAY);
+    const int dayCount = static_cast<int>(scenario.days + 0.999);
+    std::vector<DayStats> stats(dayCount > 0 ? dayCount : 1, DayStats());
+    std::set<uint32_t> accepted;
+
+    uint64_t trueUs = startUs;
+    int64_t deviceOffsetUs = -static_cast<int64_t>(startUs);   // Clock starts at the epoch
+    int resetReason = ESP_RST_POWERON;
+    uint16_t bme680HeaterMs = 0;   // BME680 registers survive everything but power loss
+    bool clockSet = false;         // Clock error only counts once NTP has set the clock
+    uint32_t boots = 0;
+    int consecutiveCrashes = 0;
+
+    printf("Simulating %.1f days from %lld, %zu bytes of RTC data\n", scenario.days,
+           static_cast<long long>(scenario.start), rtcSize);
+
+    while (trueUs < endUs) {
+        sim::BootRecord& boot = *sim::boot;
+        memset(&boot, 0, offsetof(sim::BootRecord, rtcImage));
+        trueUs += BOOT_ROM_MS * 1000ULL;
+        boot.trueTimeUs = trueUs;
+        boot.deviceOffsetUs = deviceOffsetUs;
+        boot.resetReason = resetReason;
+        boot.bme680HeaterMs = bme680HeaterMs;
+        boots++;
+
+        if (verbose) printf("=== Boot %u at %.3f h ===\n", boots, (trueUs - startUs) / 3.6e9);
+
+        DayStats& day = stats[(trueUs - startUs) / US_PER_DAY < stats.size() ? (trueUs - startUs) / US_PER_DAY
+                                                                                 : stats.size() - 1];
+        day.wakes++;
+
+        const bool completed = runBoot(verbose);
+        bme680HeaterMs = boot.bme680HeaterMs;
+        if (!completed) {
+            // Panic reset: RTC memory keeps what the previous boot left
+            if (++consecutiveCrashes >= 3) {
+                fprintf(stderr, "Giving up after repeated crashes\n");
+                return 1;
+            }
+            resetReason = ESP_RST_PANIC;
+            continue;
+        }
+        consecutiveCrashes = 0;
+
+        const uint64_t wakeUs = boot.awakeUs + BOOT_ROM_MS * 1000ULL;
+        day.awakeUs += wakeUs;
+        if (wakeUs > day.maxAwakeUs) day.maxAwakeUs = wakeUs;
+        day.radioUs += boot.radioUs;
+        day.bytesSent += boot.bytesSent;
+        day.bytesReceived += boot.bytesReceived;
+        day.requests += boot.requests;
+        day.failedRequests += boot.failedRequests;
+        day.ntpSyncs += boot.ntpSyncs;
+        for (uint32_t i = 0; i < boot.sequenceCount; i++) {
+            if (!accepted.insert(boot.sequences[i]).second) day.duplicates++;
+        }
+
+        trueUs += boot.awakeUs;
+        if (boot.outcome == sim::BootOutcome::SLEPT) {
+            const uint64_t clockErrorUs = static_cast<uint64_t>(llabs(boot.deviceOffsetUs));
+            if (boot.ntpSyncs > 0) clockSet = true;
+            if (clockSet && clockErrorUs > day.maxClockErrorUs) day.maxClockErrorUs = clockErrorUs;
+
+            memcpy(__start_sim_rtc_data, boot.rtcImage, rtcSize);
+            // The device clock counts the nominal sleep, actual time runs off by the drift
+            const double driftPpm = sim::sample(scenario.rtcDriftPpm);
+            const uint64_t actualSleepUs = static_cast<uint64_t>(boot.sleepUs * (1.0 + driftPpm * 1e-6));
+            trueUs += actualSleepUs;
+            deviceOffsetUs = boot.deviceOffsetUs + static_cast<int64_t>(boot.sleepUs) - static_cast<int64_t>(actualSleepUs);
+            resetReason = ESP_RST_DEEPSLEEP;
+        } else if (boot.outcome == sim::BootOutcome::HUNG) {
+            // Someone power cycles the device: RTC memory and the clock are lost
+            day.hung++;
+            memcpy(__start_sim_rtc_data, powerOnRtc.data(), rtcSize);
+            deviceOffsetUs = -static_cast<int64_t>(trueUs);
+            bme680HeaterMs = 0;
+            clockSet = false;
+            resetReason = ESP_RST_POWERON;
+        } else {
+            printf("Device went to sleep without a wake-up source at %.2f h\n", (trueUs - startUs) / 3.6e9);
+            break;
+        }
+    }
+
+    const double simulatedDays = (trueUs - startUs) / static_cast<double>(US_PER_DAY);
+    printf("%-8s %7s %8s %9s %9s %8s %10s %9s %8s %7s %6s %5s %6s %8s\n", "", "wakes", "awake_s", "radio_s", "ms/wake",
+           "max_ms", "bytes_tx", "bytes_rx", "requests", "failed", "dups", "hung", "ntp", "clock_ms");
+
+    DayStats total = DayStats();
+    for (size_t i = 0; i < stats.size(); i++) {
+        const DayStats& day = stats[i];
+        if (daily) {
+            char label[32];
+            snprintf(label, sizeof(label), "day %zu", i + 1);
+            printRow(label, day, 1.0);
+        }
+        total.wakes += day.wakes;
+        total.hung += day.hung;
+        total.awakeUs += day.awakeUs;
+        if (day.maxAwakeUs > total.maxAwakeUs) total.maxAwakeUs = day.maxAwakeUs;
+        total.radioUs += day.radioUs;
+        total.bytesSent += day.bytesSent;
+        total.bytesReceived += day.bytesReceived;
+        total.requests += day.requests;
+        total.failedRequests += day.failedRequests;
+        total.duplicates += day.duplicates;
+        total.ntpSyncs += day.ntpSyncs;
+        if (day.maxClockErrorUs > total.maxClockErrorUs) total.maxClockErrorUs = day.maxClockErrorUs;
+    }
+    printRow("per day", total, simulatedDays > 0 ? simulatedDays : 1.0);
+    printf("%u boots, %zu chunks accepted by the server\n", boots, accepted.size());
+    return 0;
+}
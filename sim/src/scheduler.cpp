@@ -0,0 +1,328 @@
+// Virtual clock and cooperative task scheduler behind the FreeRTOS stand-ins
+#include "sim.hpp"
+#include <Arduino.h>
+#include <ucontext.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+namespace {
+
+static const uint64_t NEVER = UINT64_MAX;
+static const int MAX_TASKS = 4;
+static const int MAX_EVENTS = 16;
+static const int MAX_EVENT_GROUPS = 4;
+static const size_t TASK_STACK_BYTES = 256 * 1024;  // Host frames are larger than on the chip
+
+struct EventGroup {
+    EventBits_t bits;
+};
+
+struct Task {
+    bool used;
+    bool finished;
+    ucontext_t context;
+    uint8_t* stack;
+    TaskFunction_t function;
+    void* parameters;
+    uint64_t wakeAt;           // NEVER while waiting for a notification or bits only
+    uint32_t notifications;
+    bool waitingNotify;
+    EventGroup* waitGroup;
+    EventBits_t waitBits;
+    bool waitAll;
+};
+
+struct TimedEvent {
+    bool used;
+    uint64_t at;
+    void (*callback)(void*);
+    void* context;
+};
+
+static uint64_t clockUs = 0;
+static Task tasks[MAX_TASKS];
+static int current = 0;
+static TimedEvent events[MAX_EVENTS];
+static EventGroup groups[MAX_EVENT_GROUPS];
+static int groupCount = 0;
+
+static bool bitsSatisfied(const Task& task) {
+    const EventBits_t set = task.waitGroup->bits & task.waitBits;
+    return task.waitAll ? set == task.waitBits : set != 0;
+}
+
+static bool runnable(const Task& task) {
+    if (!task.used || task.finished) return false;
+    if (task.wakeAt <= clockUs) return true;
+    if (task.waitingNotify && task.notifications > 0) return true;
+    return task.waitGroup != nullptr && bitsSatisfied(task);
+}
+
+static int nextEvent() {
+    int next = -1;
+    for (int i = 0; i < MAX_EVENTS; i++) {
+        if (events[i].used && (next < 0 || events[i].at < events[next].at)) next = i;
+    }
+    return next;
+}
+
+// Hands the CPU to the next runnable task, advancing the virtual clock
+// through timed events while every task is blocked
+static void reschedule() {
+    while (true) {
+        // Let other tasks run before the current one continues
+        for (int offset = 1; offset <= MAX_TASKS; offset++) {
+            const int index = (current + offset) % MAX_TASKS;
+            if (!runnable(tasks[index])) continue;
+            if (index != current) {
+                const int previous = current;
+                current = index;
+                swapcontext(&tasks[previous].context, &tasks[index].context);
+            }
+            return;
+        }
+
+        uint64_t wake = NEVER;
+        for (int i = 0; i < MAX_TASKS; i++) {
+            if (tasks[i].used && !tasks[i].finished && tasks[i].wakeAt < wake) wake = tasks[i].wakeAt;
+        }
+
+        const int event = nextEvent();
+        if (event >= 0 && events[event].at <= wake) {
+            if (events[event].at > clockUs) clockUs = events[event].at;
+            events[event].used = false;
+            events[event].callback(events[event].context);
+            continue;
+        }
+
+        if (wake > sim::MAX_BOOT_US && wake != NEVER) {
+            Serial.println("[sim] Boot exceeded the awake limit");
+            sim::endBoot(sim::BootOutcome::HUNG, 0);
+        }
+        if (wake == NEVER) {
+            Serial.println("[sim] All tasks blocked with nothing scheduled");
+            sim::endBoot(sim::BootOutcome::HUNG, 0);
+        }
+        clockUs = wake;
+    }
+}
+
+static void block(uint64_t until) {
+    tasks[current].wakeAt = until;
+    reschedule();
+    tasks[current].wakeAt = NEVER;
+    tasks[current].waitingNotify = false;
+    tasks[current].waitGroup = nullptr;
+}
+
+static uint64_t ticksToDeadline(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? NEVER : clockUs + static_cast<uint64_t>(ticks) * portTICK_PERIOD_MS * 1000;
+}
+
+static void taskEntry() {
+    Task& task = tasks[current];
+    task.function(task.parameters);
+    vTaskDelete(nullptr);
+}
+
+static struct SchedulerInit {
+    SchedulerInit() {
+        tasks[0].used = true;   // The loop task running setup()
+        tasks[0].wakeAt = NEVER;
+    }
+} schedulerInit;
+
+}  // namespace
+
+namespace sim {
+
+uint64_t now() {
+    return clockUs;
+}
+
+void sleepUntil(uint64_t until) {
+    if (until < clockUs) until = clockUs;
+    block(until);
+}
+
+void sleepFor(uint64_t us) {
+    sleepUntil(clockUs + us);
+}
+
+void schedule(uint64_t at, void (*callback)(void*), void* context) {
+    for (int i = 0; i < MAX_EVENTS; i++) {
+        if (events[i].used) continue;
+        events[i] = {true, at, callback, context};
+        return;
+    }
+    Serial.println("[sim] Timed event queue full");
+}
+
+}  // namespace sim
+
+unsigned long millis() {
+    return static_cast<unsigned long>(clockUs / 1000);
+}
+
+unsigned long micros() {
+    return static_cast<unsigned long>(clockUs);
+}
+
+int64_t esp_timer_get_time() {
+    return static_cast<int64_t>(clockUs);
+}
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    uint32_t generation;   // Bumped by start and stop, so stale events do nothing
+    bool armed;
+};
+
+// Timed events cannot be removed, so each carries the generation it was armed with
+struct TimerShot {
+    esp_timer* timer;
+    uint32_t generation;
+};
+
+static void fireTimer(void* context) {
+    TimerShot* shot = static_cast<TimerShot*>(context);
+    esp_timer* timer = shot->timer;
+    const bool current = timer->armed && timer->generation == shot->generation;
+    delete shot;
+    if (!current) return;
+    timer->armed = false;
+    timer->args.callback(timer->args.arg);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle) {
+    *out_handle = new esp_timer{*create_args, 0, false};
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    timer->generation++;
+    timer->armed = true;
+    sim::schedule(clockUs + timeout_us, fireTimer, new TimerShot{timer, timer->generation});
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    timer->generation++;
+    timer->armed = false;
+    return ESP_OK;
+}
+
+void delay(unsigned long ms) {
+    sim::sleepFor(static_cast<uint64_t>(ms) * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    sim::sleepFor(us);
+}
+
+void yield() {
+    sim::sleepFor(0);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority,
+                                   TaskHandle_t* createdTask, BaseType_t coreId) {
+    for (int i = 1; i < MAX_TASKS; i++) {
+        Task& task = tasks[i];
+        if (task.used) continue;
+
+        task = Task();
+        task.used = true;
+        task.function = function;
+        task.parameters = parameters;
+        task.wakeAt = clockUs;
+        task.stack = new uint8_t[TASK_STACK_BYTES];
+        getcontext(&task.context);
+        task.context.uc_stack.ss_sp = task.stack;
+        task.context.uc_stack.ss_size = TASK_STACK_BYTES;
+        task.context.uc_link = nullptr;
+        makecontext(&task.context, taskEntry, 0);
+
+        if (createdTask != nullptr) *createdTask = &task;
+        return pdPASS;
+    }
+    return pdFAIL;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return &tasks[current];
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    Task* task = handle == nullptr ? &tasks[current] : static_cast<Task*>(handle);
+    task->finished = true;
+    // The stack is released with the process at the end of the boot
+    if (task == &tasks[current]) reschedule();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    sim::sleepFor(static_cast<uint64_t>(ticks) * portTICK_PERIOD_MS * 1000);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+    static_cast<Task*>(handle)->notifications++;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    Task& task = tasks[current];
+    if (task.notifications == 0) {
+        task.waitingNotify = true;
+        block(ticksToDeadline(ticksToWait));
+    }
+
+    Task& self = tasks[current];
+    const uint32_t count = self.notifications;
+    if (clearOnExit) {
+        self.notifications = 0;
+    } else if (count > 0) {
+        self.notifications--;
+    }
+    return count;
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+    if (groupCount >= MAX_EVENT_GROUPS) return nullptr;
+    groups[groupCount].bits = 0;
+    return &groups[groupCount++];
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t handle, EventBits_t bits) {
+    EventGroup* group = static_cast<EventGroup*>(handle);
+    group->bits |= bits;
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t handle, EventBits_t bits) {
+    EventGroup* group = static_cast<EventGroup*>(handle);
+    const EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t handle, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t ticksToWait) {
+    EventGroup* group = static_cast<EventGroup*>(handle);
+    Task& task = tasks[current];
+    task.waitGroup = group;
+    task.waitBits = bits;
+    task.waitAll = waitForAll;
+
+    if (!bitsSatisfied(task)) {
+        block(ticksToDeadline(ticksToWait));
+    } else {
+        task.waitGroup = nullptr;
+    }
+
+    const EventBits_t result = group->bits;
+    const EventBits_t set = result & bits;
+    if (clearOnExit && (waitForAll ? set == bits : set != 0)) group->bits &= ~bits;
+    return result;
+}
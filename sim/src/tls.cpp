@@ -0,0 +1,146 @@
+// Pass-through mbedtls stand-in: no encryption, handshakes cost virtual time
+#include "sim.hpp"
+#include <string.h>
+#include "mbedtls/ssl.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+
+// Handshake traffic that never reaches the ingest server's parser
+static const uint32_t FULL_HANDSHAKE_SENT = 400;
+static const uint32_t FULL_HANDSHAKE_RECEIVED = 4000;    // Certificate chain
+static const uint32_t RESUMED_HANDSHAKE_SENT = 250;
+static const uint32_t RESUMED_HANDSHAKE_RECEIVED = 150;
+
+static uint32_t nextSessionId = 1;
+
+void mbedtls_ssl_init(mbedtls_ssl_context* ssl) {
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+void mbedtls_ssl_free(mbedtls_ssl_context* ssl) {
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config* conf) {}
+void mbedtls_ssl_config_free(mbedtls_ssl_config* conf) {}
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* conf, int endpoint, int transport, int preset) {
+    return 0;
+}
+
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config* conf, int authmode) {}
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* conf, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng) {}
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config* conf, int use_tickets) {}
+
+int mbedtls_ssl_setup(mbedtls_ssl_context* ssl, const mbedtls_ssl_config* conf) {
+    return 0;
+}
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context* ssl, const char* hostname) {
+    return 0;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* ssl, void* p_bio, mbedtls_ssl_send_t* f_send,
+                         mbedtls_ssl_recv_t* f_recv, mbedtls_ssl_recv_timeout_t* f_recv_timeout) {
+    ssl->bio = p_bio;
+    ssl->send = f_send;
+    ssl->recv = f_recv;
+}
+
+int mbedtls_ssl_handshake(mbedtls_ssl_context* ssl) {
+    if (ssl->handshakeDone) return 0;
+
+    // The simulated server accepts every session it is offered
+    if (ssl->resuming) {
+        sim::sleepFor(sim::linkModel->resumedHandshakeMs * 1000ULL);
+        sim::boot->bytesSent += RESUMED_HANDSHAKE_SENT;
+        sim::boot->bytesReceived += RESUMED_HANDSHAKE_RECEIVED;
+    } else {
+        sim::sleepFor(sim::linkModel->fullHandshakeMs * 1000ULL);
+        sim::boot->bytesSent += FULL_HANDSHAKE_SENT;
+        sim::boot->bytesReceived += FULL_HANDSHAKE_RECEIVED;
+        ssl->session.id = nextSessionId++;
+    }
+    ssl->handshakeDone = true;
+    return 0;
+}
+
+int mbedtls_ssl_read(mbedtls_ssl_context* ssl, unsigned char* buf, size_t len) {
+    if (ssl->recordStart == ssl->recordEnd) {
+        const int received = ssl->recv(ssl->bio, ssl->record, sizeof(ssl->record));
+        if (received <= 0) return received;
+        ssl->recordStart = 0;
+        ssl->recordEnd = received;
+    }
+
+    size_t count = ssl->recordEnd - ssl->recordStart;
+    if (count > len) count = len;
+    memcpy(buf, ssl->record + ssl->recordStart, count);
+    ssl->recordStart += count;
+    return static_cast<int>(count);
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context* ssl, const unsigned char* buf, size_t len) {
+    return ssl->send(ssl->bio, buf, len);
+}
+
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context* ssl) {
+    return ssl->recordEnd - ssl->recordStart;
+}
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* ssl) {
+    return 0;
+}
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session* session) {
+    session->id = 0;
+}
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session* session) {
+    session->id = 0;
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context* ssl, mbedtls_ssl_session* session) {
+    *session = ssl->session;
+    return 0;
+}
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context* ssl, const mbedtls_ssl_session* session) {
+    ssl->session = *session;
+    ssl->resuming = session->id != 0;
+    return 0;
+}
+
+int mbedtls_ssl_session_save(const mbedtls_ssl_session* session, unsigned char* buf, size_t buf_len, size_t* olen) {
+    *olen = sizeof(session->id);
+    if (buf_len < *olen) return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+    memcpy(buf, &session->id, sizeof(session->id));
+    return 0;
+}
+
+int mbedtls_ssl_session_load(mbedtls_ssl_session* session, const unsigned char* buf, size_t len) {
+    if (len != sizeof(session->id)) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    memcpy(&session->id, buf, sizeof(session->id));
+    return 0;
+}
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx) {}
+void mbedtls_entropy_free(mbedtls_entropy_context* ctx) {}
+
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len) {
+    memset(output, 0, len);
+    return 0;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* ctx) {}
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context* ctx) {}
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t),
+                          void* p_entropy, const unsigned char* custom, size_t len) {
+    return 0;
+}
+
+int mbedtls_ctr_drbg_random(void* p_rng, unsigned char* output, size_t output_len) {
+    memset(output, 0, output_len);
+    return 0;
+}
@@ -0,0 +1,319 @@
+// WiFi station and TCP stand-ins, connected to an in-process ingest server
+#include "sim.hpp"
+#include <WiFi.h>
+#include <string>
+#include <strings.h>
+
+WiFiClass WiFi;
+
+static const uint8_t SIM_BSSID[6] = {0x02, 0x00, 0x5e, 0x10, 0x00, 0x01};
+static const int32_t SIM_CHANNEL = 6;
+static const int MAX_EVENT_HANDLERS = 4;
+
+static struct {
+    bool associated;
+    bool apMissing;
+    bool staticAddress;
+    uint32_t attempt;      // Invalidates pending events from an abandoned attempt
+    WiFiEventCb handlers[MAX_EVENT_HANDLERS];
+    arduino_event_id_t filters[MAX_EVENT_HANDLERS];
+    int handlerCount;
+} station;
+
+static void dispatch(arduino_event_id_t event) {
+    for (int i = 0; i < station.handlerCount; i++) {
+        if (station.filters[i] == ARDUINO_EVENT_MAX || station.filters[i] == event) station.handlers[i](event);
+    }
+}
+
+static void onAssociated(void* context) {
+    if (reinterpret_cast<uintptr_t>(context) != station.attempt) return;
+    station.associated = true;
+    dispatch(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    dispatch(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+}
+
+static void onApMissing(void* context) {
+    if (reinterpret_cast<uintptr_t>(context) != station.attempt) return;
+    station.apMissing = true;
+    dispatch(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+}
+
+bool sim::linkUp() {
+    return station.associated;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel,
+                             const uint8_t* bssid, bool connect) {
+    sim::radioOn();
+    station.associated = false;
+    station.apMissing = false;
+    void* attempt = reinterpret_cast<void*>(static_cast<uintptr_t>(++station.attempt));
+
+    if (sim::faultActive(sim::FaultType::WIFI_OUTAGE)) {
+        sim::schedule(sim::now() + sim::linkModel->outageTimeoutMs * 1000ULL, onApMissing, attempt);
+        return WL_DISCONNECTED;
+    }
+
+    // A known BSSID and channel skip the scan, a static address skips DHCP
+    uint32_t latencyMs = sim::linkModel->associateMs;
+    if (bssid == nullptr || channel == 0) latencyMs += sim::linkModel->scanMs;
+    if (!station.staticAddress) latencyMs += sim::linkModel->dhcpMs;
+    sim::schedule(sim::now() + latencyMs * 1000ULL, onAssociated, attempt);
+    return WL_DISCONNECTED;
+}
+
+bool WiFiClass::config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+    station.staticAddress = static_cast<uint32_t>(local) != 0;
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    if (station.associated) return WL_CONNECTED;
+    return station.apMissing ? WL_NO_SSID_AVAIL : WL_DISCONNECTED;
+}
+
+bool WiFiClass::isConnected() {
+    return station.associated;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+    station.associated = false;
+    station.attempt++;
+    if (wifioff) sim::radioOff();
+    return true;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    if (mode == WIFI_OFF) {
+        disconnect(true);
+    } else {
+        sim::radioOn();
+    }
+    return true;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventCb callback, arduino_event_id_t event) {
+    if (station.handlerCount >= MAX_EVENT_HANDLERS) return 0;
+    station.handlers[station.handlerCount] = callback;
+    station.filters[station.handlerCount] = event;
+    return ++station.handlerCount;
+}
+
+int8_t WiFiClass::RSSI() {
+    return station.associated ? static_cast<int8_t>(sim::sample(sim::scenario->rssi)) : 0;
+}
+
+uint8_t* WiFiClass::BSSID() {
+    static uint8_t bssid[6];
+    memcpy(bssid, SIM_BSSID, sizeof(bssid));
+    return bssid;
+}
+
+int32_t WiFiClass::channel() {
+    return SIM_CHANNEL;
+}
+
+IPAddress WiFiClass::localIP() {
+    return IPAddress(192, 168, 1, 50);
+}
+
+IPAddress WiFiClass::gatewayIP() {
+    return IPAddress(192, 168, 1, 1);
+}
+
+IPAddress WiFiClass::subnetMask() {
+    return IPAddress(255, 255, 255, 0);
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t index) {
+    return IPAddress(192, 168, 1, 1);
+}
+
+// Server side of one connection: parses HTTP/1.1 requests with a
+// Content-Length or chunked body and answers each once it is complete
+struct SimConnection {
+    enum State { HEADERS, BODY, CHUNK_SIZE, CHUNK_DATA, CHUNK_END, TRAILER };
+
+    bool open;
+    State state;
+    std::string line;          // Header or chunk-size line being collected
+    size_t remaining;
+    bool chunked;
+    bool keepAlive;
+    bool hasSequence;
+    uint32_t sequence;
+    std::string response;
+    size_t responseOffset;
+    uint64_t responseAt;       // Virtual time the response arrives
+
+    void reset() {
+        state = HEADERS;
+        line.clear();
+        remaining = 0;
+        chunked = false;
+        keepAlive = true;
+        hasSequence = false;
+        sequence = 0;
+    }
+
+    void parseHeader(const std::string& header) {
+        const size_t colon = header.find(':');
+        if (colon == std::string::npos) return;
+        const std::string name = header.substr(0, colon);
+        const char* value = header.c_str() + colon + 1;
+        while (*value == ' ') value++;
+
+        if (strcasecmp(name.c_str(), "Content-Length") == 0) {
+            remaining = strtoul(value, nullptr, 10);
+        } else if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0 && strcasecmp(value, "chunked") == 0) {
+            chunked = true;
+        } else if (strcasecmp(name.c_str(), "Connection") == 0) {
+            keepAlive = strcasecmp(value, "close") != 0;
+        } else if (strcasecmp(name.c_str(), "X-Upload-Sequence") == 0) {
+            hasSequence = true;
+            sequence = strtoul(value, nullptr, 10);
+        }
+    }
+
+    void complete() {
+        sim::BootRecord& boot = *sim::boot;
+        boot.requests++;
+
+        const bool failing = sim::faultActive(sim::FaultType::SERVER_ERROR);
+        if (failing) {
+            boot.failedRequests++;
+        } else if (hasSequence && boot.sequenceCount < sim::MAX_SEQUENCES_PER_BOOT) {
+            boot.sequences[boot.sequenceCount++] = sequence;
+        }
+
+        response += failing ? "HTTP/1.1 503 Service Unavailable\r\n" : "HTTP/1.1 200 OK\r\n";
+        response += "Content-Length: 0\r\n";
+        response += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        responseAt = sim::now() + (sim::linkModel->roundTripMs + sim::linkModel->serverMs) * 1000ULL;
+        if (!keepAlive) open = false;
+        reset();
+    }
+
+    void receive(char c) {
+        switch (state) {
+            case HEADERS:
+                line += c;
+                if (line.size() >= 2 && line.compare(line.size() - 2, 2, "\r\n") == 0) {
+                    line.resize(line.size() - 2);
+                    if (!line.empty()) {
+                        parseHeader(line);
+                        line.clear();
+                    } else {
+                        line.clear();
+                        state = chunked ? CHUNK_SIZE : BODY;
+                        if (!chunked && remaining == 0) complete();
+                    }
+                }
+                break;
+            case BODY:
+                if (--remaining == 0) complete();
+                break;
+            case CHUNK_SIZE:
+                line += c;
+                if (c == '\n') {
+                    remaining = strtoul(line.c_str(), nullptr, 16);
+                    line.clear();
+                    state = remaining == 0 ? TRAILER : CHUNK_DATA;
+                }
+                break;
+            case CHUNK_DATA:
+                if (--remaining == 0) state = CHUNK_END;
+                break;
+            case CHUNK_END:
+                if (c == '\n') state = CHUNK_SIZE;
+                break;
+            case TRAILER:
+                line += c;
+                if (c == '\n') {
+                    const bool last = line == "\r\n";
+                    line.clear();
+                    if (last) complete();
+                }
+                break;
+        }
+    }
+};
+
+WiFiClient::WiFiClient() : connection(new SimConnection()) {
+    connection->open = false;
+    connection->responseOffset = 0;
+    connection->responseAt = 0;
+    connection->reset();
+}
+
+WiFiClient::~WiFiClient() {
+    delete connection;
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    stop();
+    if (!station.associated) return 0;
+
+    // DNS lookup plus the TCP handshake
+    sim::sleepFor(2ULL * sim::linkModel->roundTripMs * 1000);
+    if (sim::faultActive(sim::FaultType::SERVER_DOWN)) return 0;
+
+    connection->open = true;
+    return 1;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    if (!connected()) return 0;
+
+    sim::sleepFor(static_cast<uint64_t>(size) * 1000 / sim::linkModel->bytesPerMs);
+    sim::boot->bytesSent += size;
+    for (size_t i = 0; i < size; i++) connection->receive(static_cast<char>(buffer[i]));
+    return size;
+}
+
+int WiFiClient::available() {
+    if (!station.associated || sim::now() < connection->responseAt) return 0;
+    return static_cast<int>(connection->response.size() - connection->responseOffset);
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    const int ready = available();
+    if (ready <= 0) return -1;
+
+    const size_t count = size < static_cast<size_t>(ready) ? size : ready;
+    memcpy(buffer, connection->response.data() + connection->responseOffset, count);
+    connection->responseOffset += count;
+    sim::boot->bytesReceived += count;
+
+    if (connection->responseOffset == connection->response.size()) {
+        connection->response.clear();
+        connection->responseOffset = 0;
+    }
+    return static_cast<int>(count);
+}
+
+int WiFiClient::peek() {
+    return available() > 0 ? static_cast<uint8_t>(connection->response[connection->responseOffset]) : -1;
+}
+
+void WiFiClient::stop() {
+    connection->open = false;
+    connection->response.clear();
+    connection->responseOffset = 0;
+    connection->reset();
+}
+
+uint8_t WiFiClient::connected() {
+    // Like lwIP, unread response bytes keep a closed connection readable
+    return station.associated && (connection->open || available() > 0);
+}
@@ -0,0 +1,95 @@
+#include "adc_sampler.hpp"
+#include <Arduino.h>
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+#include "config.hpp"
+#include "logging.hpp"
+
+bool AdcSampler::initialized = false;
+static esp_adc_cal_characteristics_t calibration;
+
+void AdcSampler::begin() {
+    if (initialized) return;
+
+    const esp_adc_cal_value_t source = esp_adc_cal_characterize(
+        ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, ADC_DEFAULT_VREF_MV, &calibration);
+    initialized = true;
+
+    LOG_INFO(SENSOR, "ADC calibration: %s",
+             source == ESP_ADC_CAL_VAL_EFUSE_TP ? "eFuse two-point" :
+             source == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref" : "default Vref");
+}
+
+bool AdcSampler::captureContinuous(int channel, uint16_t* samples, size_t& count) {
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = ADC_SAMPLES_PER_CHANNEL * sizeof(adc_digi_output_data_t) * 2;
+    init.conv_num_each_intr = ADC_DMA_FRAME_BYTES;
+    init.adc1_chan_mask = BIT(channel);
+    init.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&init) != ESP_OK) return false;
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;
+    pattern.channel = channel;
+    pattern.unit = 0;  // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = true;   // Required on the ESP32
+    config.conv_limit_num = 255;
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = ADC_SAMPLE_RATE_HZ;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+    bool ok = adc_digi_controller_configure(&config) == ESP_OK && adc_digi_start() == ESP_OK;
+
+    uint8_t frame[ADC_DMA_FRAME_BYTES];
+    const unsigned long start = millis();
+    count = 0;
+    while (ok && count < ADC_SAMPLES_PER_CHANNEL && millis() - start < ADC_CAPTURE_TIMEOUT_MS) {
+        uint32_t length = 0;
+        if (adc_digi_read_bytes(frame, sizeof(frame), &length, ADC_CAPTURE_TIMEOUT_MS) != ESP_OK) continue;
+
+        for (uint32_t i = 0; i + sizeof(adc_digi_output_data_t) <= length && count < ADC_SAMPLES_PER_CHANNEL;
+             i += sizeof(adc_digi_output_data_t)) {
+            const adc_digi_output_data_t* result = reinterpret_cast<const adc_digi_output_data_t*>(frame + i);
+            if (result->type1.channel == channel) samples[count++] = result->type1.data;
+        }
+    }
+
+    adc_digi_stop();
+    adc_digi_deinitialize();
+    return ok && count > 0;
+}
+
+bool AdcSampler::capture(int pin, SampleStats& stats) {
+    begin();
+
+    uint16_t samples[ADC_SAMPLES_PER_CHANNEL];
+    size_t count = 0;
+    const int channel = digitalPinToAnalogChannel(pin);
+
+    // Continuous mode is ADC1 only; ADC2 pins report channel numbers from 10 up
+    if (channel < 0 || channel >= 10 || !captureContinuous(channel, samples, count)) {
+        LOG_WARN(SENSOR, "ADC continuous capture unavailable on pin %d, using one-shot reads", pin);
+        for (count = 0; count < ADC_SAMPLES_PER_CHANNEL; count++) {
+            samples[count] = analogRead(pin);
+        }
+    }
+
+    return computeSampleStats(samples, count, ADC_TRIM_FRACTION, stats);
+}
+
+float AdcSampler::toMillivolts(float raw) {
+    begin();
+
+    // Interpolate between neighbouring counts to keep the oversampled precision
+    if (raw < 0.0f) raw = 0.0f;
+    const uint32_t lower = static_cast<uint32_t>(raw);
+    const float fraction = raw - lower;
+    const float low = esp_adc_cal_raw_to_voltage(lower, &calibration);
+    const float high = esp_adc_cal_raw_to_voltage(lower + 1, &calibration);
+    return low + (high - low) * fraction;
+}
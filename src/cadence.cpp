@@ -0,0 +1,61 @@
+#include "cadence.hpp"
+#include <math.h>
+#include "logging.hpp"
+
+static_assert(METRIC_COUNT <= 16, "referenceMask holds at most 16 metrics");
+
+RTC_DATA_ATTR CadenceState cadenceState = {{}, 0, -1.0f, 0};
+
+static const CadenceLimit& limitFor(float batteryPercent) {
+    if (batteryPercent < 0.0f) return CADENCE_LIMITS[0];
+    for (int i = 0; i < CADENCE_LIMIT_COUNT; i++) {
+        if (batteryPercent >= CADENCE_LIMITS[i].batteryPercent) return CADENCE_LIMITS[i];
+    }
+    return CADENCE_LIMITS[CADENCE_LIMIT_COUNT - 1];
+}
+
+static uint32_t clampStride(uint32_t stride, const CadenceLimit& limit) {
+    if (stride < limit.minStride) return limit.minStride;
+    return stride > limit.maxStride ? limit.maxStride : stride;
+}
+
+bool updateCadence(const SensorData& data) {
+    bool moved = false;
+    for (int i = 0; i < data.numDataPoints; i++) {
+        const DataPoint& point = data.dataPoints[i];
+        const int metric = static_cast<int>(point.metric);
+        if (point.metric == MetricId::BATTERY_PERCENT) cadenceState.batteryPercent = point.value;
+        if (!METRIC_FILTERS[metric].cadence) continue;
+
+        // Only a metric that moved takes a new reference, so slow drifts add up
+        const uint16_t bit = 1u << metric;
+        const float delta = point.value - cadenceState.reference[metric];
+        if ((cadenceState.referenceMask & bit) && fabsf(delta) <= METRIC_FILTERS[metric].deadband) continue;
+        if (cadenceState.referenceMask & bit) {
+            LOG_DEBUG(TIME, "Cadence: %s moved by %.2f", getMetricName(point.metric), delta);
+            moved = true;
+        }
+        cadenceState.reference[metric] = point.value;
+        cadenceState.referenceMask |= bit;
+    }
+
+    const CadenceLimit& limit = limitFor(cadenceState.batteryPercent);
+    const uint8_t previous = cadenceState.stride;
+    cadenceState.stride = static_cast<uint8_t>(clampStride(moved ? limit.minStride : previous * 2u, limit));
+
+    if (cadenceState.stride != previous) {
+        LOG_INFO(TIME, "Cadence stride %u -> %u (%s)", previous, cadenceState.stride,
+                 moved ? "change" : "stable");
+    }
+    return moved;
+}
+
+uint32_t cadenceStride() {
+    if (!CADENCE_ENABLED || cadenceState.stride == 0) return 1;
+    return cadenceState.stride;
+}
+
+uint32_t maxCadenceStride() {
+    if (!CADENCE_ENABLED) return 1;
+    return clampStride(cadenceState.stride * 2u, limitFor(cadenceState.batteryPercent));
+}
@@ -0,0 +1,89 @@
+#include "cbor_writer.hpp"
+#include <string.h>
+
+static const uint8_t MAJOR_UINT = 0;
+static const uint8_t MAJOR_NEGINT = 1;
+static const uint8_t MAJOR_TEXT = 3;
+static const uint8_t MAJOR_ARRAY = 4;
+static const uint8_t MAJOR_MAP = 5;
+
+CborWriter::CborWriter(Print& out)
+    : out(out) {}
+
+void CborWriter::writeHead(uint8_t majorType, uint32_t value) {
+    const uint8_t major = majorType << 5;
+    uint8_t head[5];
+
+    if (value < 24) {
+        head[0] = major | value;
+        out.write(head, 1);
+    } else if (value <= 0xFF) {
+        head[0] = major | 24;
+        head[1] = value;
+        out.write(head, 2);
+    } else if (value <= 0xFFFF) {
+        head[0] = major | 25;
+        head[1] = value >> 8;
+        head[2] = value;
+        out.write(head, 3);
+    } else {
+        head[0] = major | 26;
+        head[1] = value >> 24;
+        head[2] = value >> 16;
+        head[3] = value >> 8;
+        head[4] = value;
+        out.write(head, 5);
+    }
+}
+
+void CborWriter::writeUint(uint32_t value) {
+    writeHead(MAJOR_UINT, value);
+}
+
+void CborWriter::writeInt(int32_t value) {
+    if (value >= 0) {
+        writeHead(MAJOR_UINT, value);
+    } else {
+        writeHead(MAJOR_NEGINT, static_cast<uint32_t>(-(value + 1)));
+    }
+}
+
+void CborWriter::writeFloat(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint8_t encoded[5] = {
+        0xFA,  // Major type 7, single-precision float
+        static_cast<uint8_t>(bits >> 24),
+        static_cast<uint8_t>(bits >> 16),
+        static_cast<uint8_t>(bits >> 8),
+        static_cast<uint8_t>(bits)
+    };
+    out.write(encoded, sizeof(encoded));
+}
+
+void CborWriter::writeText(const char* text) {
+    const size_t length = strlen(text);
+    writeHead(MAJOR_TEXT, length);
+    out.write(reinterpret_cast<const uint8_t*>(text), length);
+}
+
+void CborWriter::beginArray(uint32_t size) {
+    writeHead(MAJOR_ARRAY, size);
+}
+
+void CborWriter::beginMap(uint32_t size) {
+    writeHead(MAJOR_MAP, size);
+}
+
+void CborWriter::beginIndefiniteArray() {
+    out.write(static_cast<uint8_t>((MAJOR_ARRAY << 5) | 31));
+}
+
+void CborWriter::beginIndefiniteMap() {
+    out.write(static_cast<uint8_t>((MAJOR_MAP << 5) | 31));
+}
+
+void CborWriter::writeBreak() {
+    out.write(static_cast<uint8_t>(0xFF));
+}
@@ -1,31 +1,362 @@
 #include "data_manager.hpp"
 #include "time_manager.hpp"
+#include "spill_log.hpp"
+#include "wake_profiler.hpp"
 #include <Arduino.h>
+#include "logging.hpp"
 
-void storeReading(const SensorData& data) {
-    if (storedReadings.count >= MAX_READINGS) {
-        Serial.println("Warning: Storage full, cannot store more readings");
+static ReadingBlock& blockAt(int offset) {
+    return storedReadings.blocks[(storedReadings.headBlock + offset) % RAW_BLOCK_COUNT];
+}
+
+static AggregateBucket& bucketAt(AggregateTier& tier, int offset) {
+    return tier.buckets[(tier.head + offset) % AGGREGATE_BUCKETS_PER_TIER];
+}
+
+static void mergeBucket(AggregateBucket& target, const AggregateBucket& source) {
+    for (int i = 0; i < source.numValues; i++) {
+        const AggregateValue& value = source.values[i];
+
+        AggregateValue* slot = nullptr;
+        for (int j = 0; j < target.numValues; j++) {
+            if (target.values[j].metric == value.metric) {
+                slot = &target.values[j];
+                break;
+            }
+        }
+
+        if (slot == nullptr) {
+            if (target.numValues >= MAX_DATA_POINTS_PER_READING) continue;
+            slot = &target.values[target.numValues++];
+            *slot = value;
+            continue;
+        }
+
+        const float total = static_cast<float>(slot->samples) + value.samples;
+        slot->mean += (value.mean - slot->mean) * value.samples / total;
+        if (value.min < slot->min) slot->min = value.min;
+        if (value.max > slot->max) slot->max = value.max;
+        slot->samples += value.samples;
+    }
+
+    target.readings += source.readings;
+}
+
+static void mergeIntoTier(int tierIndex, const AggregateBucket& source) {
+    AggregateTier& tier = storedReadings.tiers[tierIndex];
+    const uint32_t span = AGGREGATE_TIER_SPAN[tierIndex];
+    const uint32_t start = source.start - source.start % span;
+
+    // Late or out-of-order data joins the newest bucket
+    if (tier.count > 0) {
+        AggregateBucket& newest = bucketAt(tier, tier.count - 1);
+        if (start <= newest.start) {
+            mergeBucket(newest, source);
+            return;
+        }
+    }
+
+    if (tier.count == AGGREGATE_BUCKETS_PER_TIER) {
+        if (tierIndex + 1 < AGGREGATE_TIER_COUNT) {
+            mergeIntoTier(tierIndex + 1, bucketAt(tier, 0));
+        } else {
+            LOG_WARN(STORAGE, "Aggregate history full, dropping oldest bucket");
+        }
+        tier.head = (tier.head + 1) % AGGREGATE_BUCKETS_PER_TIER;
+        tier.count--;
+    }
+
+    AggregateBucket& bucket = bucketAt(tier, tier.count);
+    bucket.start = start;
+    bucket.span = span;
+    bucket.readings = 0;
+    bucket.numValues = 0;
+    tier.count++;
+
+    mergeBucket(bucket, source);
+}
+
+static void decimateReading(const StoredReading& reading) {
+    AggregateBucket sample;
+    sample.start = reading.timestamp;
+    sample.span = 0;
+    sample.readings = 1;
+    sample.numValues = reading.numDataPoints;
+
+    for (int i = 0; i < reading.numDataPoints; i++) {
+        const DataPoint& point = reading.dataPoints[i];
+        sample.values[i] = {point.metric, 1, point.value, point.value, point.value};
+    }
+
+    mergeIntoTier(0, sample);
+    storedReadings.bucketGeneration++;
+}
+
+static void evictOldestBlock(bool decimate) {
+    ReadingBlock& block = blockAt(0);
+
+    if (decimate) {
+        ReadingBlockDecoder decoder(block);
+        StoredReading reading;
+
+        while (decoder.next(reading)) {
+            decimateReading(reading);
+        }
+    }
+
+    const int readings = block.count - block.skip;
+    LOG_WARN(STORAGE, "Storage full, %s %d oldest readings",
+             decimate ? "decimated" : "dropped", readings);
+
+    storedReadings.count -= readings;
+    storedReadings.headBlock = (storedReadings.headBlock + 1) % RAW_BLOCK_COUNT;
+    storedReadings.numBlocks--;
+    storedReadings.headGeneration++;
+}
+
+// Moves all sealed blocks to the flash log in one batch
+static void spillSealedBlocks() {
+    if (!SPILL_LOG_ENABLED || storedReadings.numBlocks < SPILL_FLUSH_BLOCKS) return;
+
+    const unsigned long startTime = millis();
+    int spilled = 0;
+    int readings = 0;
+    while (spilled < storedReadings.numBlocks && spillLogAppend(blockAt(spilled))) {
+        readings += blockAt(spilled).count - blockAt(spilled).skip;
+        spilled++;
+    }
+
+    // Blocks stay in RTC memory until the flash write is known to be durable
+    if (!spillLogFlush() || spilled == 0) {
+        LOG_ERROR(STORAGE, "Spill log write failed, keeping readings in RTC memory");
         return;
     }
 
-    StoredReading& reading = storedReadings.readings[storedReadings.count];
-    reading.timestamp = timeState.lastKnownTime;
-    reading.numDataPoints = 0;
-    
-    // Copy all data points
-    for (int i = 0; i < data.numDataPoints; i++) {
-        reading.dataPoints[i] = data.dataPoints[i];
-        reading.numDataPoints++;
+    storedReadings.headBlock = (storedReadings.headBlock + spilled) % RAW_BLOCK_COUNT;
+    storedReadings.numBlocks -= spilled;
+    storedReadings.count -= readings;
+    storedReadings.headGeneration++;
+
+    LOG_INFO(STORAGE, "Spilled %d blocks (%d readings, %d bytes) to flash in %lu ms",
+             spilled, readings, spilled * RAW_BLOCK_BYTES, millis() - startTime);
+}
+
+static bool startNewBlock() {
+    spillSealedBlocks();
+
+    if (storedReadings.numBlocks == RAW_BLOCK_COUNT) {
+        switch (STORAGE_OVERFLOW_POLICY) {
+            case OverflowPolicy::DROP_NEWEST:
+                return false;
+            case OverflowPolicy::DROP_OLDEST:
+                evictOldestBlock(false);
+                break;
+            case OverflowPolicy::DECIMATE:
+                evictOldestBlock(true);
+                break;
+        }
     }
-    
+
+    ReadingBlock& block = blockAt(storedReadings.numBlocks);
+    block.bitsUsed = 0;
+    block.count = 0;
+    block.skip = 0;
+    storedReadings.numBlocks++;
+    resetCodecState(storedReadings.encoder);
+    return true;
+}
+
+static bool appendToNewestBlock(const SensorData& data) {
+    if (storedReadings.numBlocks == 0) return false;
+
+    ReadingBlock& block = blockAt(storedReadings.numBlocks - 1);
+    BitWriter writer(block.data, RAW_BLOCK_BYTES, block.bitsUsed);
+
+    if (!encodeReading(writer, storedReadings.encoder, data, timeState.lastKnownTime)) {
+        return false;
+    }
+
+    block.bitsUsed = writer.position();
+    block.count++;
     storedReadings.count++;
+    return true;
+}
+
+void storeReading(const SensorData& data) {
+    PROFILE_PHASE(STORE);
+
+    // Acknowledgements move it on to whatever is still pending
+    if (!hasStoredReadings()) storedReadings.oldestUnsent = timeState.lastKnownTime;
+
+    if (!appendToNewestBlock(data)) {
+        if (!startNewBlock() || !appendToNewestBlock(data)) {
+            LOG_WARN(STORAGE, "Storage full, cannot store more readings");
+            return;
+        }
+    }
     
     // Debug output
-    Serial.println("\nStored reading #" + String(storedReadings.count));
-    Serial.println("-----------------------------------");
-    for (int i = 0; i < reading.numDataPoints; i++) {
-        Serial.printf("%s: %.2f\n", reading.dataPoints[i].type, reading.dataPoints[i].value);
+    LOG_DEBUG(STORAGE, "Stored reading #%d", storedReadings.count);
+    for (int i = 0; i < data.numDataPoints; i++) {
+        LOG_DEBUG(STORAGE, "%s: %.2f", getMetricName(data.dataPoints[i].metric), data.dataPoints[i].value);
+    }
+    LOG_DEBUG(STORAGE, "Total readings stored: %d", storedReadings.count);
+    LOG_DEBUG(STORAGE, "Storage used: %u of %d bytes (%.1f bytes/reading), %d aggregate buckets",
+              static_cast<unsigned>(storageBytesUsed()), RAW_BLOCK_BYTES * RAW_BLOCK_COUNT,
+              static_cast<float>(storageBytesUsed()) / storedReadings.count,
+              storedBucketCount());
+}
+
+// Oldest timestamp across the spill log, the buckets and the RTC ring. The
+// log is only read here, after an upload, never on a plain wake.
+static void refreshOldestUnsent() {
+    time_t oldest = 0;
+    StoredReading reading;
+
+    if (spillLogPendingRecords() > 0) {
+        SpillLogReader logReader;
+        ReadingBlock block;
+        if (logReader.next(block)) {
+            ReadingBlockDecoder decoder(block);
+            if (decoder.next(reading)) oldest = reading.timestamp;
+        }
+    }
+
+    AggregateBucketReader bucketReader;
+    const AggregateBucket* bucket;
+    if (bucketReader.next(bucket) && (oldest == 0 || bucket->start < oldest)) oldest = bucket->start;
+
+    StoredReadingReader reader;
+    if (reader.next(reading) && (oldest == 0 || reading.timestamp < oldest)) oldest = reading.timestamp;
+
+    storedReadings.oldestUnsent = oldest;
+}
+
+void clearStoredReadings() {
+    storedReadings.headBlock = 0;
+    storedReadings.numBlocks = 0;
+    storedReadings.count = 0;
+    resetCodecState(storedReadings.encoder);
+
+    for (int i = 0; i < AGGREGATE_TIER_COUNT; i++) {
+        storedReadings.tiers[i].head = 0;
+        storedReadings.tiers[i].count = 0;
+    }
+    storedReadings.headGeneration++;
+    storedReadings.bucketGeneration++;
+}
+
+void acknowledgeStoredReadings(int readings) {
+    while (readings > 0 && storedReadings.numBlocks > 0) {
+        ReadingBlock& block = blockAt(0);
+        const int unsent = block.count - block.skip;
+
+        // A partly acknowledged block stays, the next upload starts behind its skip
+        if (readings < unsent) {
+            block.skip += readings;
+            storedReadings.count -= readings;
+            break;
+        }
+
+        readings -= unsent;
+        storedReadings.count -= unsent;
+        storedReadings.headBlock = (storedReadings.headBlock + 1) % RAW_BLOCK_COUNT;
+        storedReadings.numBlocks--;
+    }
+    storedReadings.headGeneration++;
+    refreshOldestUnsent();
+}
+
+void acknowledgeSpilledReadings(const SpillLogPosition& end, int readings) {
+    spillLogCommit(end, readings);
+    refreshOldestUnsent();
+}
+
+void clearAggregateBuckets() {
+    for (int i = 0; i < AGGREGATE_TIER_COUNT; i++) {
+        storedReadings.tiers[i].head = 0;
+        storedReadings.tiers[i].count = 0;
+    }
+    storedReadings.bucketGeneration++;
+    refreshOldestUnsent();
+}
+
+bool hasStoredReadings() {
+    return storedReadings.count > 0 || storedBucketCount() > 0 || spillLogPendingRecords() > 0;
+}
+
+bool isStorageFull() {
+    if (storedReadings.numBlocks < RAW_BLOCK_COUNT) return false;
+    const ReadingBlock& newest = blockAt(storedReadings.numBlocks - 1);
+    return newest.bitsUsed + MAX_ENCODED_READING_BITS > RAW_BLOCK_BYTES * 8;
+}
+
+size_t storageBytesUsed() {
+    size_t bytes = 0;
+    for (int i = 0; i < storedReadings.numBlocks; i++) {
+        bytes += (blockAt(i).bitsUsed + 7) / 8;
+    }
+    return bytes;
+}
+
+int storedReadingCount() {
+    int readings = storedReadings.count + spillLogPendingReadings();
+    for (int t = 0; t < AGGREGATE_TIER_COUNT; t++) {
+        AggregateTier& tier = storedReadings.tiers[t];
+        for (int i = 0; i < tier.count; i++) {
+            readings += bucketAt(tier, i).readings;
+        }
+    }
+    return readings;
+}
+
+float storageFill() {
+    float fill = static_cast<float>(storageBytesUsed()) / (RAW_BLOCK_BYTES * RAW_BLOCK_COUNT);
+
+    // RTC blocks normally move to flash long before the ring fills
+    if (SPILL_LOG_ENABLED) {
+        const float logFill = static_cast<float>(spillLogPendingRecords()) /
+                              (SPILL_MAX_SEGMENTS * SPILL_SEGMENT_RECORDS);
+        if (logFill > fill) fill = logFill;
+    }
+    return fill;
+}
+
+time_t oldestUnsentTime() {
+    return hasStoredReadings() ? storedReadings.oldestUnsent : 0;
+}
+
+int storedBucketCount() {
+    int buckets = 0;
+    for (int t = 0; t < AGGREGATE_TIER_COUNT; t++) {
+        buckets += storedReadings.tiers[t].count;
+    }
+    return buckets;
+}
+
+StoredReadingReader::StoredReadingReader()
+    : blockOffset(-1) {}
+
+bool StoredReadingReader::next(StoredReading& reading) {
+    while (!decoder.next(reading)) {
+        if (++blockOffset >= storedReadings.numBlocks) return false;
+        decoder = ReadingBlockDecoder(blockAt(blockOffset));
+    }
+    return true;
+}
+
+AggregateBucketReader::AggregateBucketReader()
+    : tier(AGGREGATE_TIER_COUNT - 1), offset(0) {}
+
+bool AggregateBucketReader::next(const AggregateBucket*& bucket) {
+    while (tier >= 0) {
+        AggregateTier& current = storedReadings.tiers[tier];
+        if (offset < current.count) {
+            bucket = &bucketAt(current, offset++);
+            return true;
+        }
+        tier--;
+        offset = 0;
     }
-    Serial.printf("Total readings stored: %d\n", storedReadings.count);
-    Serial.println("-----------------------------------\n");
-} 
\ No newline at end of file
+    return false;
+}
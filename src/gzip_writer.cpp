@@ -0,0 +1,216 @@
+#include "gzip_writer.hpp"
+#include "checksum.hpp"
+#include <string.h>
+
+static const uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DISTANCE_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+GzipWriter::GzipWriter()
+    : out(nullptr), maxChain(0), position(0), end(0), bitBuffer(0), bitCount(0), crc(0), inputBytes(0) {}
+
+void GzipWriter::begin(Print& sink, int level) {
+    out = &sink;
+    if (level < 1) level = 1;
+    if (level > 9) level = 9;
+    maxChain = 2 << level;
+
+    memset(head, 0xFF, sizeof(head));
+    position = 0;
+    end = 0;
+    bitBuffer = 0;
+    bitCount = 0;
+    crc = 0;
+    inputBytes = 0;
+
+    // Member header: deflate, no flags, no mtime, unknown OS
+    static const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+    out->write(header, sizeof(header));
+
+    // One fixed-Huffman block holds the whole stream, an empty final
+    // block is appended by finish()
+    writeBits(0, 1);  // BFINAL
+    writeBits(1, 2);  // BTYPE = fixed Huffman
+}
+
+size_t GzipWriter::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t GzipWriter::write(const uint8_t* data, size_t size) {
+    crc = crc32(data, size, crc);
+    inputBytes += size;
+
+    size_t remaining = size;
+    while (remaining > 0) {
+        if (end == static_cast<int>(sizeof(window))) slideWindow();
+
+        size_t count = sizeof(window) - end;
+        if (count > remaining) count = remaining;
+        memcpy(window + end, data, count);
+        end += count;
+        data += count;
+        remaining -= count;
+
+        compress(false);
+    }
+    return size;
+}
+
+void GzipWriter::finish() {
+    compress(true);
+
+    writeLiteral(256);  // End of block
+    writeBits(1, 1);    // Final, empty fixed-Huffman block
+    writeBits(1, 2);
+    writeLiteral(256);
+    flushBits();
+
+    const uint8_t trailer[8] = {
+        static_cast<uint8_t>(crc), static_cast<uint8_t>(crc >> 8),
+        static_cast<uint8_t>(crc >> 16), static_cast<uint8_t>(crc >> 24),
+        static_cast<uint8_t>(inputBytes), static_cast<uint8_t>(inputBytes >> 8),
+        static_cast<uint8_t>(inputBytes >> 16), static_cast<uint8_t>(inputBytes >> 24)
+    };
+    out->write(trailer, sizeof(trailer));
+}
+
+// Drops the older half of the window, positions are kept relative to it
+void GzipWriter::slideWindow() {
+    memmove(window, window + WINDOW_SIZE, WINDOW_SIZE);
+    position -= WINDOW_SIZE;
+    end -= WINDOW_SIZE;
+
+    for (int i = 0; i < HASH_SIZE; i++) {
+        head[i] = head[i] != NIL && head[i] >= WINDOW_SIZE ? head[i] - WINDOW_SIZE : NIL;
+    }
+    for (int i = 0; i < WINDOW_SIZE; i++) {
+        prev[i] = prev[i] != NIL && prev[i] >= WINDOW_SIZE ? prev[i] - WINDOW_SIZE : NIL;
+    }
+}
+
+// Multiplicative hash of the next MIN_MATCH bytes, the top bits mix all three
+uint32_t GzipWriter::hashAt(int pos) const {
+    const uint32_t bytes = (window[pos] << 16) | (window[pos + 1] << 8) | window[pos + 2];
+    return (bytes * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void GzipWriter::insertHash(int pos) {
+    const uint32_t hash = hashAt(pos);
+    prev[pos & (WINDOW_SIZE - 1)] = head[hash];
+    head[hash] = pos;
+}
+
+int GzipWriter::longestMatch(int pos, int& distance) {
+    const uint32_t hash = hashAt(pos);
+    int limit = end - pos;
+    if (limit > MAX_MATCH) limit = MAX_MATCH;
+
+    int bestLength = 0;
+    int chain = maxChain;
+    uint16_t candidate = head[hash];
+
+    while (candidate != NIL && pos - candidate < WINDOW_SIZE && chain-- > 0) {
+        const uint8_t* a = window + candidate;
+        const uint8_t* b = window + pos;
+        if (a[bestLength] == b[bestLength]) {
+            int length = 0;
+            while (length < limit && a[length] == b[length]) length++;
+            if (length > bestLength) {
+                bestLength = length;
+                distance = pos - candidate;
+                if (length == limit) break;
+            }
+        }
+        candidate = prev[candidate & (WINDOW_SIZE - 1)];
+    }
+
+    return bestLength;
+}
+
+void GzipWriter::compress(bool flush) {
+    const int lookahead = flush ? 0 : MIN_LOOKAHEAD;
+
+    while (end - position > lookahead) {
+        int distance = 0;
+        int length = 0;
+        if (end - position >= MIN_MATCH) {
+            length = longestMatch(position, distance);
+        }
+
+        if (length >= MIN_MATCH) {
+            writeMatch(length, distance);
+            for (int i = 0; i < length; i++, position++) {
+                if (end - position >= MIN_MATCH) insertHash(position);
+            }
+        } else {
+            writeLiteral(window[position]);
+            if (end - position >= MIN_MATCH) insertHash(position);
+            position++;
+        }
+    }
+}
+
+void GzipWriter::writeBits(uint32_t value, int count) {
+    bitBuffer |= value << bitCount;
+    bitCount += count;
+    while (bitCount >= 8) {
+        out->write(static_cast<uint8_t>(bitBuffer));
+        bitBuffer >>= 8;
+        bitCount -= 8;
+    }
+}
+
+// Huffman codes are packed most significant bit first
+void GzipWriter::writeHuffman(uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    writeBits(reversed, length);
+}
+
+void GzipWriter::writeLiteral(int symbol) {
+    if (symbol < 144) {
+        writeHuffman(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        writeHuffman(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        writeHuffman(symbol - 256, 7);
+    } else {
+        writeHuffman(0xC0 + symbol - 280, 8);
+    }
+}
+
+void GzipWriter::writeMatch(int length, int distance) {
+    int code = 28;
+    while (LENGTH_BASE[code] > length) code--;
+    writeLiteral(257 + code);
+    writeBits(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+    code = 29;
+    while (DISTANCE_BASE[code] > distance) code--;
+    writeHuffman(code, 5);
+    writeBits(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+}
+
+void GzipWriter::flushBits() {
+    if (bitCount > 0) {
+        out->write(static_cast<uint8_t>(bitBuffer));
+    }
+    bitBuffer = 0;
+    bitCount = 0;
+}
@@ -0,0 +1,220 @@
+#include "http_stream.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+bool parseUrl(const char* url, ParsedUrl& parsed) {
+    const char* rest;
+    if (strncmp(url, "https://", 8) == 0) {
+        parsed.secure = true;
+        parsed.port = 443;
+        rest = url + 8;
+    } else if (strncmp(url, "http://", 7) == 0) {
+        parsed.secure = false;
+        parsed.port = 80;
+        rest = url + 7;
+    } else {
+        return false;
+    }
+
+    const char* path = strchr(rest, '/');
+    const char* hostEnd = path ? path : rest + strlen(rest);
+    const char* colon = static_cast<const char*>(memchr(rest, ':', hostEnd - rest));
+
+    const size_t hostLength = (colon ? colon : hostEnd) - rest;
+    if (hostLength == 0 || hostLength >= sizeof(parsed.host)) return false;
+    memcpy(parsed.host, rest, hostLength);
+    parsed.host[hostLength] = '\0';
+
+    if (colon) parsed.port = atoi(colon + 1);
+    parsed.path = path ? path : "/";
+    return true;
+}
+
+ChunkedBodyWriter::ChunkedBodyWriter(Client& client)
+    : client(client), used(0), total(0), error(false) {}
+
+size_t ChunkedBodyWriter::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t ChunkedBodyWriter::write(const uint8_t* data, size_t size) {
+    size_t written = 0;
+    while (written < size && !error) {
+        if (used == HTTP_CHUNK_BYTES && !flushChunk(false)) break;
+
+        size_t count = size - written;
+        if (count > HTTP_CHUNK_BYTES - used) count = HTTP_CHUNK_BYTES - used;
+        memcpy(frame + SIZE_LINE_BYTES + used, data + written, count);
+        used += count;
+        written += count;
+    }
+    total += written;
+    return written;
+}
+
+// The last chunk carries the zero-length terminator in the same write
+bool ChunkedBodyWriter::flushChunk(bool last) {
+    size_t start = SIZE_LINE_BYTES;
+    size_t end = SIZE_LINE_BYTES;
+    if (used > 0) {
+        char sizeLine[SIZE_LINE_BYTES + 1];
+        const int length = snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", static_cast<unsigned>(used));
+        start -= length;
+        memcpy(frame + start, sizeLine, length);
+        end += used;
+        memcpy(frame + end, "\r\n", 2);
+        end += 2;
+    }
+    if (last) {
+        memcpy(frame + end, "0\r\n\r\n", 5);
+        end += 5;
+    }
+    used = 0;
+    if (end == start) return true;
+
+    error = client.write(frame + start, end - start) != end - start;
+    return !error;
+}
+
+bool ChunkedBodyWriter::finish() {
+    return !error && flushChunk(true);
+}
+
+// Reads one CRLF terminated line, false on timeout or a closed connection
+static bool readLine(Client& client, char* line, size_t size, unsigned long start) {
+    size_t length = 0;
+
+    while (millis() - start < HTTP_RESPONSE_TIMEOUT_MS) {
+        if (!client.available()) {
+            if (!client.connected()) break;
+            delay(1);
+            continue;
+        }
+
+        const int c = client.read();
+        if (c == '\n') {
+            line[length] = '\0';
+            return true;
+        }
+        if (c != '\r' && length < size - 1) line[length++] = c;
+    }
+    line[length] = '\0';
+    return false;
+}
+
+// Discards exactly count body bytes
+static bool skipBytes(Client& client, size_t count, unsigned long start) {
+    uint8_t buffer[64];
+    while (count > 0 && millis() - start < HTTP_RESPONSE_TIMEOUT_MS) {
+        if (!client.available()) {
+            if (!client.connected()) return false;
+            delay(1);
+            continue;
+        }
+        const int read = client.read(buffer, count < sizeof(buffer) ? count : sizeof(buffer));
+        if (read > 0) count -= read;
+    }
+    return count == 0;
+}
+
+static bool skipChunkedBody(Client& client, unsigned long start) {
+    char line[64];
+    while (readLine(client, line, sizeof(line), start)) {
+        const size_t size = strtoul(line, nullptr, 16);
+        if (size == 0) {
+            // Trailer section ends with an empty line
+            while (readLine(client, line, sizeof(line), start)) {
+                if (line[0] == '\0') return true;
+            }
+            return false;
+        }
+        if (!skipBytes(client, size + 2, start)) return false;  // Data and its CRLF
+    }
+    return false;
+}
+
+static void readResponse(Client& client, HttpResult& result) {
+    const unsigned long start = millis();
+    char line[128];
+    int minorVersion = 0;
+
+    result.status = -1;
+    result.keepAlive = false;
+    if (!readLine(client, line, sizeof(line), start) ||
+        sscanf(line, "HTTP/1.%d %d", &minorVersion, &result.status) != 2) {
+        result.status = -1;
+        return;
+    }
+
+    // HTTP/1.1 connections persist unless the server says otherwise
+    bool keepAlive = minorVersion >= 1;
+    bool chunked = false;
+    long contentLength = -1;
+
+    while (true) {
+        if (!readLine(client, line, sizeof(line), start)) return;
+        if (line[0] == '\0') break;
+
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            contentLength = atol(line + 15);
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            chunked = strstr(line + 18, "chunked") != nullptr;
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char* value = line + 11;
+            while (*value == ' ') value++;
+            keepAlive = strncasecmp(value, "keep-alive", 10) == 0;
+        }
+    }
+
+    // The body has to be consumed before the next request can use the connection
+    if (chunked) {
+        result.keepAlive = keepAlive && skipChunkedBody(client, start);
+    } else if (contentLength >= 0) {
+        result.keepAlive = keepAlive && skipBytes(client, contentLength, start);
+    }
+    // Otherwise the body runs until the server closes the connection
+}
+
+// Built in one buffer, so the request head goes out as a single TLS record
+static bool writeRequestHead(Client& client, const ParsedUrl& url, const UploadHeaders& headers) {
+    // The port is part of Host unless it is the scheme's default (RFC 7230 5.4)
+    char port[8] = "";
+    if (url.port != (url.secure ? 443 : 80)) snprintf(port, sizeof(port), ":%u", static_cast<unsigned>(url.port));
+
+    char head[HTTP_HEADER_BYTES];
+    const int length = snprintf(head, sizeof(head),
+        "POST %s HTTP/1.1\r\n"
+        "Host: %s%s\r\n"
+        "Content-Type: %s\r\n"
+        "%s%s%s"
+        "Authorization: Bearer %s\r\n"
+        "X-Device-Id: %s\r\n"
+        "X-Upload-Sequence: %lu\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Connection: %s\r\n\r\n",
+        url.path, url.host, port, headers.contentType,
+        headers.contentEncoding != nullptr ? "Content-Encoding: " : "",
+        headers.contentEncoding != nullptr ? headers.contentEncoding : "",
+        headers.contentEncoding != nullptr ? "\r\n" : "",
+        headers.authToken, headers.deviceId, static_cast<unsigned long>(headers.sequence),
+        HTTP_KEEP_ALIVE ? "keep-alive" : "close");
+    if (length < 0 || static_cast<size_t>(length) >= sizeof(head)) return false;
+    return client.write(reinterpret_cast<const uint8_t*>(head), length) == static_cast<size_t>(length);
+}
+
+void postChunked(Client& client, const ParsedUrl& url, const UploadHeaders& headers,
+                 const BodyWriter& writeBody, HttpResult& result) {
+    result.bodyBytes = 0;
+    result.status = -1;
+    result.keepAlive = false;
+    if (!writeRequestHead(client, url, headers)) return;
+
+    ChunkedBodyWriter body(client);
+    writeBody(body);
+    result.bodyBytes = body.bytesWritten();
+
+    if (!body.finish()) return;
+    readResponse(client, result);
+    if (!HTTP_KEEP_ALIVE) result.keepAlive = false;
+}
@@ -0,0 +1,96 @@
+#include "json_writer.hpp"
+#include <math.h>
+
+JsonStreamWriter::JsonStreamWriter(Print& out)
+    : out(out), depth(0) {
+    first[0] = true;
+}
+
+void JsonStreamWriter::separator() {
+    if (!first[depth]) out.write(',');
+    first[depth] = false;
+}
+
+void JsonStreamWriter::beginArray() {
+    separator();
+    out.write('[');
+    if (depth + 1 < MAX_DEPTH) first[++depth] = true;
+}
+
+void JsonStreamWriter::beginArray(const char* name) {
+    key(name);
+    out.write('[');
+    if (depth + 1 < MAX_DEPTH) first[++depth] = true;
+}
+
+void JsonStreamWriter::endArray() {
+    if (depth > 0) depth--;
+    out.write(']');
+}
+
+void JsonStreamWriter::beginObject() {
+    separator();
+    out.write('{');
+    if (depth + 1 < MAX_DEPTH) first[++depth] = true;
+}
+
+void JsonStreamWriter::endObject() {
+    if (depth > 0) depth--;
+    out.write('}');
+}
+
+void JsonStreamWriter::string(const char* value) {
+    out.write('"');
+    for (const char* c = value; *c; c++) {
+        switch (*c) {
+            case '"': out.print("\\\""); break;
+            case '\\': out.print("\\\\"); break;
+            case '\n': out.print("\\n"); break;
+            case '\r': out.print("\\r"); break;
+            case '\t': out.print("\\t"); break;
+            default:
+                if (static_cast<uint8_t>(*c) < 0x20) {
+                    out.printf("\\u%04x", *c);
+                } else {
+                    out.write(*c);
+                }
+        }
+    }
+    out.write('"');
+}
+
+void JsonStreamWriter::key(const char* name) {
+    separator();
+    string(name);
+    out.write(':');
+}
+
+void JsonStreamWriter::member(const char* name, const char* value) {
+    key(name);
+    string(value);
+}
+
+void JsonStreamWriter::member(const char* name, float value) {
+    key(name);
+    if (isnan(value) || isinf(value)) {
+        out.print("null");
+        return;
+    }
+    char number[16];
+    snprintf(number, sizeof(number), "%.7g", value);
+    out.print(number);
+}
+
+void JsonStreamWriter::member(const char* name, uint32_t value) {
+    key(name);
+    char number[12];
+    snprintf(number, sizeof(number), "%lu", static_cast<unsigned long>(value));
+    out.print(number);
+}
+
+void JsonStreamWriter::element(uint32_t value) {
+    separator();
+    char number[12];
+    snprintf(number, sizeof(number), "%lu", static_cast<unsigned long>(value));
+    out.print(number);
+}
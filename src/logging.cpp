@@ -0,0 +1,362 @@
+#include "logging.hpp"
+#include <string.h>
+#include "esp_ota_ops.h"
+#include "freertos/FreeRTOS.h"
+
+static const uint32_t LOG_RING_MAGIC = 0x4C4F4752;  // "LOGR"
+
+RTC_DATA_ATTR LogRing logRing = { .magic = 0 };
+
+// Both cores log during a pipelined wake
+static portMUX_TYPE ringLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Argument encoding: a tag byte, then the value
+enum LogArgTag : uint8_t {
+    ARG_INT32 = 'i',
+    ARG_UINT32 = 'u',
+    ARG_INT64 = 'I',
+    ARG_UINT64 = 'U',
+    ARG_FLOAT = 'f',
+    ARG_STRING = 's',    // Length byte, then the characters
+    ARG_POINTER = 'p'
+};
+
+struct LogRecordHeader {
+    const char* format;
+    uint32_t millis;
+    uint16_t wake;
+    uint8_t levelModule;   // Level in the high nibble
+    uint8_t length;        // Whole record including this header
+};
+
+static const char* const LEVEL_LETTERS = "-EWID";
+
+// Indexed by LogModule
+static const char* const MODULE_NAMES[LOG_MODULE_COUNT] = {
+    "system", "time", "sensor", "storage", "network"
+};
+
+static uint32_t firmwareBuildId() {
+    char sha[9] = {0};
+    esp_ota_get_app_elf_sha256(sha, sizeof(sha));
+    return strtoul(sha, nullptr, 16);
+}
+
+static void ringRead(uint16_t offset, uint8_t* out, size_t size) {
+    for (size_t i = 0; i < size; i++) out[i] = logRing.data[(offset + i) % LOG_RING_BYTES];
+}
+
+static void ringReset() {
+    logRing.head = 0;
+    logRing.used = 0;
+    logRing.overwritten = 0;
+    logRing.errorLogged = false;
+}
+
+LogRecordWriter::LogRecordWriter(uint8_t level, uint8_t module, const char* format)
+    : length(sizeof(LogRecordHeader)), truncated(false) {
+    LogRecordHeader header;
+    header.format = format;
+    header.millis = millis();
+    header.wake = logRing.wake;
+    header.levelModule = (level << 4) | module;
+    header.length = 0;
+    memcpy(record, &header, sizeof(header));
+}
+
+bool LogRecordWriter::reserve(size_t bytes) {
+    // The record ends at the first argument that does not fit, it and all
+    // later ones are printed as '?'
+    if (truncated || length + bytes > sizeof(record)) {
+        truncated = true;
+        return false;
+    }
+    return true;
+}
+
+void LogRecordWriter::addInteger(int64_t value, bool isSigned, bool wide) {
+    const size_t size = wide ? 8 : 4;
+    if (!reserve(1 + size)) return;
+    record[length++] = wide ? (isSigned ? ARG_INT64 : ARG_UINT64) : (isSigned ? ARG_INT32 : ARG_UINT32);
+    memcpy(record + length, &value, size);  // Little endian, the low word comes first
+    length += size;
+}
+
+void LogRecordWriter::addFloat(float value) {
+    if (!reserve(1 + sizeof(value))) return;
+    record[length++] = ARG_FLOAT;
+    memcpy(record + length, &value, sizeof(value));
+    length += sizeof(value);
+}
+
+void LogRecordWriter::addPointer(const void* value) {
+    if (!reserve(1 + sizeof(value))) return;
+    record[length++] = ARG_POINTER;
+    memcpy(record + length, &value, sizeof(value));
+    length += sizeof(value);
+}
+
+void LogRecordWriter::add(const char* value) {
+    if (value == nullptr) value = "(null)";
+    size_t size = strlen(value);
+    if (size > LOG_MAX_STRING_BYTES) size = LOG_MAX_STRING_BYTES;
+    if (!reserve(2 + size)) return;
+    record[length++] = ARG_STRING;
+    record[length++] = static_cast<uint8_t>(size);
+    memcpy(record + length, value, size);
+    length += size;
+}
+
+static size_t formatRecord(const uint8_t* record, char* out, size_t size);
+
+void LogRecordWriter::commit() {
+    LogRecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    header.length = static_cast<uint8_t>(length);
+    memcpy(record, &header, sizeof(header));
+
+    const uint8_t level = header.levelModule >> 4;
+
+    portENTER_CRITICAL(&ringLock);
+    if (logRing.magic == LOG_RING_MAGIC) {
+        // Make room by dropping the oldest records
+        while (LOG_RING_BYTES - logRing.used < length) {
+            LogRecordHeader oldest;
+            ringRead((logRing.head + LOG_RING_BYTES - logRing.used) % LOG_RING_BYTES,
+                     reinterpret_cast<uint8_t*>(&oldest), sizeof(oldest));
+            logRing.used -= oldest.length;
+            logRing.overwritten++;
+        }
+        for (size_t i = 0; i < length; i++) {
+            logRing.data[(logRing.head + i) % LOG_RING_BYTES] = record[i];
+        }
+        logRing.head = (logRing.head + length) % LOG_RING_BYTES;
+        logRing.used += length;
+        if (level == LOG_LEVEL_ERROR) logRing.errorLogged = true;
+    }
+    portEXIT_CRITICAL(&ringLock);
+
+    if (level <= LOG_ECHO_LEVEL) {
+        char text[160];
+        formatRecord(record, text, sizeof(text));
+        Serial.println(text);
+    }
+}
+
+// Reads the next argument, returns false when the record has no more
+static bool nextArgument(const uint8_t*& arg, const uint8_t* end, uint8_t& tag,
+                         int64_t& integer, double& real, char* string, size_t stringSize) {
+    if (arg >= end) return false;
+    tag = *arg++;
+    integer = 0;
+    real = 0;
+
+    switch (tag) {
+        case ARG_INT32: {
+            int32_t value;
+            memcpy(&value, arg, 4);
+            integer = value;
+            arg += 4;
+            break;
+        }
+        case ARG_UINT32: {
+            uint32_t value;
+            memcpy(&value, arg, 4);
+            integer = value;
+            arg += 4;
+            break;
+        }
+        case ARG_INT64:
+        case ARG_UINT64:
+            memcpy(&integer, arg, 8);
+            arg += 8;
+            break;
+        case ARG_FLOAT: {
+            float value;
+            memcpy(&value, arg, 4);
+            real = value;
+            arg += 4;
+            break;
+        }
+        case ARG_STRING: {
+            const size_t length = *arg++;
+            const size_t copy = length < stringSize - 1 ? length : stringSize - 1;
+            memcpy(string, arg, copy);
+            string[copy] = '\0';
+            arg += length;
+            break;
+        }
+        case ARG_POINTER: {
+            const void* value;
+            memcpy(&value, arg, sizeof(value));
+            integer = reinterpret_cast<intptr_t>(value);
+            arg += sizeof(value);
+            break;
+        }
+        default:
+            return false;
+    }
+    return arg <= end;
+}
+
+// Renders the format string against the stored arguments. Each conversion
+// is re-issued to snprintf with the width of the stored value.
+static size_t formatRecord(const uint8_t* record, char* out, size_t size) {
+    LogRecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    const uint8_t* arg = record + sizeof(header);
+    const uint8_t* end = record + header.length;
+
+    size_t used = 0;
+    const char* f = header.format;
+    while (*f && used + 1 < size) {
+        if (*f != '%') {
+            out[used++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            out[used++] = '%';
+            f += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion, without '*'
+        const char* start = f++;
+        while (*f && strchr("-+ #0123456789.", *f)) f++;
+        const size_t prefix = f - start;
+        while (*f && strchr("hlLqjzt", *f)) f++;
+        const char conversion = *f;
+        if (conversion == '\0' || prefix > 12) break;
+        f++;
+
+        char spec[20];
+        memcpy(spec, start, prefix);
+        spec[prefix] = '\0';
+
+        uint8_t tag;
+        int64_t integer;
+        double real;
+        char string[LOG_MAX_STRING_BYTES + 1];
+        if (!nextArgument(arg, end, tag, integer, real, string, sizeof(string))) {
+            out[used++] = '?';
+            continue;
+        }
+        if (tag == ARG_FLOAT) integer = static_cast<int64_t>(real);
+        if (tag != ARG_FLOAT) real = static_cast<double>(integer);
+
+        int written;
+        const size_t room = size - used;
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                strcat(spec, "lld");
+                written = snprintf(out + used, room, spec, static_cast<long long>(integer));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X': {
+                const size_t at = strlen(spec);
+                spec[at] = 'l';
+                spec[at + 1] = 'l';
+                spec[at + 2] = conversion;
+                spec[at + 3] = '\0';
+                written = snprintf(out + used, room, spec, static_cast<unsigned long long>(integer));
+                break;
+            }
+            case 'c':
+                strcat(spec, "c");
+                written = snprintf(out + used, room, spec, static_cast<int>(integer));
+                break;
+            case 's':
+                strcat(spec, "s");
+                written = snprintf(out + used, room, spec, tag == ARG_STRING ? string : "?");
+                break;
+            case 'p':
+                written = snprintf(out + used, room, "0x%llx", static_cast<unsigned long long>(integer));
+                break;
+            default: {  // f F e E g G a A
+                const size_t at = strlen(spec);
+                spec[at] = conversion;
+                spec[at + 1] = '\0';
+                written = snprintf(out + used, room, spec, real);
+                break;
+            }
+        }
+        if (written < 0) break;
+        used += static_cast<size_t>(written) < room ? written : room - 1;
+    }
+
+    // Trailing newlines belong to Serial.println
+    while (used > 0 && (out[used - 1] == '\n' || out[used - 1] == '\r')) used--;
+    out[used] = '\0';
+    return used;
+}
+
+void logDump() {
+    if (logRing.magic != LOG_RING_MAGIC) return;
+
+    Serial.printf("--- Log: %u bytes", logRing.used);
+    if (logRing.overwritten > 0) Serial.printf(", %u older records overwritten", logRing.overwritten);
+    Serial.println(" ---");
+
+    uint16_t offset = (logRing.head + LOG_RING_BYTES - logRing.used) % LOG_RING_BYTES;
+    uint16_t remaining = logRing.used;
+    while (remaining > 0) {
+        uint8_t record[LOG_MAX_RECORD_BYTES];
+        LogRecordHeader header;
+        ringRead(offset, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+        if (header.length < sizeof(header) || header.length > sizeof(record) || header.length > remaining) {
+            Serial.println("Log ring damaged, discarding the rest");
+            break;
+        }
+        ringRead(offset, record, header.length);
+
+        char text[160];
+        formatRecord(record, text, sizeof(text));
+        const uint8_t module = header.levelModule & 0x0F;
+        const uint8_t level = header.levelModule >> 4;
+        Serial.printf("[%u +%lu ms] %c %s: %s\n", header.wake, static_cast<unsigned long>(header.millis),
+                      level <= LOG_LEVEL_DEBUG ? LEVEL_LETTERS[level] : '?',
+                      module < LOG_MODULE_COUNT ? MODULE_NAMES[module] : "unknown", text);
+
+        offset = (offset + header.length) % LOG_RING_BYTES;
+        remaining -= header.length;
+    }
+    Serial.println("--- End of log ---");
+
+    portENTER_CRITICAL(&ringLock);
+    ringReset();
+    portEXIT_CRITICAL(&ringLock);
+}
+
+void logBegin(int resetReason) {
+    const uint32_t buildId = firmwareBuildId();
+    const bool valid = logRing.magic == LOG_RING_MAGIC && logRing.buildId == buildId &&
+                       logRing.used <= LOG_RING_BYTES && logRing.head < LOG_RING_BYTES;
+
+    pinMode(LOG_DUMP_PIN, INPUT_PULLUP);
+    const bool requested = digitalRead(LOG_DUMP_PIN) == LOW;
+
+    // Power-on and deep sleep are the expected ways into setup()
+    const bool crashed = resetReason != ESP_RST_POWERON && resetReason != ESP_RST_DEEPSLEEP;
+
+    if (valid && (requested || (crashed && logRing.used > 0))) {
+        delay(LOG_DUMP_SETTLE_MS);
+        Serial.printf("Reset reason %d, log of the previous wakes:\n", resetReason);
+        logDump();
+    }
+
+    if (!valid) {
+        logRing.magic = LOG_RING_MAGIC;
+        logRing.buildId = buildId;
+        logRing.wake = 0;
+        ringReset();
+    }
+    logRing.wake++;
+    logRing.errorLogged = false;
+}
+
+void logFlush() {
+    if (logRing.magic == LOG_RING_MAGIC && logRing.errorLogged) logDump();
+}
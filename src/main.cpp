@@ -9,6 +9,14 @@
 #include "system_utils.hpp"
 #include "esp_sleep.h"
 #include "data_manager.hpp"
+#include "cadence.hpp"
+#include "reading_filter.hpp"
+#include "spill_log.hpp"
+#include "wake_deadline.hpp"
+#include "wake_pipeline.hpp"
+#include "wake_profiler.hpp"
+#include "wake_schedule.hpp"
+#include "logging.hpp"
 
 // Define global variables
 RTC_DATA_ATTR StoredReadingsBuffer storedReadings = { .count = 0 };
@@ -16,65 +24,97 @@ RTC_DATA_ATTR int bootCount = 0;
 struct tm timeinfo;
 
 
+// Cleanup and sleep
+static void finishWake(const char* mode) {
+    LOG_INFO(SYSTEM, "Awake for %lu ms (%s wake)", millis(), mode);
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    goToSleep();
+}
+
 void setup() {
+    profilerBegin();
     Serial.begin(115200);
-    Serial.println("\n\n--- New Session Starting ---");
-    delay(1000);
+    {
+        // Only waits for the host to attach when there is a log to dump
+        PROFILE_PHASE(SERIAL_SETTLE);
+        logBegin(esp_reset_reason());
+    }
+    LOG_INFO(SYSTEM, "New session starting, reset reason %d", static_cast<int>(esp_reset_reason()));
+    wakeDeadlineBegin();
     
     bootCount++;
     
+    // RTC copy of the spill log state only survives deep sleep
+    spillLogBegin(esp_reset_reason() == ESP_RST_DEEPSLEEP);
+    
+    // Correct the clock for the sleep first, validity depends on the error bound
+    updateTimeAfterSleep();
+    
     // First boot or invalid state - always connect
     if (bootCount == 1 || !isStateValid()) {
-        if (!connectToWiFi()) {
-            enterErrorState();
-            return;
-        }
-        if (!initializeTime()) {
-            enterErrorState();
-            return;
+        if (!connectToWiFi() || !initializeTime()) {
+            // An uncertain clock still dates the reading, an unset one cannot
+            if (!timeState.timeInitialized) {
+                LOG_WARN(SYSTEM, "Clock not set, reading skipped");
+                finishWake("degraded");
+                return;
+            }
+            LOG_WARN(SYSTEM, "Clock not resynced, reading taken with %lu ms uncertainty",
+                     static_cast<unsigned long>(timeState.uncertaintyUs / 1000));
         }
     }
     
-    updateTimeAfterSleep();
-    timeState.isNight = isNightTime();
+    timeState.isNight = querySchedule(timeState.lastKnownTime).night;
+    
+    // The scheduler decides from buffer state and what earlier wakes observed
+    const UploadDecision decision = getUploadScheduler().decide(gatherUploadInputs());
+    LOG_INFO(SYSTEM, "Upload %s: %s (%.1f readings per radio second)",
+             decision.upload ? "now" : "deferred", decision.reason, decision.readingsPerRadioSecond);
+    bool shouldConnect = decision.upload;
     
-    // Connect to WiFi if:
-    // 1. It's not night time and we have readings to send, or
-    // 2. We have a full buffer that needs to be sent regardless of time
-    bool shouldConnect = (!timeState.isNight && storedReadings.count > 0) || 
-                        (storedReadings.count >= MAX_READINGS);
+    if (shouldConnect && PIPELINED_WAKE) {
+        if (runPipelinedWake()) {
+            finishWake("pipelined");
+            return;
+        }
+        LOG_WARN(SYSTEM, "Continuing sequentially");
+    }
     
     if (shouldConnect) {
         if (!WiFi.isConnected() && !connectToWiFi()) {
-            Serial.println("Failed to connect to WiFi for data transmission");
+            LOG_WARN(SYSTEM, "Failed to connect to WiFi for data transmission");
             // Continue execution - we'll still take measurements
         } else {
             handleTimeSync();  // Sync time while we have WiFi
         }
     }
     
-    // Initialize and read sensors
+    // Sensors that failed to initialize are left out of the reading
     if (!SensorManager::initialize()) {
-        Serial.println("Failed to initialize sensors");
-        enterErrorState();
-        return;
+        LOG_WARN(SYSTEM, "Reading without the sensors that failed to initialize");
     }
     
-    SensorData sensorData = SensorManager::readAll();
-    storeReading(sensorData);
+    SensorData sensorData;
+    SensorManager::readAll(sensorData);
+    {
+        SleepGuard guard;
+        SensorManager::completeReading(sensorData);
+        SensorData filtered;
+        if (filterReading(sensorData, timeState.lastKnownTime, filtered)) storeReading(filtered);
+        observeReading(sensorData);
+        updateCadence(sensorData);
+    }
     
     // If we're connected, try to send the data
-    if (WiFi.isConnected() && storedReadings.count > 0) {
+    if (WiFi.isConnected() && hasStoredReadings()) {
+        // Acknowledged chunks are released as they go, anything left stays pending
         if (sendStoredReadings()) {
-            Serial.println("Successfully sent stored readings");
-            storedReadings.count = 0;
+            LOG_INFO(SYSTEM, "Successfully sent stored readings");
         }
     }
     
-    // Cleanup and sleep
-    WiFi.disconnect(true);
-    WiFi.mode(WIFI_OFF);
-    goToSleep();
+    finishWake("sequential");
 }
 
 void loop() {
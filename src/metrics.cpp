@@ -0,0 +1,33 @@
+#include "metrics.hpp"
+#include "sensor_drivers.hpp"
+
+typedef MetricSensors<KnownSensors> KnownMetricSensors;
+static_assert(KnownMetricSensors::METRIC_MASK == (1UL << METRIC_COUNT) - 1,
+              "Every metric needs a driver in KnownSensors");
+
+// Indexed by MetricId
+static const char* const METRIC_NAMES[METRIC_COUNT] = {
+    "temperature",
+    "humidity",
+    "pressure",
+    "gas",
+    "soil_moisture_raw",
+    "soil_moisture_percent",
+    "battery_voltage",
+    "battery_percent",
+    "battery_type",
+    "wifi_rssi",
+    "stored_readings_count",
+    "stored_buckets_count"
+};
+
+const char* getMetricName(MetricId metric) {
+    const int index = static_cast<int>(metric);
+    if (index >= METRIC_COUNT) return "unknown";
+    return METRIC_NAMES[index];
+}
+
+SensorId getMetricSensor(MetricId metric) {
+    if (static_cast<int>(metric) >= METRIC_COUNT) return static_cast<SensorId>(0);  // Reported as "unknown"
+    return KnownMetricSensors::find(metric);
+}
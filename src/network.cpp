@@ -1,126 +1,476 @@
 #include "network.hpp"
 #include "config.hpp"
 #include <WiFi.h>
-#include <WiFiClientSecure.h>
-#include <HTTPClient.h>
-#include <ArduinoJson.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
 #include "auth_config.h"
+#include "cadence.hpp"
+#include "data_manager.hpp"
+#include "spill_log.hpp"
+#include "http_stream.hpp"
+#include "upload_transport.hpp"
+#include "payload_encoder.hpp"
+#include "gzip_writer.hpp"
+#include "time_manager.hpp"
+#include "wake_deadline.hpp"
+#include "wake_profiler.hpp"
+#include "wake_schedule.hpp"
+#include <new>
+#include "logging.hpp"
 
 extern RTC_DATA_ATTR StoredReadingsBuffer storedReadings;
 
+static const uint32_t UPLOAD_STATE_MAGIC = 0x55504C44;  // "UPLD"
+
+RTC_DATA_ATTR UploadState uploadState = {
+    .magic = 0,
+    .nextSequence = 1,
+    .pending = {0, ChunkSource::NONE, 0, 0, {0, 0}}
+};
+
+// Shared by all requests of a wake so retries and chunks reuse the connection
+static UploadTransport transport;
+
+static const uint32_t WIFI_CACHE_MAGIC = 0x57494649;  // "WIFI"
+
+RTC_DATA_ATTR WiFiCache wifiCache = { .magic = 0 };
+
+RTC_DATA_ATTR UploadHistory uploadHistory = {
+    .connectMs = {0},
+    .nextConnect = 0,
+    .connectCount = 0,
+    .lastRssi = 0,
+    .batteryPercent = -1.0f
+};
+
+static const EventBits_t WIFI_GOT_IP_BIT = 1 << 0;
+static const EventBits_t WIFI_DISCONNECTED_BIT = 1 << 1;
+
+static EventGroupHandle_t wifiEvents = nullptr;
+static volatile unsigned long gotIpAt = 0;
+
+static void onWiFiEvent(arduino_event_id_t event) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        gotIpAt = millis();
+        xEventGroupSetBits(wifiEvents, WIFI_GOT_IP_BIT);
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        xEventGroupSetBits(wifiEvents, WIFI_DISCONNECTED_BIT);
+    }
+}
+
+// Blocks until the station has an IP address, without polling
+static bool waitForConnection(unsigned long timeoutMs, bool stopOnDisconnect) {
+    const unsigned long start = millis();
+    unsigned long elapsed;
+    while ((elapsed = millis() - start) < timeoutMs) {
+        const EventBits_t bits = xEventGroupWaitBits(wifiEvents, WIFI_GOT_IP_BIT | WIFI_DISCONNECTED_BIT,
+                                                     pdTRUE, pdFALSE, pdMS_TO_TICKS(timeoutMs - elapsed));
+        if (bits & WIFI_GOT_IP_BIT) return true;
+        // A full connect keeps going through its own reconnect attempts
+        if ((bits & WIFI_DISCONNECTED_BIT) && stopOnDisconnect) return false;
+    }
+    return WiFi.status() == WL_CONNECTED;
+}
+
+// Time from start until the got-IP event
+static unsigned long connectLatency(unsigned long start) {
+    return (gotIpAt - start < millis() - start ? gotIpAt : millis()) - start;
+}
+
+static void recordConnectTime(unsigned long ms) {
+    uploadHistory.connectMs[uploadHistory.nextConnect] = ms < 0xFFFF ? ms : 0xFFFF;
+    uploadHistory.nextConnect = (uploadHistory.nextConnect + 1) % CONNECT_HISTORY_SIZE;
+    if (uploadHistory.connectCount < CONNECT_HISTORY_SIZE) uploadHistory.connectCount++;
+}
+
+static bool isWiFiCacheUsable() {
+    return wifiCache.magic == WIFI_CACHE_MAGIC &&
+           timeState.lastKnownTime - wifiCache.leaseObtained < WIFI_LEASE_REUSE_SECONDS;
+}
+
+static void saveWiFiCache() {
+    memcpy(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid));
+    wifiCache.channel = WiFi.channel();
+    wifiCache.ip = WiFi.localIP();
+    wifiCache.gateway = WiFi.gatewayIP();
+    wifiCache.subnet = WiFi.subnetMask();
+    wifiCache.dns = WiFi.dnsIP(0);
+    wifiCache.leaseObtained = timeState.lastKnownTime;
+    wifiCache.magic = WIFI_CACHE_MAGIC;
+}
+
 bool connectToWiFi() {
-    WiFi.begin(ssid, password);
-    Serial.print("Connecting to WiFi");
-    
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
+    PROFILE_PHASE(WIFI_CONNECT);
+    PhaseBudget budget(WakePhase::WIFI_CONNECT);
+
+    if (wifiEvents == nullptr) {
+        wifiEvents = xEventGroupCreate();
+        WiFi.onEvent(onWiFiEvent);
+        WiFi.persistent(false);  // Credentials come from auth_config.h, skip the NVS writes
     }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("\nConnected to WiFi!");
+    xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT | WIFI_DISCONNECTED_BIT);
+
+    const unsigned long start = millis();
+
+    // Fast path: known AP on a known channel with the previous lease, no scan and no DHCP
+    if (isWiFiCacheUsable()) {
+        LOG_INFO(NETWORK, "Connecting to WiFi (cached channel %ld)", static_cast<long>(wifiCache.channel));
+        WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway),
+                    IPAddress(wifiCache.subnet), IPAddress(wifiCache.dns));
+        WiFi.begin(ssid, password, wifiCache.channel, wifiCache.bssid);
+
+        if (waitForConnection(budget.limit(WIFI_FAST_CONNECT_TIMEOUT_MS), true)) {
+            LOG_INFO(NETWORK, "Connected to WiFi in %lu ms (fast path)", connectLatency(start));
+            recordConnectTime(connectLatency(start));
+            return true;
+        }
+
+        LOG_WARN(NETWORK, "Fast connect failed, falling back to a full scan");
+        wifiCache.magic = 0;
+        WiFi.disconnect();
+        xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT | WIFI_DISCONNECTED_BIT);
+    }
+
+    LOG_INFO(NETWORK, "Connecting to WiFi (full scan)");
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // Back to DHCP
+    WiFi.begin(ssid, password);
+
+    if (waitForConnection(budget.limit(WIFI_CONNECT_TIMEOUT_MS), false)) {
+        LOG_INFO(NETWORK, "Connected to WiFi in %lu ms", connectLatency(start));
+        recordConnectTime(connectLatency(start));
+        saveWiFiCache();
         return true;
     }
     
-    Serial.println("\nFailed to connect to WiFi");
+    LOG_WARN(NETWORK, "Failed to connect to WiFi after %lu ms", millis() - start);
+    recordConnectTime(millis() - start);
+    recordPhaseFailure(WakePhase::WIFI_CONNECT);
     return false;
 }
 
+void observeReading(const SensorData& data) {
+    for (int i = 0; i < data.numDataPoints; i++) {
+        const DataPoint& point = data.dataPoints[i];
+        if (point.metric == MetricId::BATTERY_PERCENT) {
+            uploadHistory.batteryPercent = point.value;
+        } else if (point.metric == MetricId::WIFI_RSSI && point.value > -100.0f) {
+            uploadHistory.lastRssi = static_cast<int8_t>(point.value);  // -100 means not connected
+        }
+    }
+}
 
-bool sendHttpRequest(const String& payload) {
-    HTTPClient http;
-    http.begin(apiEndpoint);
-    http.addHeader("Content-Type", "application/json");
-    
-    String authHeader = String("Bearer ") + authToken;
-    http.addHeader("Authorization", authHeader);
-    
-    int httpResponseCode = http.POST(payload);
+UploadInputs gatherUploadInputs() {
+    uint32_t connectMs = 0;
+    for (int i = 0; i < uploadHistory.connectCount; i++) {
+        connectMs += uploadHistory.connectMs[i];
+    }
+
+    const time_t oldest = oldestUnsentTime();
+    UploadInputs inputs;
+    inputs.storageFill = storageFill();
+    inputs.oldestAgeSeconds = oldest > 0 && timeState.lastKnownTime > oldest ? timeState.lastKnownTime - oldest : 0;
+    inputs.pendingReadings = storedReadingCount();
+    inputs.lastRssi = uploadHistory.lastRssi;
+    inputs.batteryPercent = uploadHistory.batteryPercent;
+    inputs.expectedConnectMs = uploadHistory.connectCount > 0 ? connectMs / uploadHistory.connectCount : 0;
+    // The stride may still grow once this wake's reading is in
+    inputs.wakeIntervalSeconds = querySchedule(timeState.lastKnownTime).intervalSeconds * maxCadenceStride();
+    inputs.isNight = timeState.isNight;
+    return inputs;
+}
+
+
+static bool sendHttpRequest(const BodyWriter& writeBody, uint32_t sequence) {
+    ParsedUrl url;
+    if (!parseUrl(apiEndpoint, url)) {
+        LOG_ERROR(NETWORK, "Invalid API endpoint: %s", apiEndpoint);
+        return false;
+    }
+
+    // The compressor is allocated once and reused by every request
+    static GzipWriter* compressor = nullptr;
+    if (UPLOAD_COMPRESSION_LEVEL > 0 && compressor == nullptr) {
+        compressor = new (std::nothrow) GzipWriter();
+    }
+    const bool compress = UPLOAD_COMPRESSION_LEVEL > 0 && compressor != nullptr;
+
+    const UploadHeaders headers = {
+        getPayloadContentType(UPLOAD_FORMAT),
+        compress ? "gzip" : nullptr,
+        authToken,
+        deviceId,
+        sequence
+    };
+
+    const BodyWriter writeEncodedBody = [&](Print& out) {
+        if (!compress) {
+            writeBody(out);
+            return;
+        }
+        compressor->begin(out, UPLOAD_COMPRESSION_LEVEL);
+        writeBody(*compressor);
+        compressor->finish();
+    };
+
+    const unsigned long startTime = millis();
+    HttpResult result;
+    bool reused = false;
+
+    // The server may have closed a reused connection while it sat idle; that
+    // costs one immediate resend on a fresh connection rather than a retry
+    for (int attempt = 0; attempt < 2; attempt++) {
+        Client* client = transport.connect(url, reused);
+        if (client == nullptr) return false;
+
+        postChunked(*client, url, headers, writeEncodedBody, result);
+        transport.release(result.keepAlive);
+        if (result.status != -1 || !reused) break;
+    }
+
+    const int httpResponseCode = result.status;
     bool success = false;
     
     if (httpResponseCode == 200 || httpResponseCode == 201) {
-        Serial.println("Data sent successfully!");
-        storedReadings.count = 0;  // Clear readings after successful send
+        if (compress) {
+            LOG_INFO(NETWORK, "Data sent successfully! (%u bytes, %u before compression, in %lu ms)",
+                     static_cast<unsigned>(result.bodyBytes), static_cast<unsigned>(compressor->bytesIn()),
+                     millis() - startTime);
+        } else {
+            LOG_INFO(NETWORK, "Data sent successfully! (%u bytes in %lu ms)",
+                     static_cast<unsigned>(result.bodyBytes), millis() - startTime);
+        }
         success = true;
     } else {
-        Serial.printf("Error on sending POST: %d\n", httpResponseCode);
-        Serial.println("Response: " + http.getString());
-        Serial.println("Authorization header: " + authHeader);
+        LOG_WARN(NETWORK, "Error on sending POST: %d", httpResponseCode);
     }
     
-    http.end();
     return success;
 }
 
-const char* getSensorString(uint8_t sensorId) {
-    switch(static_cast<SensorId>(sensorId)) {
-        case SensorId::BME680: return "bme680";
-        case SensorId::SOIL_MOISTURE: return "soil_moisture";
-        case SensorId::BATTERY: return "battery";
-        case SensorId::NETWORK: return "network";
-        default: return "unknown";
+// Runs a payload producer against the configured wire format
+static void encodePayload(Print& out, const std::function<void(PayloadEncoder&)>& produce) {
+    if (UPLOAD_FORMAT == PayloadFormat::CBOR) {
+        CborPayloadEncoder encoder(out, deviceId);
+        encoder.begin();
+        produce(encoder);
+        encoder.end();
+    } else {
+        JsonPayloadEncoder encoder(out, deviceId);
+        encoder.begin();
+        produce(encoder);
+        encoder.end();
     }
 }
 
-String createJsonPayload() {
-    JsonDocument doc;
-    JsonArray array = doc.to<JsonArray>();
+// Rebuilds the body of a chunk from storage; called again on every attempt
+static void writeChunk(Print& out, const PendingChunk& chunk) {
+    encodePayload(out, [&](PayloadEncoder& encoder) {
+        StoredReading reading;
 
-    for (int i = 0; i < storedReadings.count; i++) {
-        const StoredReading& reading = storedReadings.readings[i];
-        
-        struct tm timeinfo;
-        localtime_r(&reading.timestamp, &timeinfo);
-        char timeStr[30];
-        strftime(timeStr, sizeof(timeStr), "%Y-%m-%dT%H:%M:%S.000Z", &timeinfo);
-        
-        for (int j = 0; j < reading.numDataPoints; j++) {
-            JsonObject dataPoint = array.add<JsonObject>();
-            dataPoint["type"] = reading.dataPoints[j].type;
-            dataPoint["value"] = reading.dataPoints[j].value;
-            dataPoint["sensor"] = getSensorString(reading.dataPoints[j].sensorId);
-            dataPoint["deviceId"] = deviceId;
-            dataPoint["timestamp"] = timeStr;
+        if (chunk.source == ChunkSource::SPILL_LOG) {
+            SpillLogReader logReader;
+            ReadingBlock block;
+            for (int records = 0; records < chunk.items && logReader.next(block); records++) {
+                ReadingBlockDecoder decoder(block);
+                while (decoder.next(reading)) {
+                    encoder.writeReading(reading);
+                }
+            }
+        } else if (chunk.source == ChunkSource::AGGREGATES) {
+            AggregateBucketReader bucketReader;
+            const AggregateBucket* bucket;
+            for (int buckets = 0; buckets < chunk.items && bucketReader.next(bucket); buckets++) {
+                encoder.writeBucket(*bucket);
+            }
+        } else if (chunk.source == ChunkSource::RAW) {
+            StoredReadingReader reader;
+            for (int readings = 0; readings < chunk.items && reader.next(reading); readings++) {
+                encoder.writeReading(reading);
+            }
         }
-    }
-
-    String payload;
-    serializeJson(doc, payload);
-    Serial.println(payload);
-    return payload;
+#if WAKE_PROFILER_ENABLED
+        else if (chunk.source == ChunkSource::PROFILE) {
+            encoder.writeProfile(wakeProfile);
+        }
+#endif
+    });
 }
 
-
-bool sendStoredReadings() {
-    if (storedReadings.count == 0) {
-        Serial.println("No stored readings to send");
-        return true;
-    }
-
-    Serial.printf("Attempting to send %d stored readings\n", storedReadings.count);
+// Retries only while the upload budget has room for the delay
+static bool sendWithRetries(const BodyWriter& writeBody, uint32_t sequence, const PhaseBudget& budget) {
     bool success = false;
     int retryCount = 0;
     
     while (!success && retryCount < MAX_RETRIES) {
         if (retryCount > 0) {
-            Serial.printf("Retry attempt %d of %d\n", retryCount, MAX_RETRIES);
+            if (budget.remainingMs() <= static_cast<uint32_t>(RETRY_DELAY)) {
+                LOG_WARN(NETWORK, "No upload budget left for a retry");
+                return false;
+            }
+            LOG_WARN(NETWORK, "Retry attempt %d of %d", retryCount, MAX_RETRIES);
             delay(RETRY_DELAY);
         }
         
-        String payload = createJsonPayload();
-        success = sendHttpRequest(payload);
+        success = sendHttpRequest(writeBody, sequence);
         if (!success) retryCount++;
     }
     
     if (!success) {
-        Serial.printf("Failed to send data after %d attempts\n", MAX_RETRIES);
+        LOG_WARN(NETWORK, "Failed to send data after %d attempts", MAX_RETRIES);
     }
     
     return success;
 }
 
+// A pending chunk can only be resent as-is while storage still holds the
+// same extent; overflow handling or spilling may have moved it since
+static bool isChunkIntact(const PendingChunk& chunk) {
+    switch (chunk.source) {
+        case ChunkSource::SPILL_LOG:
+            return spillLogPendingReadings() >= chunk.logReadings &&
+                   spillLogState.cursor.segment == chunk.logStart.segment &&
+                   spillLogState.cursor.record == chunk.logStart.record;
+        case ChunkSource::AGGREGATES:
+            return storedReadings.bucketGeneration == chunk.generation && storedBucketCount() > 0;
+        case ChunkSource::RAW:
+            return storedReadings.headGeneration == chunk.generation &&
+                   storedReadings.count >= chunk.items;
+#if WAKE_PROFILER_ENABLED
+        case ChunkSource::PROFILE:
+            return wakeProfile.wakes == chunk.items;  // Any later wake changed the content
+#endif
+        default:
+            return false;
+    }
+}
+
+// Picks the chunk to send next: the unacknowledged one if it is still
+// intact, otherwise the oldest data under a fresh sequence number
+static bool selectChunk(PendingChunk& chunk) {
+    SleepGuard guard;
 
+    if (uploadState.magic != UPLOAD_STATE_MAGIC) {
+        // Seeding from the clock keeps sequences increasing across power loss
+        uploadState.magic = UPLOAD_STATE_MAGIC;
+        uploadState.nextSequence = timeState.lastKnownTime > 0 ? timeState.lastKnownTime : 1;
+        chunk.source = ChunkSource::NONE;
+    }
 
+    if (chunk.source != ChunkSource::NONE) {
+        if (isChunkIntact(chunk)) {
+            LOG_INFO(NETWORK, "Resending unacknowledged chunk #%lu", static_cast<unsigned long>(chunk.sequence));
+            return true;
+        }
+        LOG_WARN(NETWORK, "Chunk #%lu no longer matches storage, starting a new one",
+                 static_cast<unsigned long>(chunk.sequence));
+        chunk.source = ChunkSource::NONE;
+    }
+
+    if (spillLogPendingRecords() > 0) {
+        // The extent is measured once; records appended later belong to the next chunk
+        SpillLogReader probe;
+        ReadingBlock block;
+        uint16_t records = 0;
+        while (records < SPILL_UPLOAD_RECORDS && probe.next(block)) records++;
+
+        if (records > 0) {
+            chunk.source = ChunkSource::SPILL_LOG;
+            chunk.items = records;
+            chunk.logStart = spillLogState.cursor;
+            chunk.logEnd = probe.position();
+            chunk.logReadings = probe.readingsRead();
+        } else {
+            acknowledgeSpilledReadings(probe.position(), 0);  // Only damaged records were left
+        }
+    }
 
+    if (chunk.source == ChunkSource::NONE && storedBucketCount() > 0) {
+        chunk.source = ChunkSource::AGGREGATES;
+        chunk.items = storedBucketCount();
+        chunk.generation = storedReadings.bucketGeneration;
+    }
+
+    if (chunk.source == ChunkSource::NONE && storedReadings.count > 0) {
+        chunk.source = ChunkSource::RAW;
+        chunk.items = storedReadings.count < UPLOAD_CHUNK_READINGS ? storedReadings.count : UPLOAD_CHUNK_READINGS;
+        chunk.generation = storedReadings.headGeneration;
+    }
+
+#if WAKE_PROFILER_ENABLED
+    // The profile rides along once the data is out
+    if (chunk.source == ChunkSource::NONE && isProfileUploadDue()) {
+        chunk.source = ChunkSource::PROFILE;
+        chunk.items = wakeProfile.wakes;
+    }
+#endif
+
+    if (chunk.source == ChunkSource::NONE) return false;
+    chunk.sequence = uploadState.nextSequence++;
+    return true;
+}
+
+static void acknowledgeChunk(PendingChunk& chunk) {
+    SleepGuard guard;
+    switch (chunk.source) {
+        case ChunkSource::SPILL_LOG:
+            acknowledgeSpilledReadings(chunk.logEnd, chunk.logReadings);
+            break;
+        case ChunkSource::AGGREGATES:
+            clearAggregateBuckets();
+            break;
+        case ChunkSource::RAW:
+            acknowledgeStoredReadings(chunk.items);
+            break;
+#if WAKE_PROFILER_ENABLED
+        case ChunkSource::PROFILE:
+            clearWakeProfile();
+            break;
+#endif
+        default:
+            break;
+    }
+    chunk.source = ChunkSource::NONE;
+}
+
+bool sendStoredReadings() {
+    PROFILE_PHASE(UPLOAD);
+    PhaseBudget budget(WakePhase::UPLOAD);
+
+    if (!hasStoredReadings()) {
+        LOG_INFO(NETWORK, "No stored readings to send");
+        return true;
+    }
+
+    LOG_INFO(NETWORK, "Attempting to send %d stored readings (%d aggregate buckets)",
+             storedReadingCount(), storedBucketCount());
+
+    // Oldest data goes first; each chunk is released as soon as it is acknowledged,
+    // so a failure only leaves the current chunk pending for the next wake
+    PendingChunk& chunk = uploadState.pending;
+    bool success = true;
+    while (true) {
+        if (budget.expired()) {
+            LOG_WARN(NETWORK, "Upload budget used up, the rest waits for a later wake");
+            success = false;
+            break;
+        }
+        if (!selectChunk(chunk)) break;
+
+        LOG_INFO(NETWORK, "Sending chunk #%lu", static_cast<unsigned long>(chunk.sequence));
+        bool sent = sendWithRetries([&](Print& out) {
+            writeChunk(out, chunk);
+        }, chunk.sequence, budget);
+
+        if (!sent) {
+            recordPhaseFailure(WakePhase::UPLOAD);
+            success = false;
+            break;
+        }
+        acknowledgeChunk(chunk);
+    }
+
+    transport.stop();
+    transport.report();
+    return success;
+}
@@ -0,0 +1,186 @@
+#include "payload_encoder.hpp"
+
+const char* getSensorString(SensorId sensorId) {
+    switch(sensorId) {
+        case SensorId::BME680: return "bme680";
+        case SensorId::SOIL_MOISTURE: return "soil_moisture";
+        case SensorId::BATTERY: return "battery";
+        case SensorId::NETWORK: return "network";
+        case SensorId::DEVICE: return "device";
+        default: return "unknown";
+    }
+}
+
+const char* getPayloadContentType(PayloadFormat format) {
+    switch (format) {
+        case PayloadFormat::CBOR: return "application/cbor";
+        case PayloadFormat::JSON:
+        default: return "application/json";
+    }
+}
+
+static void formatTimestamp(time_t timestamp, char* buffer, size_t size) {
+    struct tm timeinfo;
+    localtime_r(&timestamp, &timeinfo);
+    strftime(buffer, size, "%Y-%m-%dT%H:%M:%S.000Z", &timeinfo);
+}
+
+JsonPayloadEncoder::JsonPayloadEncoder(Print& out, const char* deviceId)
+    : json(out), deviceId(deviceId) {}
+
+void JsonPayloadEncoder::begin() {
+    json.beginArray();
+}
+
+void JsonPayloadEncoder::end() {
+    json.endArray();
+}
+
+void JsonPayloadEncoder::writeReading(const StoredReading& reading) {
+    char timeStr[30];
+    formatTimestamp(reading.timestamp, timeStr, sizeof(timeStr));
+    
+    for (int j = 0; j < reading.numDataPoints; j++) {
+        const MetricId metric = reading.dataPoints[j].metric;
+        json.beginObject();
+        json.member("type", getMetricName(metric));
+        json.member("value", reading.dataPoints[j].value);
+        json.member("sensor", getSensorString(getMetricSensor(metric)));
+        json.member("deviceId", deviceId);
+        json.member("timestamp", timeStr);
+        json.endObject();
+    }
+}
+
+// Decimated buckets are reported as mean with min/max
+void JsonPayloadEncoder::writeBucket(const AggregateBucket& bucket) {
+    char timeStr[30];
+    formatTimestamp(bucket.start, timeStr, sizeof(timeStr));
+
+    for (int j = 0; j < bucket.numValues; j++) {
+        const AggregateValue& value = bucket.values[j];
+        json.beginObject();
+        json.member("type", getMetricName(value.metric));
+        json.member("value", value.mean);
+        json.member("min", value.min);
+        json.member("max", value.max);
+        json.member("samples", static_cast<uint32_t>(value.samples));
+        json.member("interval", bucket.span);
+        json.member("sensor", getSensorString(getMetricSensor(value.metric)));
+        json.member("deviceId", deviceId);
+        json.member("timestamp", timeStr);
+        json.endObject();
+    }
+}
+
+#if WAKE_PROFILER_ENABLED
+// One object per profiled phase with the raw bucket counts for merging server side
+void JsonPayloadEncoder::writeProfile(const WakeProfile& profile) {
+    char timeStr[30];
+    formatTimestamp(profile.since, timeStr, sizeof(timeStr));
+
+    for (int i = 0; i < WAKE_PHASE_COUNT; i++) {
+        const PhaseHistogram& phase = profile.phases[i];
+        if (phase.samples == 0) continue;
+
+        json.beginObject();
+        json.member("type", "wake_phase_ms");
+        json.member("phase", getWakePhaseName(static_cast<WakePhase>(i)));
+        json.member("value", static_cast<float>(phase.totalUs / 1000.0 / phase.samples));
+        json.member("p50", profilePercentileMs(phase, 0.5f));
+        json.member("p90", profilePercentileMs(phase, 0.9f));
+        json.member("max", phase.maxUs / 1000.0f);
+        json.member("samples", static_cast<uint32_t>(phase.samples));
+        json.member("wakes", static_cast<uint32_t>(profile.wakes));
+        json.beginArray("histogram");
+        for (int j = 0; j < PROFILE_HISTOGRAM_BUCKETS; j++) {
+            json.element(phase.buckets[j]);
+        }
+        json.endArray();
+        json.member("sensor", getSensorString(SensorId::DEVICE));
+        json.member("deviceId", deviceId);
+        json.member("timestamp", timeStr);
+        json.endObject();
+    }
+}
+#endif
+
+CborPayloadEncoder::CborPayloadEncoder(Print& out, const char* deviceId)
+    : cbor(out), deviceId(deviceId), section(NONE) {}
+
+void CborPayloadEncoder::begin() {
+    cbor.beginIndefiniteMap();
+    cbor.writeUint(0);
+    cbor.writeUint(SCHEMA_VERSION);
+    cbor.writeUint(1);
+    cbor.writeText(deviceId);
+}
+
+void CborPayloadEncoder::enterSection(Section next) {
+    if (section == next) return;
+    if (section != NONE) cbor.writeBreak();
+
+    cbor.writeUint(next == BUCKETS ? 2 : next == READINGS ? 3 : 4);
+    cbor.beginIndefiniteArray();
+    section = next;
+}
+
+void CborPayloadEncoder::writeBucket(const AggregateBucket& bucket) {
+    enterSection(BUCKETS);
+
+    cbor.beginArray(2 + 5 * bucket.numValues);
+    cbor.writeUint(bucket.start);
+    cbor.writeUint(bucket.span);
+    for (int j = 0; j < bucket.numValues; j++) {
+        const AggregateValue& value = bucket.values[j];
+        cbor.writeUint(static_cast<uint32_t>(value.metric));
+        cbor.writeUint(value.samples);
+        cbor.writeFloat(value.mean);
+        cbor.writeFloat(value.min);
+        cbor.writeFloat(value.max);
+    }
+}
+
+void CborPayloadEncoder::writeReading(const StoredReading& reading) {
+    enterSection(READINGS);
+
+    cbor.beginArray(1 + 2 * reading.numDataPoints);
+    cbor.writeUint(static_cast<uint32_t>(reading.timestamp));
+    for (int j = 0; j < reading.numDataPoints; j++) {
+        cbor.writeUint(static_cast<uint32_t>(reading.dataPoints[j].metric));
+        cbor.writeFloat(reading.dataPoints[j].value);
+    }
+}
+
+#if WAKE_PROFILER_ENABLED
+void CborPayloadEncoder::writeProfile(const WakeProfile& profile) {
+    enterSection(PROFILE);
+
+    int phases = 0;
+    for (int i = 0; i < WAKE_PHASE_COUNT; i++) {
+        if (profile.phases[i].samples > 0) phases++;
+    }
+
+    cbor.beginArray(2 + 5 * phases);
+    cbor.writeUint(static_cast<uint32_t>(profile.since));
+    cbor.writeUint(profile.wakes);
+    for (int i = 0; i < WAKE_PHASE_COUNT; i++) {
+        const PhaseHistogram& phase = profile.phases[i];
+        if (phase.samples == 0) continue;
+
+        cbor.writeUint(i);
+        cbor.writeUint(phase.samples);
+        cbor.writeUint(static_cast<uint32_t>(phase.totalUs / 1000));
+        cbor.writeUint(phase.maxUs);
+        cbor.beginArray(PROFILE_HISTOGRAM_BUCKETS);
+        for (int j = 0; j < PROFILE_HISTOGRAM_BUCKETS; j++) {
+            cbor.writeUint(phase.buckets[j]);
+        }
+    }
+}
+#endif
+
+void CborPayloadEncoder::end() {
+    if (section != NONE) cbor.writeBreak();
+    cbor.writeBreak();
+}
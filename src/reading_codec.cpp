@@ -0,0 +1,272 @@
+#include "reading_codec.hpp"
+#include <string.h>
+
+// Timestamps are stored as the deviation from the previous interval repeated,
+// which is zero for every on-time wake under any cadence. Only earlier
+// readings of the block go into it, so decoding never depends on the
+// schedule of the build that reads it back.
+static int64_t expectedTimestamp(const ReadingCodecState& state) {
+    return static_cast<int64_t>(state.lastTimestamp) + state.lastInterval;
+}
+
+static void advanceTimestamp(ReadingCodecState& state, uint32_t timestamp) {
+    if (state.lastTimestamp != 0) {
+        state.lastInterval = static_cast<int32_t>(timestamp - state.lastTimestamp);
+    }
+    state.lastTimestamp = timestamp;
+}
+
+BitWriter::BitWriter(uint8_t* buffer, size_t capacityBytes, uint32_t startBit)
+    : buffer(buffer), capacityBits(capacityBytes * 8), bitPos(startBit) {}
+
+bool BitWriter::write(uint32_t value, uint8_t numBits) {
+    if (bitPos + numBits > capacityBits) return false;
+
+    for (int i = numBits - 1; i >= 0; i--) {
+        uint8_t& byte = buffer[bitPos >> 3];
+        const uint8_t mask = 0x80 >> (bitPos & 7);
+        if ((bitPos & 7) == 0) byte = 0;  // Buffer may hold stale data from before a clear
+        if ((value >> i) & 1) byte |= mask;
+        bitPos++;
+    }
+    return true;
+}
+
+BitReader::BitReader(const uint8_t* buffer, uint32_t endBit, uint32_t startBit)
+    : buffer(buffer), endBit(endBit), bitPos(startBit) {}
+
+bool BitReader::read(uint8_t numBits, uint32_t& value) {
+    if (bitPos + numBits > endBit) return false;
+
+    value = 0;
+    for (int i = 0; i < numBits; i++) {
+        const uint8_t bit = (buffer[bitPos >> 3] >> (7 - (bitPos & 7))) & 1;
+        value = (value << 1) | bit;
+        bitPos++;
+    }
+    return true;
+}
+
+void resetCodecState(ReadingCodecState& state) {
+    memset(&state, 0, sizeof(state));
+}
+
+static uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsToFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+static bool encodeTimestamp(BitWriter& writer, ReadingCodecState& state, uint32_t timestamp) {
+    const bool first = state.lastTimestamp == 0;
+    const int64_t deviation = static_cast<int64_t>(timestamp) - expectedTimestamp(state);
+    bool ok;
+
+    if (first) {
+        ok = writer.write(0x7, 3) && writer.write(timestamp, 32);
+    } else if (deviation == 0) {
+        ok = writer.write(0x0, 1);
+    } else if (deviation >= -128 && deviation < 128) {
+        ok = writer.write(0x2, 2) && writer.write(zigzag(deviation), 8);
+    } else if (deviation >= -32768 && deviation < 32768) {
+        ok = writer.write(0x6, 3) && writer.write(zigzag(deviation), 16);
+    } else {
+        ok = writer.write(0x7, 3) && writer.write(timestamp, 32);
+    }
+
+    advanceTimestamp(state, timestamp);
+    return ok;
+}
+
+static bool decodeTimestamp(BitReader& reader, ReadingCodecState& state, uint32_t& timestamp) {
+    uint32_t bit;
+    uint32_t value;
+
+    if (!reader.read(1, bit)) return false;
+    if (bit == 0) {
+        timestamp = expectedTimestamp(state);
+    } else {
+        if (!reader.read(1, bit)) return false;
+        if (bit == 0) {
+            if (!reader.read(8, value)) return false;
+            timestamp = expectedTimestamp(state) + unzigzag(value);
+        } else {
+            if (!reader.read(1, bit)) return false;
+            if (bit == 0) {
+                if (!reader.read(16, value)) return false;
+                timestamp = expectedTimestamp(state) + unzigzag(value);
+            } else {
+                if (!reader.read(32, timestamp)) return false;
+            }
+        }
+    }
+
+    advanceTimestamp(state, timestamp);
+    return true;
+}
+
+static int leadingZeros(uint32_t value) {
+    return value == 0 ? 32 : __builtin_clz(value);
+}
+
+static int trailingZeros(uint32_t value) {
+    return value == 0 ? 32 : __builtin_ctz(value);
+}
+
+static bool encodeValue(BitWriter& writer, ReadingCodecState& state, int metric, float value) {
+    const uint32_t bits = floatBits(value);
+    const uint32_t xorBits = bits ^ state.lastValueBits[metric];
+    state.lastValueBits[metric] = bits;
+
+    if (xorBits == 0) {
+        return writer.write(0x0, 1);
+    }
+
+    int leading = leadingZeros(xorBits);
+    const int trailing = trailingZeros(xorBits);
+    const int prevLeading = state.lastLeadingZeros[metric];
+    const int prevMeaningful = state.lastMeaningfulBits[metric];
+
+    if (prevMeaningful > 0 && leading >= prevLeading &&
+        trailing >= 32 - prevLeading - prevMeaningful) {
+        const int shift = 32 - prevLeading - prevMeaningful;
+        return writer.write(0x2, 2) && writer.write(xorBits >> shift, prevMeaningful);
+    }
+
+    if (leading > 31) leading = 31;
+    const int meaningful = 32 - leading - trailing;
+    state.lastLeadingZeros[metric] = leading;
+    state.lastMeaningfulBits[metric] = meaningful;
+
+    return writer.write(0x3, 2) &&
+           writer.write(leading, 5) &&
+           writer.write(meaningful - 1, 5) &&
+           writer.write(xorBits >> trailing, meaningful);
+}
+
+static bool decodeValue(BitReader& reader, ReadingCodecState& state, int metric, float& value) {
+    uint32_t bit;
+    uint32_t xorBits = 0;
+
+    if (!reader.read(1, bit)) return false;
+    if (bit == 1) {
+        if (!reader.read(1, bit)) return false;
+        if (bit == 1) {
+            uint32_t leading;
+            uint32_t meaningful;
+            if (!reader.read(5, leading) || !reader.read(5, meaningful)) return false;
+            state.lastLeadingZeros[metric] = leading;
+            state.lastMeaningfulBits[metric] = meaningful + 1;
+        }
+
+        const int prevLeading = state.lastLeadingZeros[metric];
+        const int prevMeaningful = state.lastMeaningfulBits[metric];
+        if (!reader.read(prevMeaningful, xorBits)) return false;
+        xorBits <<= 32 - prevLeading - prevMeaningful;
+    }
+
+    state.lastValueBits[metric] ^= xorBits;
+    value = bitsToFloat(state.lastValueBits[metric]);
+    return true;
+}
+
+bool encodeReading(BitWriter& writer, ReadingCodecState& state,
+                   const SensorData& data, time_t timestamp) {
+    float values[METRIC_COUNT];
+    uint16_t metricMask = 0;
+
+    for (int i = 0; i < data.numDataPoints; i++) {
+        const int metric = static_cast<int>(data.dataPoints[i].metric);
+        if (metric >= METRIC_COUNT) continue;
+        values[metric] = data.dataPoints[i].value;
+        metricMask |= 1 << metric;
+    }
+
+    // Work on copies so a reading that doesn't fit leaves the stream unchanged
+    BitWriter next = writer;
+    ReadingCodecState nextState = state;
+
+    if (!encodeTimestamp(next, nextState, static_cast<uint32_t>(timestamp))) return false;
+
+    if (metricMask == nextState.lastMetricMask) {
+        if (!next.write(0x0, 1)) return false;
+    } else {
+        if (!next.write(0x1, 1) || !next.write(metricMask, METRIC_COUNT)) return false;
+        nextState.lastMetricMask = metricMask;
+    }
+
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+        if (!(metricMask & (1 << metric))) continue;
+        if (!encodeValue(next, nextState, metric, values[metric])) return false;
+    }
+
+    writer = next;
+    state = nextState;
+    return true;
+}
+
+bool decodeReading(BitReader& reader, ReadingCodecState& state, StoredReading& reading) {
+    BitReader next = reader;
+    ReadingCodecState nextState = state;
+    uint32_t timestamp;
+    uint32_t bit;
+
+    if (!decodeTimestamp(next, nextState, timestamp)) return false;
+
+    if (!next.read(1, bit)) return false;
+    if (bit == 1) {
+        uint32_t metricMask;
+        if (!next.read(METRIC_COUNT, metricMask)) return false;
+        nextState.lastMetricMask = metricMask;
+    }
+
+    reading.timestamp = timestamp;
+    reading.numDataPoints = 0;
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+        if (!(nextState.lastMetricMask & (1 << metric))) continue;
+        if (reading.numDataPoints >= MAX_DATA_POINTS_PER_READING) return false;
+
+        DataPoint& point = reading.dataPoints[reading.numDataPoints++];
+        point.metric = static_cast<MetricId>(metric);
+        if (!decodeValue(next, nextState, metric, point.value)) return false;
+    }
+
+    reader = next;
+    state = nextState;
+    return true;
+}
+
+ReadingBlockDecoder::ReadingBlockDecoder()
+    : reader(nullptr, 0), remaining(0) {
+    resetCodecState(state);
+}
+
+ReadingBlockDecoder::ReadingBlockDecoder(const ReadingBlock& block)
+    : reader(block.data, block.bitsUsed), remaining(block.count) {
+    resetCodecState(state);
+
+    // Values are XOR chained, so skipped readings still have to be decoded
+    StoredReading skipped;
+    for (int i = 0; i < block.skip && next(skipped); i++) {}
+}
+
+bool ReadingBlockDecoder::next(StoredReading& reading) {
+    if (remaining <= 0) return false;
+    if (!decodeReading(reader, state, reading)) return false;
+    remaining--;
+    return true;
+}
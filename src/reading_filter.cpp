@@ -0,0 +1,66 @@
+#include "reading_filter.hpp"
+#include <math.h>
+#include "logging.hpp"
+
+static_assert(sizeof(METRIC_FILTERS) / sizeof(METRIC_FILTERS[0]) == METRIC_COUNT,
+              "METRIC_FILTERS needs one entry per metric");
+
+RTC_DATA_ATTR ReadingFilterState readingFilter = {};
+
+static void addToWindow(MetricWindow& window, float value) {
+    if (window.count == 0) {
+        window.mean = 0.0f;
+        window.m2 = 0.0f;
+        window.min = value;
+        window.max = value;
+    }
+    if (window.count < UINT16_MAX) window.count++;
+
+    const float delta = value - window.mean;
+    window.mean += delta / window.count;
+    window.m2 += delta * (value - window.mean);
+    if (value < window.min) window.min = value;
+    if (value > window.max) window.max = value;
+}
+
+float windowVariance(const MetricWindow& window) {
+    return window.count > 1 ? window.m2 / (window.count - 1) : 0.0f;
+}
+
+bool filterReading(const SensorData& data, time_t now, SensorData& out) {
+    out.numDataPoints = 0;
+
+    for (int i = 0; i < data.numDataPoints; i++) {
+        const DataPoint& point = data.dataPoints[i];
+        const MetricFilter& filter = METRIC_FILTERS[static_cast<int>(point.metric)];
+        MetricWindow& window = readingFilter.windows[static_cast<int>(point.metric)];
+
+        addToWindow(window, point.value);
+
+        float value = point.value;
+        if (READING_FILTER_ENABLED && filter.maxSilenceSeconds > 0 && window.stored) {
+            const bool moved = fabsf(point.value - window.lastStored) > filter.deadband;
+            // A clock that went back closes the window rather than stretching it
+            const bool closed = now < static_cast<time_t>(window.lastStoredAt) ||
+                                now - window.lastStoredAt >= filter.maxSilenceSeconds;
+            if (!moved && !closed) continue;
+
+            // A quiet window is summarised by its mean, a jump by the new value
+            if (!moved) value = window.mean;
+            LOG_DEBUG(STORAGE, "%s window of %u readings ended: mean %.2f, min %.2f, max %.2f, var %.3f",
+                      getMetricName(point.metric), window.count, window.mean, window.min, window.max,
+                      windowVariance(window));
+        }
+
+        out.dataPoints[out.numDataPoints++] = {point.metric, value};
+        window.lastStored = value;
+        window.lastStoredAt = static_cast<uint32_t>(now);
+        window.stored = true;
+        window.count = 0;
+    }
+
+    if (out.numDataPoints < data.numDataPoints) {
+        LOG_DEBUG(STORAGE, "Deadband filter kept %d of %d data points", out.numDataPoints, data.numDataPoints);
+    }
+    return out.numDataPoints > 0;
+}
@@ -0,0 +1,36 @@
+#include "sample_stats.hpp"
+#include <algorithm>
+
+bool computeSampleStats(uint16_t* samples, size_t count, float trimFraction, SampleStats& stats) {
+    if (count == 0) return false;
+
+    std::sort(samples, samples + count);
+
+    stats.count = count;
+    stats.min = samples[0];
+    stats.max = samples[count - 1];
+    stats.median = count % 2 ? samples[count / 2]
+                             : (samples[count / 2 - 1] + samples[count / 2]) / 2.0f;
+
+    if (trimFraction < 0.0f) trimFraction = 0.0f;
+    if (trimFraction > 0.5f) trimFraction = 0.5f;
+    size_t trim = static_cast<size_t>(count * trimFraction);
+    if (trim * 2 >= count) trim = (count - 1) / 2;  // Keep at least the middle sample(s)
+
+    uint32_t sum = 0;
+    for (size_t i = trim; i < count - trim; i++) {
+        sum += samples[i];
+    }
+    stats.trimmedMean = static_cast<float>(sum) / (count - 2 * trim);
+
+    // Welford's update avoids the cancellation of sum-of-squares
+    double mean = 0.0;
+    double m2 = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        const double delta = samples[i] - mean;
+        mean += delta / (i + 1);
+        m2 += delta * (samples[i] - mean);
+    }
+    stats.variance = count > 1 ? static_cast<float>(m2 / (count - 1)) : 0.0f;
+    return true;
+}
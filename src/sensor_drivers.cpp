@@ -0,0 +1,289 @@
+#include "sensor_drivers.hpp"
+#include <bme68x.h>   // Bosch BME68x API, part of the Adafruit BME680 library
+#include <WiFi.h>
+#include <Wire.h>
+#include <math.h>
+#include <stddef.h>
+#include "esp_attr.h"
+#include "adc_sampler.hpp"
+#include "checksum.hpp"
+#include "config.hpp"
+#include "data_manager.hpp"
+#include "logging.hpp"
+
+const char* getBatteryTypeString(BatteryType type) {
+    switch(type) {
+        case BatteryType::LIPO:
+            return "lipo";
+        case BatteryType::AA_BATTERIES:
+            return "aa_batteries";
+        default:
+            return "unknown";
+    }
+}
+
+// Humidity 2x, temperature 8x, pressure 4x oversampling, IIR filter 3
+static const bme68x_conf BME_CONF = {BME68X_OS_2X, BME68X_OS_8X, BME68X_OS_4X, BME68X_FILTER_SIZE_3, BME68X_ODR_NONE};
+
+// What a cold start reads from the chip, checked against the settings of
+// this build so a firmware with other settings starts cold
+struct Bme680WarmState {
+    uint32_t variantId;
+    bme68x_calib_data calib;
+    uint32_t crc;
+};
+
+static RTC_DATA_ATTR Bme680WarmState bmeWarmState = {};
+
+static bme68x_dev bmeDevice;
+static uint32_t bmeTransactions = 0;
+
+static uint32_t bmeWarmStateCrc() {
+    const uint16_t heater[] = {BME_HEATER_TEMP_C, BME_HEATER_MS};
+    uint32_t crc = crc32(&bmeWarmState, offsetof(Bme680WarmState, crc));
+    crc = crc32(&BME_CONF, sizeof(BME_CONF), crc);
+    return crc32(heater, sizeof(heater), crc);
+}
+
+static BME68X_INTF_RET_TYPE bmeRead(uint8_t reg, uint8_t* data, uint32_t length, void*) {
+    bmeTransactions++;
+    Wire.beginTransmission(BME_ADDRESS);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) return -1;
+    if (Wire.requestFrom(static_cast<uint8_t>(BME_ADDRESS), static_cast<uint8_t>(length)) != length) return -1;
+    for (uint32_t i = 0; i < length; i++) data[i] = Wire.read();
+    return 0;
+}
+
+static BME68X_INTF_RET_TYPE bmeWrite(uint8_t reg, const uint8_t* data, uint32_t length, void*) {
+    bmeTransactions++;
+    Wire.beginTransmission(BME_ADDRESS);
+    Wire.write(reg);
+    Wire.write(data, length);
+    return Wire.endTransmission() == 0 ? 0 : -1;
+}
+
+static void bmeDelayUs(uint32_t period, void*) {
+    delayMicroseconds(period);
+}
+
+// Probes the chip, reads its calibration and programs the settings
+static bool bmeColdStart() {
+    bmeWarmState.crc = 0;
+    if (bme68x_init(&bmeDevice) != BME68X_OK) {
+        LOG_ERROR(SENSOR, "Could not find BME680 sensor!");
+        return false;
+    }
+
+    bme68x_conf conf = BME_CONF;
+    bme68x_heatr_conf heater = {};
+    heater.enable = BME68X_ENABLE;
+    heater.heatr_temp = BME_HEATER_TEMP_C;
+    heater.heatr_dur = BME_HEATER_MS;
+    if (bme68x_set_conf(&conf, &bmeDevice) != BME68X_OK ||
+        bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heater, &bmeDevice) != BME68X_OK) {
+        LOG_ERROR(SENSOR, "Failed to configure BME680");
+        return false;
+    }
+
+    bmeWarmState.variantId = bmeDevice.variant_id;
+    bmeWarmState.calib = bmeDevice.calib;
+    bmeWarmState.crc = bmeWarmStateCrc();
+    return true;
+}
+
+// Restores what a cold start read, if the chip has stayed powered since
+static bool bmeWarmStart() {
+    if (!BME_WARM_START || esp_reset_reason() != ESP_RST_DEEPSLEEP) return false;
+    if (bmeWarmState.crc != bmeWarmStateCrc()) return false;
+
+    bmeDevice.chip_id = BME68X_CHIP_ID;
+    bmeDevice.variant_id = bmeWarmState.variantId;
+    bmeDevice.calib = bmeWarmState.calib;
+    return true;
+}
+
+bool Bme680Driver::initialize() {
+    const unsigned long startUs = micros();
+    const uint32_t startTransactions = bmeTransactions;
+    Wire.begin(BME_SDA, BME_SCL);
+
+    bmeDevice.intf = BME68X_I2C_INTF;
+    bmeDevice.intf_ptr = nullptr;
+    bmeDevice.read = bmeRead;
+    bmeDevice.write = bmeWrite;
+    bmeDevice.delay_us = bmeDelayUs;
+    bmeDevice.amb_temp = 25;
+
+    const bool warm = bmeWarmStart();
+    if (!warm && !bmeColdStart()) return false;
+
+    LOG_INFO(SENSOR, "BME680 %s start: %lu us, %lu I2C transactions", warm ? "warm" : "cold",
+             micros() - startUs, static_cast<unsigned long>(bmeTransactions - startTransactions));
+    return true;
+}
+
+bool Bme680Driver::start(unsigned long& readyAt) {
+    // Conversion and gas heater run on the sensor while the other sensors sample
+    bme68x_conf conf = BME_CONF;
+    if (bme68x_set_op_mode(BME68X_FORCED_MODE, &bmeDevice) != BME68X_OK) {
+        LOG_ERROR(SENSOR, "Failed to perform BME680 reading!");
+        bmeWarmState.crc = 0;
+        return false;
+    }
+    readyAt = millis() + bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, &bmeDevice) / 1000 + BME_HEATER_MS + 1;
+    return true;
+}
+
+bool Bme680Driver::read(DataPoint* points) {
+    bme68x_data data;
+    uint8_t fields = 0;
+    if (bme68x_get_data(BME68X_FORCED_MODE, &data, &fields, &bmeDevice) != BME68X_OK || fields == 0) {
+        LOG_ERROR(SENSOR, "Failed to perform BME680 reading!");
+        bmeWarmState.crc = 0;   // Start cold next time in case the chip lost its settings
+        return false;
+    }
+
+    // Without a stable heater the gas settings were lost, e.g. by a brownout of the sensor
+    const bool gasValid = (data.status & BME68X_GASM_VALID_MSK) && (data.status & BME68X_HEAT_STAB_MSK);
+    if (!gasValid) {
+        LOG_WARN(SENSOR, "BME680 gas measurement not valid");
+        bmeWarmState.crc = 0;
+    }
+    LOG_DEBUG(SENSOR, "BME680 I2C transactions this wake: %lu", static_cast<unsigned long>(bmeTransactions));
+
+    points[0].value = data.temperature;
+    points[1].value = data.humidity;
+    points[2].value = data.pressure / 100.0f;
+    points[3].value = gasValid ? data.gas_resistance / 1000.0f : NAN;  // Left out of the reading
+    return true;
+}
+
+bool SoilMoistureDriver::initialize() {
+    pinMode(SOIL_MOISTURE_PIN, INPUT);
+    pinMode(SOIL_MOISTURE_POWER_PIN, OUTPUT);
+    AdcSampler::begin();
+    return true;
+}
+
+bool SoilMoistureDriver::start(unsigned long& readyAt) {
+    digitalWrite(SOIL_MOISTURE_POWER_PIN, HIGH);
+    readyAt = millis() + SOIL_MOISTURE_SETTLE_MS;
+    return true;
+}
+
+bool SoilMoistureDriver::read(DataPoint* points) {
+    // One burst of a few milliseconds replaces spaced out single reads
+    SampleStats stats;
+    const bool sampled = AdcSampler::capture(SOIL_MOISTURE_PIN, stats);
+    digitalWrite(SOIL_MOISTURE_POWER_PIN, LOW);
+    
+    if (!sampled) {
+        LOG_ERROR(SENSOR, "Failed to sample soil moisture!");
+        return false;
+    }
+    
+    // Calibration values are raw counts, so stay in counts
+    float rawValue = stats.trimmedMean;
+    
+    float moistureValue = constrain(rawValue, SOIL_MOISTURE_WATER_VALUE, SOIL_MOISTURE_AIR_VALUE);
+    float moisturePercent = 100.0f * (moistureValue - SOIL_MOISTURE_AIR_VALUE) / 
+                           (SOIL_MOISTURE_WATER_VALUE - SOIL_MOISTURE_AIR_VALUE);
+    
+    points[0].value = rawValue;
+    points[1].value = moisturePercent;
+    
+    LOG_DEBUG(SENSOR, "Soil Moisture - Raw: %.2f (median %.1f, variance %.2f, n=%u), Percent: %.2f%%",
+              rawValue, stats.median, stats.variance, static_cast<unsigned>(stats.count), moisturePercent);
+    return true;
+}
+
+bool BatteryDriver::initialize() {
+    pinMode(BATTERY_VOLTAGE_PIN, INPUT);
+    AdcSampler::begin();
+    return true;
+}
+
+bool BatteryDriver::start(unsigned long& readyAt) {
+    readyAt = millis();
+    return true;
+}
+
+bool BatteryDriver::read(DataPoint* points) {
+    SampleStats stats;
+    if (!AdcSampler::capture(BATTERY_VOLTAGE_PIN, stats)) {
+        LOG_ERROR(SENSOR, "Failed to sample battery voltage!");
+        return false;
+    }
+    
+    // Calibrated conversion instead of assuming a linear 0-3.3V range
+    float voltageRaw = AdcSampler::toMillivolts(stats.trimmedMean) / 1000.0f;
+    float batteryVoltage = voltageRaw * BATTERY_VOLTAGE_DIVIDER_RATIO;
+    
+    // Get voltage range based on battery type
+    float minVoltage, maxVoltage;
+    switch(BATTERY_TYPE) {
+        case BatteryType::LIPO:
+            minVoltage = LIPO_MIN_VOLTAGE;
+            maxVoltage = LIPO_MAX_VOLTAGE;
+            break;
+        case BatteryType::AA_BATTERIES:
+            minVoltage = AA_MIN_VOLTAGE;
+            maxVoltage = AA_MAX_VOLTAGE;
+            break;
+    }
+    
+    // Calculate battery percentage based on configured battery type
+    float batteryPercent = constrain(
+        ((batteryVoltage - minVoltage) / (maxVoltage - minVoltage)) * 100.0,
+        0.0,
+        100.0
+    );
+    
+    points[0].value = batteryVoltage;
+    points[1].value = batteryPercent;
+    points[2].value = (float)static_cast<int>(BATTERY_TYPE) + 1.0;
+    
+    LOG_DEBUG(SENSOR, "Battery Metrics - Voltage: %.2fV (%.1f%%) Type: %d", 
+              batteryVoltage, batteryPercent, static_cast<int>(BATTERY_TYPE));
+    return true;
+}
+
+bool NetworkMetricsDriver::initialize() {
+    return true;  // No initialization needed
+}
+
+bool NetworkMetricsDriver::start(unsigned long& readyAt) {
+    readyAt = millis();
+    return true;
+}
+
+// Only reserves the points; the sensor task may run while the link is still
+// coming up and the network task owns storage, so complete() fills them in
+bool NetworkMetricsDriver::read(DataPoint* points) {
+    for (int i = 0; i < DATA_POINTS; i++) points[i].value = 0.0f;
+    return true;
+}
+
+void NetworkMetricsDriver::complete(DataPoint* points, int count) {
+    const int rssi = WiFi.isConnected() ? WiFi.RSSI() : -100;
+    const int readings = storedReadingCount() + 1;  // Including this one
+    const int buckets = storedBucketCount();
+
+    for (int i = 0; i < count; i++) {
+        switch (points[i].metric) {
+            case MetricId::WIFI_RSSI:
+                points[i].value = static_cast<float>(rssi);
+                break;
+            case MetricId::STORED_READINGS_COUNT:
+                points[i].value = static_cast<float>(readings);
+                break;
+            default:
+                points[i].value = static_cast<float>(buckets);
+                break;
+        }
+    }
+
+    LOG_DEBUG(SENSOR, "Network Metrics - RSSI: %d dBm, Stored Readings: %d, Aggregate Buckets: %d",
+              rssi, readings, buckets);
+}
@@ -0,0 +1,405 @@
+#include "spill_log.hpp"
+#include "checksum.hpp"
+#include <Arduino.h>
+#include <dirent.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "logging.hpp"
+#ifdef ARDUINO
+#include <LittleFS.h>
+#endif
+
+static const uint32_t SPILL_LOG_MAGIC = 0x53504C47;   // "SPLG"
+static const uint32_t SPILL_RECORD_MAGIC = 0x52454332; // "REC2"
+
+RTC_DATA_ATTR SpillLogState spillLogState = {
+    .magic = 0,
+    .cursor = {0, 0},
+    .headSegment = 0,
+    .headRecords = 0,
+    .nextSequence = 1,
+    .pendingReadings = 0,
+    .pendingRecords = 0
+};
+
+// On-flash record, one sealed RTC block
+struct SpillRecord {
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t bitsUsed;
+    uint16_t count;
+    uint16_t skip;      // Readings acknowledged before the block was spilled
+    uint16_t reserved;
+    uint8_t data[RAW_BLOCK_BYTES];
+    uint32_t crc;  // Over all fields above
+};
+
+// Persisted upload cursor, replaced atomically via rename
+struct SpillCursorFile {
+    uint32_t magic;
+    uint32_t segment;
+    uint32_t record;
+    uint32_t nextSequence;
+    uint32_t crc;
+};
+
+static const char* logDirectory = SPILL_LOG_DIR;
+static bool mounted = false;
+static FILE* appendFile = nullptr;
+
+static void segmentPath(char* path, size_t size, uint32_t segment) {
+    snprintf(path, size, "%s/seg_%06lu.bin", logDirectory, static_cast<unsigned long>(segment));
+}
+
+static void statePath(char* path, size_t size, const char* name) {
+    snprintf(path, size, "%s/%s", logDirectory, name);
+}
+
+static bool ensureMounted() {
+    if (mounted) return true;
+
+#ifdef ARDUINO
+    if (!LittleFS.begin(true)) {
+        LOG_ERROR(STORAGE, "Failed to mount LittleFS");
+        return false;
+    }
+#endif
+
+    mkdir(logDirectory, 0755);
+    mounted = true;
+    return true;
+}
+
+static bool readRecord(FILE* file, SpillRecord& record) {
+    if (fread(&record, sizeof(record), 1, file) != 1) return false;
+    return record.magic == SPILL_RECORD_MAGIC &&
+           record.bitsUsed <= RAW_BLOCK_BYTES * 8 &&
+           record.skip <= record.count &&
+           record.crc == crc32(&record, offsetof(SpillRecord, crc));
+}
+
+static bool syncAndClose(FILE* file) {
+    bool ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok &= fclose(file) == 0;
+    return ok;
+}
+
+static bool persistCursor() {
+    char tmpPath[64];
+    char path[64];
+    statePath(tmpPath, sizeof(tmpPath), "cursor.tmp");
+    statePath(path, sizeof(path), "cursor.bin");
+
+    SpillCursorFile cursor = {
+        SPILL_LOG_MAGIC,
+        spillLogState.cursor.segment,
+        spillLogState.cursor.record,
+        spillLogState.nextSequence,
+        0
+    };
+    cursor.crc = crc32(&cursor, offsetof(SpillCursorFile, crc));
+
+    FILE* file = fopen(tmpPath, "wb");
+    if (file == nullptr) return false;
+
+    bool ok = fwrite(&cursor, sizeof(cursor), 1, file) == 1;
+    ok &= syncAndClose(file);
+    return ok && rename(tmpPath, path) == 0;
+}
+
+// Readings in the valid records of a segment from fromRecord on, the same
+// records a reader returns; records is set to how many there are
+static int countSegmentReadings(uint32_t segment, uint16_t fromRecord, int& records) {
+    char path[64];
+    segmentPath(path, sizeof(path), segment);
+
+    records = 0;
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) return 0;
+
+    int readings = 0;
+    SpillRecord record;
+    if (fseek(file, static_cast<long>(fromRecord) * sizeof(record), SEEK_SET) == 0) {
+        while (readRecord(file, record)) {
+            readings += record.count - record.skip;
+            records++;
+        }
+    }
+    fclose(file);
+    return readings;
+}
+
+// Drops the oldest segments once the log grows past its bound
+static void enforceSegmentLimit() {
+    while (spillLogState.headSegment - spillLogState.cursor.segment + 1 > SPILL_MAX_SEGMENTS) {
+        const uint32_t oldest = spillLogState.cursor.segment;
+        int lostRecords;
+        const int lost = countSegmentReadings(oldest, spillLogState.cursor.record, lostRecords);
+
+        spillLogState.cursor = {oldest + 1, 0};
+        spillLogState.pendingReadings -= lost;
+        spillLogState.pendingRecords -= lostRecords;
+        persistCursor();
+
+        char path[64];
+        segmentPath(path, sizeof(path), oldest);
+        remove(path);
+
+        LOG_WARN(STORAGE, "Spill log full, dropped %d oldest readings", lost);
+    }
+}
+
+static void recoverState() {
+    SpillLogState state = {SPILL_LOG_MAGIC, {0, 0}, 0, 0, 1, 0, 0};
+
+    char path[64];
+    statePath(path, sizeof(path), "cursor.bin");
+    FILE* file = fopen(path, "rb");
+    if (file != nullptr) {
+        SpillCursorFile cursor;
+        if (fread(&cursor, sizeof(cursor), 1, file) == 1 &&
+            cursor.magic == SPILL_LOG_MAGIC &&
+            cursor.crc == crc32(&cursor, offsetof(SpillCursorFile, crc))) {
+            state.cursor = {cursor.segment, static_cast<uint16_t>(cursor.record)};
+            state.nextSequence = cursor.nextSequence;
+        }
+        fclose(file);
+    }
+
+    // Find the segment range actually present on flash
+    bool found = false;
+    uint32_t minSegment = 0;
+    uint32_t maxSegment = 0;
+    DIR* dir = opendir(logDirectory);
+    if (dir != nullptr) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            unsigned long segment;
+            if (sscanf(entry->d_name, "seg_%lu.bin", &segment) != 1) continue;
+            if (!found || segment < minSegment) minSegment = segment;
+            if (!found || segment > maxSegment) maxSegment = segment;
+            found = true;
+        }
+        closedir(dir);
+    }
+
+    if (found && state.cursor.segment < minSegment) {
+        state.cursor = {minSegment, 0};
+    }
+
+    // Segments left behind by a crash between cursor update and compaction
+    for (uint32_t segment = minSegment; found && segment < state.cursor.segment; segment++) {
+        segmentPath(path, sizeof(path), segment);
+        remove(path);
+    }
+
+    state.headSegment = found && maxSegment > state.cursor.segment ? maxSegment : state.cursor.segment;
+
+    // A torn write leaves a partial record at the end of the head segment;
+    // keep its valid prefix and continue appending in a fresh segment
+    segmentPath(path, sizeof(path), state.headSegment);
+    file = fopen(path, "rb");
+    if (file != nullptr) {
+        SpillRecord record;
+        uint16_t valid = 0;
+        while (valid < SPILL_SEGMENT_RECORDS && readRecord(file, record)) {
+            valid++;
+            if (record.sequence >= state.nextSequence) state.nextSequence = record.sequence + 1;
+        }
+
+        fseek(file, 0, SEEK_END);
+        const long size = ftell(file);
+        fclose(file);
+
+        if (size != static_cast<long>(valid * sizeof(SpillRecord))) {
+            LOG_WARN(STORAGE, "Spill log: segment %lu damaged after %d records",
+                     static_cast<unsigned long>(state.headSegment), valid);
+            state.headSegment++;
+            valid = 0;
+        }
+        state.headRecords = valid;
+    }
+
+    spillLogState = state;
+
+    // Segments before the head can be short, a torn or failed write moved
+    // appending on early, so records are counted rather than assumed
+    int pending = 0;
+    for (uint32_t segment = state.cursor.segment; segment <= state.headSegment; segment++) {
+        int records;
+        pending += countSegmentReadings(segment, segment == state.cursor.segment ? state.cursor.record : 0, records);
+        spillLogState.pendingRecords += records;
+    }
+    spillLogState.pendingReadings = pending;
+
+    LOG_INFO(STORAGE, "Spill log recovered: segments %lu-%lu, %d pending readings",
+             static_cast<unsigned long>(state.cursor.segment),
+             static_cast<unsigned long>(state.headSegment), pending);
+}
+
+bool spillLogBegin(bool trustCachedState, const char* directory) {
+    logDirectory = directory;
+
+    if (!SPILL_LOG_ENABLED) return false;
+    if (trustCachedState && spillLogState.magic == SPILL_LOG_MAGIC) return true;
+
+    // Only cold boots and crash resets touch the flash here
+    if (!ensureMounted()) return false;
+    recoverState();
+    return true;
+}
+
+bool spillLogAppend(const ReadingBlock& block) {
+    if (spillLogState.magic != SPILL_LOG_MAGIC || !ensureMounted()) return false;
+
+    if (spillLogState.headRecords >= SPILL_SEGMENT_RECORDS) {
+        if (!spillLogFlush()) return false;
+        spillLogState.headSegment++;
+        spillLogState.headRecords = 0;
+        enforceSegmentLimit();
+    }
+
+    if (appendFile == nullptr) {
+        char path[64];
+        segmentPath(path, sizeof(path), spillLogState.headSegment);
+        appendFile = fopen(path, "ab");
+        if (appendFile == nullptr) return false;
+    }
+
+    SpillRecord record;
+    record.magic = SPILL_RECORD_MAGIC;
+    record.sequence = spillLogState.nextSequence;
+    record.bitsUsed = block.bitsUsed;
+    record.count = block.count;
+    record.skip = block.skip;
+    record.reserved = 0;
+    memcpy(record.data, block.data, sizeof(record.data));
+    record.crc = crc32(&record, offsetof(SpillRecord, crc));
+
+    if (fwrite(&record, sizeof(record), 1, appendFile) != 1) {
+        // Record offsets are fixed, so never append behind a partial write
+        fclose(appendFile);
+        appendFile = nullptr;
+        spillLogState.headSegment++;
+        spillLogState.headRecords = 0;
+        return false;
+    }
+
+    spillLogState.headRecords++;
+    spillLogState.nextSequence++;
+    spillLogState.pendingReadings += block.count - block.skip;
+    spillLogState.pendingRecords++;
+    return true;
+}
+
+bool spillLogFlush() {
+    if (appendFile == nullptr) return true;
+
+    const bool ok = syncAndClose(appendFile);
+    appendFile = nullptr;
+    return ok;
+}
+
+int spillLogPendingRecords() {
+    return spillLogState.magic == SPILL_LOG_MAGIC ? spillLogState.pendingRecords : 0;
+}
+
+int spillLogPendingReadings() {
+    return spillLogState.magic == SPILL_LOG_MAGIC ? spillLogState.pendingReadings : 0;
+}
+
+bool spillLogCommit(const SpillLogPosition& position, int readingsConsumed) {
+    if (spillLogState.magic != SPILL_LOG_MAGIC || !ensureMounted()) return false;
+
+    SpillLogPosition cursor = position;
+    if (cursor.record >= SPILL_SEGMENT_RECORDS && cursor.segment < spillLogState.headSegment) {
+        cursor = {cursor.segment + 1, 0};
+    }
+
+    // Whole segments passed over may be short, their records are counted
+    // from flash before they are deleted
+    const SpillLogPosition from = spillLogState.cursor;
+    int recordsConsumed = 0;
+    if (cursor.segment == from.segment) {
+        recordsConsumed = cursor.record > from.record ? cursor.record - from.record : 0;
+    } else {
+        for (uint32_t segment = from.segment; segment < cursor.segment; segment++) {
+            int records;
+            countSegmentReadings(segment, segment == from.segment ? from.record : 0, records);
+            recordsConsumed += records;
+        }
+        recordsConsumed += cursor.record;
+    }
+
+    const uint32_t firstSegment = from.segment;
+    spillLogState.cursor = cursor;
+    spillLogState.pendingReadings -= readingsConsumed;
+    spillLogState.pendingRecords -= recordsConsumed;
+    if (spillLogState.pendingReadings < 0) spillLogState.pendingReadings = 0;
+    if (spillLogState.pendingRecords < 0) spillLogState.pendingRecords = 0;
+    // A drained log has nothing pending, even records damaged after their append
+    if (cursor.segment == spillLogState.headSegment && cursor.record >= spillLogState.headRecords) {
+        spillLogState.pendingRecords = 0;
+    }
+
+    // Cursor goes to flash before the segments it points past are deleted
+    if (!persistCursor()) return false;
+
+    for (uint32_t segment = firstSegment; segment < cursor.segment; segment++) {
+        char path[64];
+        segmentPath(path, sizeof(path), segment);
+        remove(path);
+    }
+    return true;
+}
+
+SpillLogReader::SpillLogReader()
+    : file(nullptr), pos(spillLogState.cursor), readings(0) {
+    spillLogFlush();
+}
+
+SpillLogReader::~SpillLogReader() {
+    if (file != nullptr) fclose(file);
+}
+
+bool SpillLogReader::next(ReadingBlock& block) {
+    if (spillLogState.magic != SPILL_LOG_MAGIC || !ensureMounted()) return false;
+
+    while (pos.segment < spillLogState.headSegment ||
+           (pos.segment == spillLogState.headSegment && pos.record < spillLogState.headRecords)) {
+        if (file == nullptr) {
+            char path[64];
+            segmentPath(path, sizeof(path), pos.segment);
+            file = fopen(path, "rb");
+            if (file != nullptr && fseek(file, static_cast<long>(pos.record) * sizeof(SpillRecord), SEEK_SET) != 0) {
+                fclose(file);
+                file = nullptr;
+            }
+        }
+
+        SpillRecord record;
+        if (file != nullptr && readRecord(file, record)) {
+            block.bitsUsed = record.bitsUsed;
+            block.count = record.count;
+            block.skip = record.skip;
+            memcpy(block.data, record.data, sizeof(block.data));
+            pos.record++;
+            readings += record.count - record.skip;
+            return true;
+        }
+
+        // Missing segment or a damaged record ends this segment
+        if (file != nullptr) {
+            fclose(file);
+            file = nullptr;
+        }
+        if (pos.segment == spillLogState.headSegment) {
+            pos.record = spillLogState.headRecords;
+            break;
+        }
+        pos = {pos.segment + 1, 0};
+    }
+    return false;
+}
@@ -1,27 +1,28 @@
 #include "system_utils.hpp"
 #include <WiFi.h>
 #include "config.hpp"
+#include "wake_profiler.hpp"
+#include "wake_deadline.hpp"
+#include "logging.hpp"
 
 void goToSleep() {
-    Serial.println("Going to sleep for " + String(SLEEP_TIME / 1000000) + " seconds");
-    Serial.printf("Last known time before sleep: %ld\n", timeState.lastKnownTime);
+    // A task still writing storage finishes first, later writes wait for the next wake
+    claimSleep();
+
+    const uint64_t sleepUs = scheduleNextWake();
+    LOG_INFO(SYSTEM, "Going to sleep for %lu ms", static_cast<unsigned long>(sleepUs / 1000));
+    LOG_DEBUG(SYSTEM, "Last known time before sleep: %ld", timeState.lastKnownTime);
+    logFlush();
     Serial.flush();
     
     WiFi.disconnect(true);
     WiFi.mode(WIFI_OFF);
-    esp_sleep_enable_timer_wakeup(SLEEP_TIME);
-    esp_deep_sleep_start();
+    enterDeepSleep(sleepUs);
 }
 
-void enterErrorState() {
-    const int LED_PIN = 2;  // Built-in LED pin for ESP32
-    pinMode(LED_PIN, OUTPUT);
-    
-    Serial.println("Entering error state - Please reset device");
-    while(true) {
-        digitalWrite(LED_PIN, HIGH);
-        delay(500);
-        digitalWrite(LED_PIN, LOW);
-        delay(500);
-    }
+void enterDeepSleep(uint64_t sleepUs) {
+    profilerFinishWake();
+    recordTimeBeforeSleep();
+    esp_sleep_enable_timer_wakeup(sleepUs);
+    esp_deep_sleep_start();
 }
\ No newline at end of file
@@ -1,74 +1,160 @@
 #include "time_manager.hpp"
 #include "config.hpp"
+#include "cadence.hpp"
 #include "network.hpp"
+#include "wake_deadline.hpp"
+#include "wake_profiler.hpp"
+#include "wake_schedule.hpp"
 #include <Arduino.h>
 #include <WiFi.h>
+#include <sys/time.h>
+#include "esp_sntp.h"
+#include "esp_timer.h"
+#include "logging.hpp"
 
 // Initialize the RTC time state
 RTC_DATA_ATTR TimeState timeState = {
     .lastKnownTime = 0,
     .lastSuccessfulSync = 0,
     .isNight = false,
-    .wakeCyclesPerNight = 0,
-    .nightWakeCyclesCounter = 0,
-    .timeInitialized = false
+    .timeInitialized = false,
+    .sleepStartUs = 0,
+    .driftPpm = 0,
+    .driftErrorPpm = 0,
+    .driftSamples = 0,
+    .uncertaintyUs = 0,
+    .sleptSinceLearnUs = 0,
+    .errorSinceLearnUs = 0,
+    .scheduledWakeUs = 0,
+    .bootLatencyUs = SCHEDULE_BOOT_LATENCY_MS * 1000
 };
 
-bool isStateValid() {
-    if (!timeState.timeInitialized) return false;
-    
-    time_t now;
-    time(&now);
-    
-    const bool validSync = (now - timeState.lastSuccessfulSync) < MAX_TIME_WITHOUT_SYNC;
-    const bool validCycles = timeState.wakeCyclesPerNight > 0 && 
-                            timeState.nightWakeCyclesCounter <= timeState.wakeCyclesPerNight;
-    
-    return validSync && validCycles;
+// Filled in by the SNTP task when an answer arrives
+static volatile bool ntpAnswered = false;
+static int64_t ntpTimeUs = 0;
+static int64_t ntpAnsweredAtUs = 0;
+
+static int64_t clockNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+static void setClockUs(int64_t us) {
+    struct timeval tv;
+    tv.tv_sec = us / 1000000;
+    tv.tv_usec = us % 1000000;
+    settimeofday(&tv, NULL);
+}
+
+// Bound on how far the drift estimate may be off
+static float driftBoundPpm() {
+    if (timeState.driftSamples == 0) return TIME_DRIFT_UNKNOWN_PPM;
+    return timeState.driftErrorPpm + TIME_DRIFT_MARGIN_PPM;
+}
+
+static void onNtpSync(struct timeval* tv) {
+    ntpTimeUs = static_cast<int64_t>(tv->tv_sec) * 1000000 + tv->tv_usec;
+    ntpAnsweredAtUs = esp_timer_get_time();
+    ntpAnswered = true;
+}
+
+// Folds the clock step of a sync into the drift estimate. Steps are summed
+// until enough sleep has passed for the NTP error to be small against them.
+static void learnDrift(int64_t stepUs) {
+    timeState.errorSinceLearnUs += stepUs;
+    if (timeState.sleptSinceLearnUs < TIME_DRIFT_MIN_LEARN_S * 1000000ULL) return;
+
+    // The clock was already corrected by driftPpm, so the step is what the estimate missed
+    const float residualPpm = static_cast<float>(
+        static_cast<double>(timeState.errorSinceLearnUs) * 1e6 / timeState.sleptSinceLearnUs);
+    const float gain = timeState.driftSamples == 0 ? 1.0f : TIME_DRIFT_GAIN;
+    timeState.driftPpm += gain * residualPpm;
+    // Recent misses set the bound, so a drift that wanders with temperature widens it
+    timeState.driftErrorPpm = fmaxf(fabsf(residualPpm), timeState.driftErrorPpm * 0.5f);
+    if (timeState.driftSamples < UINT8_MAX) timeState.driftSamples++;
+
+    LOG_INFO(TIME, "RTC drift %.1f ppm (last error %.1f ppm over %lu s)", timeState.driftPpm, residualPpm,
+             static_cast<unsigned long>(timeState.sleptSinceLearnUs / 1000000));
+    timeState.sleptSinceLearnUs = 0;
+    timeState.errorSinceLearnUs = 0;
+}
+
+// Starts an SNTP request and waits for the answer. The step it applies to
+// the clock is measured against esp_timer, which the SNTP task does not touch.
+static bool syncWithNtp(uint32_t timeoutMs) {
+    const int64_t requestedAtUs = esp_timer_get_time();
+    const int64_t clockAtRequestUs = clockNowUs();
+
+    ntpAnswered = false;
+    sntp_set_time_sync_notification_cb(onNtpSync);
+    configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
+
+    while (!ntpAnswered && esp_timer_get_time() - requestedAtUs < timeoutMs * 1000LL) {
+        delay(10);
+    }
+    if (!ntpAnswered) {
+        LOG_WARN(TIME, "No NTP answer within %lu ms", static_cast<unsigned long>(timeoutMs));
+        return false;
+    }
+
+    SleepGuard guard;
+    const int64_t waitedUs = ntpAnsweredAtUs - requestedAtUs;
+    const int64_t stepUs = ntpTimeUs - (clockAtRequestUs + waitedUs);
+    if (timeState.timeInitialized && timeState.uncertaintyUs != UINT32_MAX) {
+        learnDrift(stepUs);
+    } else {
+        // A clock that lost count steps by whatever it lost, not by drift; learning starts over
+        timeState.sleptSinceLearnUs = 0;
+        timeState.errorSinceLearnUs = 0;
+    }
+
+    time(&timeState.lastKnownTime);
+    timeState.lastSuccessfulSync = timeState.lastKnownTime;
+    // The answer is at most the whole exchange old
+    timeState.uncertaintyUs = static_cast<uint32_t>(waitedUs);
+
+    LOG_INFO(TIME, "Time synced, clock was off by %ld ms", static_cast<long>(stepUs / 1000));
+    return true;
+}
+
+bool isTimeSyncDue() {
+    return !timeState.timeInitialized || timeState.uncertaintyUs > TIME_SYNC_TOLERANCE_MS * 1000;
 }
 
-void calculateNightCycles() {
-    const int nightDurationSeconds = NIGHT_DURATION * 3600;
-    const int sleepDurationSeconds = SLEEP_TIME / 1000000;
-    timeState.wakeCyclesPerNight = nightDurationSeconds / sleepDurationSeconds;
-    timeState.nightWakeCyclesCounter = 0;
+bool isStateValid() {
+    if (!timeState.timeInitialized) return false;
     
-    Serial.printf("Wake cycles per night: %d\n", timeState.wakeCyclesPerNight);
+    return timeState.uncertaintyUs <= TIME_MAX_UNCERTAINTY_MS * 1000;
 }
 
 bool initializeTime() {
-    Serial.println("Initializing time...");
+    PROFILE_PHASE(TIME_SYNC);
+    PhaseBudget budget(WakePhase::TIME_SYNC);
+    LOG_INFO(TIME, "Initializing time...");
+    
+    // Whatever the clock says now is not a measure of drift
+    const bool wasInitialized = timeState.timeInitialized;
+    timeState.timeInitialized = false;
     
     // Try to connect to WiFi and sync time
     int retries = 0;
     const int maxRetries = 5;
     
-    while (retries < maxRetries) {
-        if (connectToWiFi()) {
-            configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
-            
-            // Wait for time sync
-            int syncAttempts = 0;
-            while (!getLocalTime(&timeinfo) && syncAttempts < 10) {
-                Serial.println("Waiting for time sync...");
-                delay(500);
-                syncAttempts++;
-            }
-            
-            if (getLocalTime(&timeinfo)) {
-                time(&timeState.lastKnownTime);
-                timeState.lastSuccessfulSync = timeState.lastKnownTime;
-                timeState.timeInitialized = true;
-                timeState.nightWakeCyclesCounter = 0;
+    while (retries < maxRetries && !budget.expired()) {
+        if (WiFi.isConnected() || connectToWiFi()) {
+            if (syncWithNtp(budget.limit(TIME_SYNC_TIMEOUT_MS)) && getLocalTime(&timeinfo)) {
+                {
+                    SleepGuard guard;
+                    timeState.timeInitialized = true;
+                    timeState.sleepStartUs = 0;
+                    timeState.sleptSinceLearnUs = 0;
+                    timeState.errorSinceLearnUs = 0;
+                    timeState.scheduledWakeUs = 0;
+                }
                 
-                // Calculate night cycles on first boot
-                calculateNightCycles();
-                
-                // Check if we're starting during night time (shouldn't happen normally)
-                timeState.isNight = isNightTime();
-                
-                Serial.printf("Time initialized: %02d:%02d:%02d\n", 
-                            timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+                LOG_INFO(TIME, "Time initialized: %02d:%02d:%02d", 
+                         timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
                 
                 WiFi.disconnect(true);
                 WiFi.mode(WIFI_OFF);
@@ -77,84 +163,92 @@ bool initializeTime() {
         }
         
         retries++;
-        Serial.printf("Time sync attempt %d failed\n", retries);
-        delay(1000);
+        LOG_WARN(TIME, "Time sync attempt %d failed", retries);
+        delay(budget.limit(1000));
     }
     
-    // If we get here, initialization failed
-    Serial.println("Time initialization failed!");
+    // If we get here, initialization failed; an earlier setting still stands
+    LOG_ERROR(TIME, "Time initialization failed!");
+    timeState.timeInitialized = wasInitialized;
+    recordPhaseFailure(WakePhase::TIME_SYNC);
     return false;
 }
 
+void recordTimeBeforeSleep() {
+    timeState.sleepStartUs = clockNowUs();
+}
+
 void updateTimeAfterSleep() {
-    if (timeState.lastKnownTime > 0) {
-        // Add sleep duration to last known time
-        timeState.lastKnownTime += (SLEEP_TIME / 1000000);
-        
-        // Create a timezone-adjusted time
-        struct timeval tv;
-        tv.tv_sec = timeState.lastKnownTime;
-        tv.tv_usec = 0;
-        
-        // Set system time
-        settimeofday(&tv, NULL);
+    if (timeState.timeInitialized) {
+        SleepGuard guard;
+        int64_t nowUs = clockNowUs();
+
+        if (timeState.sleepStartUs > 0) {
+            const int64_t sleptUs = nowUs - timeState.sleepStartUs;
+            if (sleptUs < 0) {
+                // The RTC lost count, only NTP can tell the time now
+                LOG_WARN(TIME, "Clock went back %ld ms during sleep", static_cast<long>(-sleptUs / 1000));
+                timeState.uncertaintyUs = UINT32_MAX;
+                timeState.sleptSinceLearnUs = 0;
+                timeState.errorSinceLearnUs = 0;
+            } else {
+                // Awake time runs on the crystal; the slept span is corrected by the learned drift
+                nowUs += static_cast<int64_t>(sleptUs * (timeState.driftPpm * 1e-6));
+                setClockUs(nowUs);
+
+                const uint64_t growthUs = static_cast<uint64_t>(sleptUs * (driftBoundPpm() * 1e-6)) + 1;
+                timeState.uncertaintyUs = timeState.uncertaintyUs + growthUs < UINT32_MAX
+                                              ? timeState.uncertaintyUs + growthUs : UINT32_MAX;
+                timeState.sleptSinceLearnUs += sleptUs;
+
+                // Late or early against the slot moves the boot allowance by a quarter of the miss
+                const int64_t missUs = nowUs - timeState.scheduledWakeUs;
+                if (timeState.scheduledWakeUs > 0 && missUs > -1000000 && missUs < 1000000) {
+                    const int64_t latencyUs = timeState.bootLatencyUs + missUs / 4;
+                    timeState.bootLatencyUs = latencyUs > 0 ? static_cast<uint32_t>(latencyUs) : 0;
+                }
+            }
+            timeState.sleepStartUs = 0;
+        }
+        timeState.scheduledWakeUs = 0;
+
+        // Nearest second, so a wake a few ms before its slot is stamped with the slot
+        timeState.lastKnownTime = (nowUs + 500000) / 1000000;
         
         // Reinitialize timezone information
         configTime(gmtOffset_sec, daylightOffset_sec, nullptr);
-        
-        if (timeState.isNight) {
-            timeState.nightWakeCyclesCounter++;
-            Serial.printf("Night cycle %d of %d\n", 
-                        timeState.nightWakeCyclesCounter, 
-                        timeState.wakeCyclesPerNight);
-        }
     }
 }
 
-bool isNightTime() {
-    if (!getLocalTime(&timeinfo)) {
-        Serial.println("Failed to obtain time");
-        return timeState.isNight;
+uint64_t scheduleNextWake() {
+    if (!timeState.timeInitialized) {
+        timeState.scheduledWakeUs = 0;
+        return SLEEP_TIME;
     }
-    Serial.printf("Timeinfo: %s\n", asctime(&timeinfo));
-    const int currentHour = timeinfo.tm_hour;
-    Serial.printf("Current hour: %d\n", currentHour);
-    const bool isLateNight = (currentHour >= NIGHT_START_HOUR);
-    Serial.printf("Is late night: %d\n", isLateNight);
-    const bool isEarlyMorning = (currentHour < NIGHT_END_HOUR);
-    Serial.printf("Is early morning: %d\n", isEarlyMorning);
-    const bool isNight = isLateNight || isEarlyMorning;
-    Serial.printf("Is night: %d\n", isNight);
-    
-    // Update night state transitions
-    if (isNight && !timeState.isNight) {
-        timeState.isNight = true;
-        timeState.nightWakeCyclesCounter = 0;
-        calculateNightCycles();
-    } else if (!isNight && timeState.isNight) {
-        timeState.isNight = false;
-        timeState.nightWakeCyclesCounter = 0;
-    }
-    
-    return isNight;
+
+    const int64_t nowUs = clockNowUs();
+    const int64_t earliestUs = nowUs + timeState.bootLatencyUs + SCHEDULE_MIN_SLEEP_MS * 1000LL;
+    const ScheduleSlot slot = querySchedule(earliestUs / 1000000, cadenceStride());
+    timeState.scheduledWakeUs = static_cast<int64_t>(slot.nextWake) * 1000000;
+
+    // The RTC timer counts in its own, drifting microseconds
+    const int64_t remainingUs = timeState.scheduledWakeUs - timeState.bootLatencyUs - nowUs;
+    return static_cast<uint64_t>(remainingUs / (1.0 + timeState.driftPpm * 1e-6));
 }
 
 void handleTimeSync() {
-    configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
-    
-    int attempts = 0;
-    while (!getLocalTime(&timeinfo) && attempts < 5) {
-        Serial.println("Waiting for time sync...");
-        delay(500);
-        attempts++;
+    if (!isTimeSyncDue()) {
+        LOG_DEBUG(TIME, "Time sync skipped, clock within %lu ms",
+                  static_cast<unsigned long>(timeState.uncertaintyUs / 1000));
+        return;
     }
-    
-    if (getLocalTime(&timeinfo)) {
-        time(&timeState.lastKnownTime);
-        timeState.lastSuccessfulSync = timeState.lastKnownTime;
-        Serial.printf("Time synced: %02d:%02d:%02d\n", 
-                    timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
-        
-        timeState.nightWakeCyclesCounter = 0;
+
+    PROFILE_PHASE(TIME_SYNC);
+    PhaseBudget budget(WakePhase::TIME_SYNC);
+    if (syncWithNtp(budget.limit(TIME_SYNC_TIMEOUT_MS)) && getLocalTime(&timeinfo)) {
+        LOG_INFO(TIME, "Time synced: %02d:%02d:%02d", 
+                 timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+    } else {
+        recordPhaseFailure(WakePhase::TIME_SYNC);
     }
 }
\ No newline at end of file
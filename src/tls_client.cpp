@@ -0,0 +1,252 @@
+#include "tls_client.hpp"
+#include "checksum.hpp"
+#include "mbedtls/net_sockets.h"
+#include <stddef.h>
+#include <string.h>
+#include "logging.hpp"
+
+RTC_DATA_ATTR TlsSessionCache tlsSessionCache = {0, 0, {0}, 0};
+
+static bool isCacheValid(uint32_t hostHash) {
+    return tlsSessionCache.length > 0 &&
+           tlsSessionCache.length <= sizeof(tlsSessionCache.data) &&
+           tlsSessionCache.hostHash == hostHash &&
+           tlsSessionCache.crc == crc32(&tlsSessionCache, offsetof(TlsSessionCache, crc));
+}
+
+static void clearCache() {
+    tlsSessionCache.length = 0;
+}
+
+static uint32_t hashHost(const char* host) {
+    return crc32(host, strlen(host));
+}
+
+TlsClient::TlsClient()
+    : initialized(false), open(false), peeked(-1), handshakeTime(0), sessionOffered(false) {}
+
+TlsClient::~TlsClient() {
+    stop();
+}
+
+int TlsClient::sendCallback(void* context, const unsigned char* data, size_t size) {
+    WiFiClient* tcp = static_cast<WiFiClient*>(context);
+    if (!tcp->connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+
+    const size_t written = tcp->write(data, size);
+    return written > 0 ? static_cast<int>(written) : MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+int TlsClient::receiveCallback(void* context, unsigned char* buffer, size_t size) {
+    WiFiClient* tcp = static_cast<WiFiClient*>(context);
+    if (!tcp->available()) {
+        return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+    }
+
+    const int received = tcp->read(buffer, size);
+    return received > 0 ? received : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+bool TlsClient::setup(const char* host) {
+    mbedtls_ssl_init(&ssl);
+    mbedtls_ssl_config_init(&config);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_entropy_init(&entropy);
+    initialized = true;
+
+    static const char personalization[] = "bme680_logger";
+    if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+                              reinterpret_cast<const unsigned char*>(personalization),
+                              sizeof(personalization) - 1) != 0 ||
+        mbedtls_ssl_config_defaults(&config, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+        return false;
+    }
+
+    mbedtls_ssl_conf_authmode(&config, MBEDTLS_SSL_VERIFY_NONE);
+    mbedtls_ssl_conf_rng(&config, mbedtls_ctr_drbg_random, &drbg);
+#ifdef MBEDTLS_SSL_SESSION_TICKETS
+    mbedtls_ssl_conf_session_tickets(&config, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    if (mbedtls_ssl_setup(&ssl, &config) != 0 || mbedtls_ssl_set_hostname(&ssl, host) != 0) {
+        return false;
+    }
+    mbedtls_ssl_set_bio(&ssl, &tcp, sendCallback, receiveCallback, nullptr);
+
+    // Offer the session from the previous wake; the server may still refuse it,
+    // in which case mbedtls falls back to a full handshake on its own
+    sessionOffered = false;
+    if (isCacheValid(hashHost(host))) {
+        mbedtls_ssl_session session;
+        mbedtls_ssl_session_init(&session);
+        if (mbedtls_ssl_session_load(&session, tlsSessionCache.data, tlsSessionCache.length) == 0 &&
+            mbedtls_ssl_set_session(&ssl, &session) == 0) {
+            sessionOffered = true;
+        }
+        mbedtls_ssl_session_free(&session);
+    }
+    return true;
+}
+
+bool TlsClient::handshake() {
+    const unsigned long start = millis();
+    int result;
+
+    while ((result = mbedtls_ssl_handshake(&ssl)) != 0) {
+        if (result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            LOG_WARN(NETWORK, "TLS handshake failed: -0x%04x", static_cast<unsigned>(-result));
+            return false;
+        }
+        if (millis() - start > TLS_HANDSHAKE_TIMEOUT_MS) {
+            LOG_WARN(NETWORK, "TLS handshake timed out");
+            return false;
+        }
+        delay(1);
+    }
+
+    handshakeTime = millis() - start;
+    return true;
+}
+
+void TlsClient::saveSession(const char* host) {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+
+    size_t length = 0;
+    if (mbedtls_ssl_get_session(&ssl, &session) == 0 &&
+        mbedtls_ssl_session_save(&session, tlsSessionCache.data, sizeof(tlsSessionCache.data), &length) == 0) {
+        tlsSessionCache.hostHash = hashHost(host);
+        tlsSessionCache.length = length;
+        tlsSessionCache.crc = crc32(&tlsSessionCache, offsetof(TlsSessionCache, crc));
+    } else {
+        LOG_WARN(NETWORK, "TLS session too large to cache, next wake does a full handshake");
+        clearCache();
+    }
+
+    mbedtls_ssl_session_free(&session);
+}
+
+void TlsClient::release() {
+    if (!initialized) return;
+
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_config_free(&config);
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_entropy_free(&entropy);
+    initialized = false;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+    stop();
+
+    if (!tcp.connect(host, port)) return 0;
+    tcp.setNoDelay(true);
+
+    if (!setup(host) || !handshake()) {
+        // A stale cached session must not break every following wake
+        if (sessionOffered) clearCache();
+        tcp.stop();
+        release();
+        return 0;
+    }
+
+    saveSession(host);
+    open = true;
+    return 1;
+}
+
+size_t TlsClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t TlsClient::write(const uint8_t* data, size_t size) {
+    if (!open) return 0;
+
+    size_t written = 0;
+    unsigned long progress = millis();
+    while (written < size) {
+        const int result = mbedtls_ssl_write(&ssl, data + written, size - written);
+        if (result > 0) {
+            written += result;
+            progress = millis();
+        } else if (result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            open = false;
+            break;
+        } else if (millis() - progress > TLS_WRITE_STALL_TIMEOUT_MS) {
+            // A full send buffer that never drains; a short count tells the caller
+            LOG_WARN(NETWORK, "TLS write stalled for %lu ms", TLS_WRITE_STALL_TIMEOUT_MS);
+            open = false;
+            break;
+        } else {
+            delay(1);
+        }
+    }
+    return written;
+}
+
+int TlsClient::available() {
+    if (!open) return 0;
+
+    int buffered = static_cast<int>(mbedtls_ssl_get_bytes_avail(&ssl)) + (peeked >= 0 ? 1 : 0);
+    if (buffered == 0 && tcp.available()) {
+        // Decrypting needs a whole record, pull one in through a single byte read
+        unsigned char c;
+        const int result = mbedtls_ssl_read(&ssl, &c, 1);
+        if (result == 1) {
+            peeked = c;
+            buffered = 1 + static_cast<int>(mbedtls_ssl_get_bytes_avail(&ssl));
+        } else if (result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            open = false;  // Close notify or a broken connection
+        }
+    }
+    return buffered;
+}
+
+int TlsClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int TlsClient::read(uint8_t* buffer, size_t size) {
+    if (size == 0 || available() == 0) return 0;
+
+    size_t count = 0;
+    if (peeked >= 0) {
+        buffer[count++] = static_cast<uint8_t>(peeked);
+        peeked = -1;
+    }
+
+    if (count < size && mbedtls_ssl_get_bytes_avail(&ssl) > 0) {
+        const int result = mbedtls_ssl_read(&ssl, buffer + count, size - count);
+        if (result > 0) count += result;
+    }
+    return static_cast<int>(count);
+}
+
+int TlsClient::peek() {
+    if (peeked < 0 && available() > 0) {
+        // available() only reads ahead when nothing was decrypted yet
+        unsigned char c;
+        if (peeked < 0 && mbedtls_ssl_read(&ssl, &c, 1) == 1) peeked = c;
+    }
+    return peeked;
+}
+
+void TlsClient::stop() {
+    if (open) mbedtls_ssl_close_notify(&ssl);
+    open = false;
+    peeked = -1;
+    tcp.stop();
+    release();
+}
+
+uint8_t TlsClient::connected() {
+    if (!open) return 0;
+    // Decrypted bytes can still be read after the peer closed the socket
+    return tcp.connected() || peeked >= 0 || mbedtls_ssl_get_bytes_avail(&ssl) > 0;
+}
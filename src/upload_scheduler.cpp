@@ -0,0 +1,77 @@
+#include "upload_scheduler.hpp"
+
+// Below this signal level every dB costs extra airtime through lower
+// rates and retransmissions
+static const int GOOD_RSSI = -67;
+static const float AIRTIME_PER_WEAK_DB = 0.05f;
+
+UploadDecision FixedRuleScheduler::decide(const UploadInputs& inputs) const {
+    if (inputs.storageFill >= UPLOAD_FILL_THRESHOLD) {
+        return {true, 0.0f, "buffer nearly full"};
+    }
+    if (!inputs.isNight && inputs.pendingReadings > 0) {
+        return {true, 0.0f, "daytime with pending readings"};
+    }
+    return {false, 0.0f, inputs.pendingReadings > 0 ? "night" : "nothing pending"};
+}
+
+CostModelScheduler::CostModelScheduler()
+    : params{UPLOAD_MAX_LATENCY_SECONDS, UPLOAD_FILL_THRESHOLD, UPLOAD_TARGET_READINGS_PER_SECOND,
+             UPLOAD_DEFAULT_CONNECT_MS, UPLOAD_MS_PER_READING, UPLOAD_LOW_BATTERY_PERCENT,
+             UPLOAD_LOW_BATTERY_LATENCY_FACTOR} {}
+
+CostModelScheduler::CostModelScheduler(const Parameters& parameters)
+    : params(parameters) {}
+
+float CostModelScheduler::estimateRadioMs(const UploadInputs& inputs) const {
+    float connectMs = inputs.expectedConnectMs > 0 ? inputs.expectedConnectMs : params.defaultConnectMs;
+    float transferMs = params.msPerReading * inputs.pendingReadings;
+
+    if (inputs.lastRssi != 0 && inputs.lastRssi < GOOD_RSSI) {
+        const float factor = 1.0f + (GOOD_RSSI - inputs.lastRssi) * AIRTIME_PER_WEAK_DB;
+        connectMs *= factor;
+        transferMs *= factor;
+    }
+    return connectMs + transferMs;
+}
+
+UploadDecision CostModelScheduler::decide(const UploadInputs& inputs) const {
+    if (inputs.pendingReadings <= 0) {
+        return {false, 0.0f, "nothing pending"};
+    }
+
+    const float efficiency = inputs.pendingReadings * 1000.0f / estimateRadioMs(inputs);
+    const bool batteryKnown = inputs.batteryPercent >= 0.0f;
+
+    if (inputs.storageFill >= params.fillThreshold) {
+        return {true, efficiency, "buffer nearly full"};
+    }
+
+    // Upload on the last wake that still meets the latency bound
+    uint32_t latencyBound = params.maxLatencySeconds;
+    if (batteryKnown && inputs.batteryPercent < params.lowBatteryPercent) {
+        latencyBound *= params.lowBatteryLatencyFactor;
+    }
+    if (inputs.oldestAgeSeconds + inputs.wakeIntervalSeconds > latencyBound) {
+        return {true, efficiency, "latency bound reached"};
+    }
+
+    // The emptier the battery, the more readings each radio second has to carry
+    float target = params.targetReadingsPerSecond;
+    if (batteryKnown) {
+        const float charge = inputs.batteryPercent / 100.0f;
+        target /= charge > 0.25f ? charge : 0.25f;
+    }
+    if (efficiency >= target) {
+        return {true, efficiency, "enough readings to amortise the connection"};
+    }
+    return {false, efficiency, "deferring"};
+}
+
+const UploadScheduler& getUploadScheduler() {
+    static const FixedRuleScheduler fixedRule;
+    static const CostModelScheduler costModel;
+
+    if (UPLOAD_SCHEDULER == UploadSchedulerType::FIXED_RULE) return fixedRule;
+    return costModel;
+}
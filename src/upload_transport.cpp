@@ -0,0 +1,62 @@
+#include "upload_transport.hpp"
+#include <string.h>
+#include "logging.hpp"
+
+UploadTransport::UploadTransport()
+    : active(nullptr), port(0), connections(0), requests(0), sessionsOffered(0),
+      setupMillis(0), handshakeMillis(0) {
+    host[0] = '\0';
+}
+
+bool UploadTransport::isOpenFor(const ParsedUrl& url) {
+    const Client* expected = url.secure ? static_cast<Client*>(&secureClient) : &plainClient;
+    return active == expected && active->connected() &&
+           port == url.port && strcmp(host, url.host) == 0;
+}
+
+Client* UploadTransport::connect(const ParsedUrl& url, bool& reused) {
+    requests++;
+
+    reused = isOpenFor(url);
+    if (reused) return active;
+    stop();
+
+    const unsigned long start = millis();
+    Client* client = url.secure ? static_cast<Client*>(&secureClient) : &plainClient;
+    if (!client->connect(url.host, url.port)) {
+        LOG_WARN(NETWORK, "Failed to connect to %s:%u", url.host, url.port);
+        return nullptr;
+    }
+
+    setupMillis += millis() - start;
+    connections++;
+    if (url.secure) {
+        handshakeMillis += secureClient.handshakeMillis();
+        if (secureClient.offeredSession()) sessionsOffered++;
+    }
+
+    active = client;
+    strcpy(host, url.host);
+    port = url.port;
+    return active;
+}
+
+void UploadTransport::release(bool keepAlive) {
+    if (!keepAlive) stop();
+}
+
+void UploadTransport::stop() {
+    if (active != nullptr) active->stop();
+    active = nullptr;
+}
+
+void UploadTransport::report() const {
+    if (requests == 0) return;
+
+    LOG_INFO(NETWORK, "Transport: %d requests over %d connections, setup %lu ms",
+             requests, connections, setupMillis);
+    if (handshakeMillis > 0 || sessionsOffered > 0) {
+        LOG_INFO(NETWORK, "Transport: TLS handshake %lu ms, %d with a cached session",
+                 handshakeMillis, sessionsOffered);
+    }
+}
@@ -0,0 +1,141 @@
+#include "wake_deadline.hpp"
+#include <atomic>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config.hpp"
+#include "system_utils.hpp"
+#include "logging.hpp"
+
+static_assert(sizeof(WAKE_PHASE_BUDGET_MS) / sizeof(WAKE_PHASE_BUDGET_MS[0]) == WAKE_PHASE_COUNT,
+              "WAKE_PHASE_BUDGET_MS needs one entry per wake phase");
+static_assert(WAKE_PHASE_COUNT <= 16, "deadlinePhases holds at most 16 phases");
+static_assert(WAKE_SLEEP_RESERVE_MS < WAKE_DEADLINE_MS, "The sleep reserve takes the whole wake");
+
+RTC_DATA_ATTR WakeHealth wakeHealth = {};
+
+static const int64_t DEADLINE_US = WAKE_DEADLINE_MS * 1000LL;
+static const int64_t SOFT_DEADLINE_US = (WAKE_DEADLINE_MS - WAKE_SLEEP_RESERVE_MS) * 1000LL;
+
+static const uint32_t SLEEP_CLAIMED = 0x80000000u;
+
+// Phases in progress on any task, one bit per WakePhase
+static std::atomic<uint32_t> activePhases(0);
+// SleepGuards held on any task, with SLEEP_CLAIMED set once the wake is ending
+static std::atomic<uint32_t> sleepGuards(0);
+static esp_timer_handle_t deadlineTimer = nullptr;
+static bool deadlineReached = false;  // Only touched by the timer task
+
+static void increment(uint16_t& counter) {
+    if (counter < UINT16_MAX) counter++;
+}
+
+static void parkForever() {
+    while (true) vTaskDelay(portMAX_DELAY);
+}
+
+// Runs in the timer task while the wake is stuck, so it only touches RTC
+// state; the next wake reports what happened. Writes still in progress on
+// other tasks are given WAKE_DEADLINE_RETRY_MS at a time to finish.
+static void onDeadline(void*) {
+    if (!deadlineReached) {
+        deadlineReached = true;
+        if (sleepGuards.fetch_or(SLEEP_CLAIMED) & SLEEP_CLAIMED) return;  // Already going to sleep
+
+        const uint32_t active = activePhases.load();
+        for (int i = 0; i < WAKE_PHASE_COUNT; i++) {
+            if (active & (1u << i)) increment(wakeHealth.overruns[i]);
+        }
+        increment(wakeHealth.deadlineWakes);
+        wakeHealth.deadlinePhases = static_cast<uint16_t>(active);
+        wakeHealth.cutShort = true;
+    }
+
+    if (sleepGuards.load() & ~SLEEP_CLAIMED) {
+        esp_timer_start_once(deadlineTimer, WAKE_DEADLINE_RETRY_MS * 1000ULL);
+        return;
+    }
+    enterDeepSleep(scheduleNextWake());
+}
+
+void claimSleep() {
+    if (sleepGuards.fetch_or(SLEEP_CLAIMED) & SLEEP_CLAIMED) parkForever();
+    while (sleepGuards.load() & ~SLEEP_CLAIMED) delay(1);
+}
+
+void wakeDeadlineBegin() {
+    if (wakeHealth.cutShort) {
+        for (int i = 0; i < WAKE_PHASE_COUNT; i++) {
+            if (!(wakeHealth.deadlinePhases & (1u << i))) continue;
+            LOG_ERROR(SYSTEM, "Previous wake hit the %lu ms deadline during %s",
+                      static_cast<unsigned long>(WAKE_DEADLINE_MS), getWakePhaseName(static_cast<WakePhase>(i)));
+        }
+        LOG_ERROR(SYSTEM, "%u wakes ended by the deadline so far", wakeHealth.deadlineWakes);
+        wakeHealth.cutShort = false;
+    }
+
+    if (deadlineTimer == nullptr) {
+        const esp_timer_create_args_t args = {
+            .callback = onDeadline,
+            .arg = nullptr,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "wake_deadline"
+        };
+        if (esp_timer_create(&args, &deadlineTimer) != ESP_OK) {
+            LOG_ERROR(SYSTEM, "Failed to create the wake deadline timer");
+            deadlineTimer = nullptr;
+            return;
+        }
+    }
+
+    // The deadline counts from boot, not from setup()
+    const int64_t leftUs = DEADLINE_US - esp_timer_get_time();
+    esp_timer_start_once(deadlineTimer, leftUs > 0 ? leftUs : 1);
+}
+
+uint32_t wakeRemainingMs() {
+    const int64_t leftUs = SOFT_DEADLINE_US - esp_timer_get_time();
+    return leftUs > 0 ? static_cast<uint32_t>(leftUs / 1000) : 0;
+}
+
+void recordPhaseFailure(WakePhase phase) {
+    increment(wakeHealth.failures[static_cast<int>(phase)]);
+}
+
+PhaseBudget::PhaseBudget(WakePhase phase) : phase(phase), start(esp_timer_get_time()) {
+    const uint32_t budgetMs = WAKE_PHASE_BUDGET_MS[static_cast<int>(phase)];
+    deadlineUs = budgetMs > 0 && start + budgetMs * 1000LL < SOFT_DEADLINE_US ? start + budgetMs * 1000LL
+                                                                               : SOFT_DEADLINE_US;
+    activePhases.fetch_or(1u << static_cast<int>(phase));
+}
+
+PhaseBudget::~PhaseBudget() {
+    activePhases.fetch_and(~(1u << static_cast<int>(phase)));
+    const int64_t end = esp_timer_get_time();
+    if (end >= deadlineUs) {
+        increment(wakeHealth.overruns[static_cast<int>(phase)]);
+        LOG_WARN(SYSTEM, "%s used up its budget (%lu ms)", getWakePhaseName(phase),
+                 static_cast<unsigned long>((end - start) / 1000));
+    }
+}
+
+uint32_t PhaseBudget::remainingMs() const {
+    const int64_t leftUs = deadlineUs - esp_timer_get_time();
+    return leftUs > 0 ? static_cast<uint32_t>(leftUs / 1000) : 0;
+}
+
+uint32_t PhaseBudget::limit(uint32_t timeoutMs) const {
+    const uint32_t remaining = remainingMs();
+    return timeoutMs < remaining ? timeoutMs : remaining;
+}
+
+SleepGuard::SleepGuard() {
+    if (sleepGuards.fetch_add(1) & SLEEP_CLAIMED) {
+        sleepGuards.fetch_sub(1);
+        parkForever();
+    }
+}
+
+SleepGuard::~SleepGuard() {
+    sleepGuards.fetch_sub(1);
+}
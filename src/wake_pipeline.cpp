@@ -0,0 +1,92 @@
+#include "wake_pipeline.hpp"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config.hpp"
+#include "spsc_queue.hpp"
+#include "sensor.hpp"
+#include "network.hpp"
+#include "cadence.hpp"
+#include "data_manager.hpp"
+#include "reading_filter.hpp"
+#include "time_manager.hpp"
+#include "wake_deadline.hpp"
+#include "logging.hpp"
+
+static SpscQueue<SensorData, PIPELINE_QUEUE_LENGTH> readings;
+static std::atomic<bool> sensingDone(false);
+static TaskHandle_t waitingTask = nullptr;
+
+// Blocks until the sensor task queued a reading or finished without one
+static bool takeReading(SensorData& data) {
+    while (true) {
+        if (readings.pop(data)) return true;
+        if (sensingDone.load(std::memory_order_acquire)) return readings.pop(data);
+        vTaskDelay(1);
+    }
+}
+
+static void storeQueuedReadings() {
+    SensorData data;
+    SensorData filtered;
+    while (takeReading(data)) {
+        SleepGuard guard;
+        SensorManager::completeReading(data);
+        if (filterReading(data, timeState.lastKnownTime, filtered)) storeReading(filtered);
+        observeReading(data);
+        updateCadence(data);
+    }
+}
+
+static void networkTask(void*) {
+    const unsigned long start = millis();
+
+    if (WiFi.isConnected() || connectToWiFi()) {
+        handleTimeSync();
+        LOG_INFO(SYSTEM, "Pipeline: link ready after %lu ms", millis() - start);
+
+        // Earlier wakes' backlog goes out while the sensors are still sampling,
+        // the new reading follows on the same connection
+        bool sent = !hasStoredReadings() || sendStoredReadings();
+        storeQueuedReadings();
+        if (sent && hasStoredReadings()) sent = sendStoredReadings();
+        if (sent) LOG_INFO(SYSTEM, "Successfully sent stored readings");
+    } else {
+        LOG_WARN(SYSTEM, "Failed to connect to WiFi for data transmission");
+        storeQueuedReadings();
+    }
+
+    xTaskNotifyGive(waitingTask);
+    vTaskDelete(nullptr);
+}
+
+bool runPipelinedWake() {
+    waitingTask = xTaskGetCurrentTaskHandle();
+    sensingDone.store(false, std::memory_order_relaxed);
+
+    if (xTaskCreatePinnedToCore(networkTask, "network", PIPELINE_NETWORK_STACK_BYTES, nullptr, 1,
+                                nullptr, PIPELINE_NETWORK_CORE) != pdPASS) {
+        LOG_ERROR(SYSTEM, "Failed to start network task");
+        return false;
+    }
+
+    // Sensors that failed to initialize are left out of the reading
+    if (!SensorManager::initialize()) {
+        LOG_WARN(SYSTEM, "Reading without the sensors that failed to initialize");
+    }
+    SensorData data;
+    SensorManager::readAll(data);
+    if (!readings.push(data)) LOG_WARN(SYSTEM, "Reading queue full, reading dropped");
+    sensingDone.store(true, std::memory_order_release);
+
+    // Storage belongs to the network task until it signals completion. At
+    // the wake's deadline it is left behind: going to sleep waits for a write
+    // it has in progress, and what it has not acknowledged stays pending.
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wakeRemainingMs())) == 0) {
+        LOG_WARN(SYSTEM, "Pipeline: network task still busy at the wake deadline");
+        recordPhaseFailure(WakePhase::UPLOAD);
+    }
+    return true;
+}
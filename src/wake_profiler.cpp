@@ -0,0 +1,97 @@
+#include "wake_profiler.hpp"
+
+// Indexed by WakePhase
+static const char* const PHASE_NAMES[WAKE_PHASE_COUNT] = {
+    "boot",
+    "serial_settle",
+    "wifi_connect",
+    "time_sync",
+    "sensor_init",
+    "sensor_read",
+    "store",
+    "upload",
+    "awake"
+};
+
+const char* getWakePhaseName(WakePhase phase) {
+    const int index = static_cast<int>(phase);
+    if (index >= WAKE_PHASE_COUNT) return "unknown";
+    return PHASE_NAMES[index];
+}
+
+#if WAKE_PROFILER_ENABLED
+
+#include "time_manager.hpp"
+
+static const uint32_t WAKE_PROFILE_MAGIC = 0x50524F46;  // "PROF"
+
+RTC_DATA_ATTR WakeProfile wakeProfile = { .magic = 0 };
+
+// Bucket 0 is [0, 2^shift), then two buckets per power of two
+static int bucketFor(uint32_t us) {
+    if (us < (1UL << PROFILE_BUCKET_BASE_SHIFT)) return 0;
+    const int msb = 31 - __builtin_clz(us);
+    const int half = (us >> (msb - 1)) & 1;
+    const int bucket = 1 + 2 * (msb - PROFILE_BUCKET_BASE_SHIFT) + half;
+    return bucket < PROFILE_HISTOGRAM_BUCKETS ? bucket : PROFILE_HISTOGRAM_BUCKETS - 1;
+}
+
+uint32_t profileBucketStartUs(int bucket) {
+    if (bucket <= 0) return 0;
+    const int msb = PROFILE_BUCKET_BASE_SHIFT + (bucket - 1) / 2;
+    return (1UL << msb) + ((bucket - 1) % 2) * (1UL << (msb - 1));
+}
+
+float profilePercentileMs(const PhaseHistogram& histogram, float fraction) {
+    if (histogram.samples == 0) return 0.0f;
+
+    const float target = fraction * histogram.samples;
+    uint32_t seen = 0;
+    for (int i = 0; i < PROFILE_HISTOGRAM_BUCKETS; i++) {
+        const uint16_t count = histogram.buckets[i];
+        if (count == 0 || seen + count < target) {
+            seen += count;
+            continue;
+        }
+        // The open last bucket, and any bucket past the slowest sample, end at the max
+        uint32_t start = profileBucketStartUs(i);
+        uint32_t end = i + 1 < PROFILE_HISTOGRAM_BUCKETS ? profileBucketStartUs(i + 1) : histogram.maxUs;
+        if (end > histogram.maxUs) end = histogram.maxUs;
+        if (start > end) start = end;
+        return (start + (end - start) * (target - seen) / count) / 1000.0f;
+    }
+    return histogram.maxUs / 1000.0f;
+}
+
+void clearWakeProfile() {
+    memset(&wakeProfile, 0, sizeof(wakeProfile));
+    wakeProfile.magic = WAKE_PROFILE_MAGIC;
+}
+
+void profilerRecord(WakePhase phase, uint32_t us) {
+    PhaseHistogram& histogram = wakeProfile.phases[static_cast<int>(phase)];
+    if (histogram.samples == UINT16_MAX) return;
+
+    histogram.buckets[bucketFor(us)]++;
+    histogram.samples++;
+    histogram.totalUs += us;
+    if (us > histogram.maxUs) histogram.maxUs = us;
+}
+
+void profilerBegin() {
+    const int64_t bootUs = esp_timer_get_time();
+    if (wakeProfile.magic != WAKE_PROFILE_MAGIC) clearWakeProfile();
+    profilerRecord(WakePhase::BOOT, static_cast<uint32_t>(bootUs));
+}
+
+void profilerFinishWake() {
+    profilerRecord(WakePhase::AWAKE, static_cast<uint32_t>(esp_timer_get_time()));
+    if (wakeProfile.since == 0) wakeProfile.since = timeState.lastKnownTime;
+    if (wakeProfile.wakes < UINT16_MAX) wakeProfile.wakes++;
+}
+
+bool isProfileUploadDue() {
+    return wakeProfile.magic == WAKE_PROFILE_MAGIC && wakeProfile.wakes >= PROFILE_UPLOAD_WAKES;
+}
+
+#endif
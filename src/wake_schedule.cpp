@@ -0,0 +1,26 @@
+#include "wake_schedule.hpp"
+
+static const int32_t SECONDS_PER_DAY = 24 * 3600;
+static const long LOCAL_OFFSET_SECONDS = gmtOffset_sec + daylightOffset_sec;
+
+ScheduleSlot querySchedule(time_t now, uint32_t stride) {
+    // The grid counts from local midnight
+    int32_t secondOfDay = static_cast<int32_t>((static_cast<int64_t>(now) + LOCAL_OFFSET_SECONDS) % SECONDS_PER_DAY);
+    if (secondOfDay < 0) secondOfDay += SECONDS_PER_DAY;
+
+    // Before the first start the last window is still running from yesterday
+    int window = SCHEDULE_WINDOW_COUNT - 1;
+    for (int i = 0; i < SCHEDULE_WINDOW_COUNT; i++) {
+        if (secondOfDay >= SCHEDULE_WINDOWS[i].startHour * 3600) window = i;
+    }
+    const ScheduleWindow& current = SCHEDULE_WINDOWS[window];
+
+    int32_t windowEnd = SCHEDULE_WINDOWS[(window + 1) % SCHEDULE_WINDOW_COUNT].startHour * 3600;
+    if (windowEnd <= secondOfDay) windowEnd += SECONDS_PER_DAY;
+
+    const int32_t step = static_cast<int32_t>(current.intervalSeconds * (stride > 0 ? stride : 1));
+    int32_t next = (secondOfDay / step + 1) * step;
+    if (next > windowEnd) next = windowEnd;
+
+    return {now + (next - secondOfDay), current.intervalSeconds, current.night};
+}
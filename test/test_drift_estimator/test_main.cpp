@@ -0,0 +1,169 @@
+// RTC drift learning at NTP syncs and the clock uncertainty carried
+// through deep sleep, on the simulated clock
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <WiFi.h>
+#include "sim.hpp"
+#include "network.hpp"
+#include "time_manager.hpp"
+
+static const uint64_t HOUR_US = 3600ULL * 1000000;
+
+static const sim::LinkModel LINK = {
+    .scanMs = 1800,
+    .associateMs = 180,
+    .dhcpMs = 600,
+    .outageTimeoutMs = 4000,
+    .roundTripMs = 2,           // NTP answers within ±1 ms
+    .fullHandshakeMs = 900,
+    .resumedHandshakeMs = 120,
+    .bytesPerMs = 125,
+    .serverMs = 30
+};
+
+static sim::Scenario scenario;
+static sim::BootRecord boot;
+
+// Deep sleep as the runner models it: the clock counts countedUs while
+// driftPpm more actually passes
+static void sleepFor(uint64_t countedUs, double driftPpm) {
+    recordTimeBeforeSleep();
+    const int64_t extraUs = static_cast<int64_t>(countedUs * driftPpm * 1e-6);
+    boot.trueTimeUs += countedUs + extraUs;
+    boot.deviceOffsetUs -= extraUs;
+    updateTimeAfterSleep();
+}
+
+static int64_t clockErrorUs() {
+    return boot.deviceOffsetUs;
+}
+
+// Hourly wakes until the clock needs an NTP sync, then the sync
+static int wakeUntilSyncDue(double driftPpm) {
+    int wakes = 0;
+    while (!isTimeSyncDue() && wakes < 24 * 365) {
+        sleepFor(HOUR_US, driftPpm);
+        TEST_ASSERT_TRUE(llabs(clockErrorUs()) <= static_cast<int64_t>(timeState.uncertaintyUs));
+        wakes++;
+    }
+    TEST_ASSERT_TRUE(connectToWiFi());
+    handleTimeSync();
+    WiFi.disconnect(true);
+    return wakes;
+}
+
+void setUp(void) {
+    memset(&timeState, 0, sizeof(timeState));
+    memset(&scenario, 0, sizeof(scenario));
+    scenario.start = 1704067200;
+    sim::scenario = &scenario;
+    sim::linkModel = &LINK;
+
+    memset(&boot, 0, sizeof(boot));
+    boot.trueTimeUs = scenario.start * 1000000ULL;
+    boot.deviceOffsetUs = -5 * HOUR_US;  // Whatever the RTC held before the first sync
+    boot.resetReason = ESP_RST_DEEPSLEEP;
+    sim::boot = &boot;
+
+    TEST_ASSERT_TRUE(initializeTime());
+    TEST_ASSERT_TRUE(llabs(clockErrorUs()) < 2000);
+}
+
+void tearDown(void) {}
+
+void test_first_sample_takes_the_whole_residual(void) {
+    TEST_ASSERT_EQUAL(0, timeState.driftSamples);
+
+    // Unknown drift is bounded at 500 ppm, 1.8 s per hour: due after one wake
+    TEST_ASSERT_EQUAL(1, wakeUntilSyncDue(50.0));
+    TEST_ASSERT_EQUAL(1, timeState.driftSamples);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 50.0f, timeState.driftPpm);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 50.0f, timeState.driftErrorPpm);
+    TEST_ASSERT_TRUE(timeState.uncertaintyUs < 10000);
+}
+
+void test_short_spans_are_summed(void) {
+    // Sleep below TIME_DRIFT_MIN_LEARN_S, the step is kept for later
+    sleepFor(HOUR_US * 3 / 4, 50.0);
+    TEST_ASSERT_TRUE(isTimeSyncDue());
+    TEST_ASSERT_TRUE(connectToWiFi());
+    handleTimeSync();
+    TEST_ASSERT_EQUAL(0, timeState.driftSamples);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, timeState.driftPpm);
+
+    // Together with the next span it is learned over the whole 90 minutes
+    sleepFor(HOUR_US * 3 / 4, 50.0);
+    handleTimeSync();
+    TEST_ASSERT_EQUAL(1, timeState.driftSamples);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 50.0f, timeState.driftPpm);
+}
+
+void test_gain_converges_on_a_new_drift(void) {
+    wakeUntilSyncDue(50.0);
+
+    // Warmer, the oscillator runs 10 ppm slower; each sync closes half the gap
+    float gap = 10.0f;
+    for (int i = 0; i < 8; i++) {
+        const int wakes = wakeUntilSyncDue(60.0);
+        TEST_ASSERT_TRUE(wakes > 1);  // The bound shrinks with the error, syncs spread out
+        gap *= 1.0f - TIME_DRIFT_GAIN;
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, 60.0f - gap, timeState.driftPpm);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 60.0f, timeState.driftPpm);
+    TEST_ASSERT_EQUAL(9, timeState.driftSamples);
+    TEST_ASSERT_TRUE(timeState.driftErrorPpm < 1.0f);
+}
+
+void test_clock_going_back_invalidates_time(void) {
+    wakeUntilSyncDue(50.0);
+    const float driftPpm = timeState.driftPpm;
+
+    // The RTC domain lost power mid-sleep and restarted from zero
+    recordTimeBeforeSleep();
+    boot.trueTimeUs += HOUR_US;
+    boot.deviceOffsetUs -= 2 * HOUR_US;
+    updateTimeAfterSleep();
+
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, timeState.uncertaintyUs);
+    TEST_ASSERT_FALSE(isStateValid());
+    TEST_ASSERT_TRUE(isTimeSyncDue());
+    TEST_ASSERT_EQUAL(0, timeState.sleepStartUs);
+    TEST_ASSERT_EQUAL_FLOAT(driftPpm, timeState.driftPpm);  // Not a measure of drift
+
+    // The next sync recovers the clock without taking the lost hours for drift
+    TEST_ASSERT_TRUE(connectToWiFi());
+    handleTimeSync();
+    WiFi.disconnect(true);
+    TEST_ASSERT_TRUE(isStateValid());
+    TEST_ASSERT_TRUE(llabs(clockErrorUs()) < 2000);
+    TEST_ASSERT_EQUAL_FLOAT(driftPpm, timeState.driftPpm);
+
+    // Learning resumes over a fresh span
+    const uint8_t samples = timeState.driftSamples;
+    while (timeState.driftSamples == samples) {
+        wakeUntilSyncDue(50.0);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 50.0f, timeState.driftPpm);
+}
+
+void test_uncertainty_saturates(void) {
+    // 100 days at the 500 ppm bound is more than 32 bits of microseconds
+    sleepFor(100 * 24 * HOUR_US, 50.0);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, timeState.uncertaintyUs);
+
+    // Further sleep stays at the limit instead of wrapping
+    sleepFor(HOUR_US, 50.0);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, timeState.uncertaintyUs);
+    TEST_ASSERT_FALSE(isStateValid());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_sample_takes_the_whole_residual);
+    RUN_TEST(test_short_spans_are_summed);
+    RUN_TEST(test_gain_converges_on_a_new_drift);
+    RUN_TEST(test_clock_going_back_invalidates_time);
+    RUN_TEST(test_uncertainty_saturates);
+    return UNITY_END();
+}
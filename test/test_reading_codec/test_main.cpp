@@ -0,0 +1,177 @@
+// Round trips through the packed reading encoding and the RTC block ring
+#include <unity.h>
+#include <stdio.h>
+#include "reading_codec.hpp"
+#include "data_manager.hpp"
+#include "time_manager.hpp"
+
+static const time_t START = 1704067200;
+
+// Slowly drifting environment values, the shape the XOR coding is built for
+static void makeReading(int index, SensorData& data) {
+    const float values[] = {21.5f + index * 0.01f, 55.0f - index * 0.02f, 1013.2f, 120.0f + index % 5,
+                            2200.0f + index % 3, 41.0f, 4.1f, 88.0f, 1.0f, -67.0f, 10.0f + index, 0.0f};
+    data.numDataPoints = 0;
+    for (int metric = 0; metric < METRIC_COUNT && data.numDataPoints < MAX_DATA_POINTS_PER_READING; metric++) {
+        data.dataPoints[data.numDataPoints++] = {static_cast<MetricId>(metric), values[metric]};
+    }
+}
+
+static void assertSameReading(const SensorData& expected, time_t timestamp, const StoredReading& actual) {
+    TEST_ASSERT_EQUAL(timestamp, actual.timestamp);
+    TEST_ASSERT_EQUAL(expected.numDataPoints, actual.numDataPoints);
+    for (int i = 0; i < expected.numDataPoints; i++) {
+        TEST_ASSERT_EQUAL(static_cast<int>(expected.dataPoints[i].metric), static_cast<int>(actual.dataPoints[i].metric));
+        TEST_ASSERT_EQUAL_FLOAT(expected.dataPoints[i].value, actual.dataPoints[i].value);
+    }
+}
+
+static void storeAt(int index, SensorData& data) {
+    makeReading(index, data);
+    timeState.lastKnownTime = START + index * 60;
+    storeReading(data);
+}
+
+void setUp(void) {
+    clearStoredReadings();
+}
+
+void tearDown(void) {}
+
+void test_first_reading_is_absolute(void) {
+    uint8_t buffer[RAW_BLOCK_BYTES];
+    BitWriter writer(buffer, sizeof(buffer), 0);
+    ReadingCodecState state;
+    resetCodecState(state);
+
+    SensorData data;
+    makeReading(0, data);
+    TEST_ASSERT_TRUE(encodeReading(writer, state, data, START));
+
+    // 3 bit tag and 32 bit time, then the metric set
+    BitReader reader(buffer, writer.position());
+    uint32_t tag;
+    uint32_t timestamp;
+    TEST_ASSERT_TRUE(reader.read(3, tag) && reader.read(32, timestamp));
+    TEST_ASSERT_EQUAL(0x7, tag);
+    TEST_ASSERT_EQUAL(START, timestamp);
+
+    BitReader decodeReader(buffer, writer.position());
+    ReadingCodecState decodeState;
+    resetCodecState(decodeState);
+    StoredReading reading;
+    TEST_ASSERT_TRUE(decodeReading(decodeReader, decodeState, reading));
+    assertSameReading(data, START, reading);
+    TEST_ASSERT_FALSE(decodeReading(decodeReader, decodeState, reading));
+}
+
+void test_skipped_metrics_round_trip(void) {
+    uint8_t buffer[RAW_BLOCK_BYTES];
+    BitWriter writer(buffer, sizeof(buffer), 0);
+    ReadingCodecState state;
+    resetCodecState(state);
+
+    // A sensor dropping out and coming back changes the metric set twice
+    SensorData readings[4];
+    for (int i = 0; i < 4; i++) makeReading(i, readings[i]);
+    readings[1].numDataPoints = 4;  // BME680 only
+    readings[2].dataPoints[0] = readings[2].dataPoints[readings[2].numDataPoints - 1];
+    readings[2].numDataPoints--;    // No temperature
+
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(encodeReading(writer, state, readings[i], START + i * 60));
+    }
+
+    BitReader reader(buffer, writer.position());
+    ReadingCodecState decodeState;
+    resetCodecState(decodeState);
+    StoredReading reading;
+
+    TEST_ASSERT_TRUE(decodeReading(reader, decodeState, reading));
+    assertSameReading(readings[0], START, reading);
+    TEST_ASSERT_TRUE(decodeReading(reader, decodeState, reading));
+    assertSameReading(readings[1], START + 60, reading);
+
+    // Decoded points come back in metric order
+    TEST_ASSERT_TRUE(decodeReading(reader, decodeState, reading));
+    TEST_ASSERT_EQUAL(readings[2].numDataPoints, reading.numDataPoints);
+    TEST_ASSERT_EQUAL(static_cast<int>(MetricId::HUMIDITY), static_cast<int>(reading.dataPoints[0].metric));
+    TEST_ASSERT_EQUAL_FLOAT(readings[2].dataPoints[1].value, reading.dataPoints[0].value);
+
+    TEST_ASSERT_TRUE(decodeReading(reader, decodeState, reading));
+    assertSameReading(readings[3], START + 180, reading);
+}
+
+void test_full_buffer_leaves_stream_unchanged(void) {
+    uint8_t buffer[16];
+    BitWriter writer(buffer, sizeof(buffer), 0);
+    ReadingCodecState state;
+    resetCodecState(state);
+
+    SensorData data;
+    makeReading(0, data);
+    const ReadingCodecState before = state;
+    TEST_ASSERT_FALSE(encodeReading(writer, state, data, START));
+    TEST_ASSERT_EQUAL(0, writer.position());
+    TEST_ASSERT_EQUAL_MEMORY(&before, &state, sizeof(state));
+}
+
+void test_block_rollover(void) {
+    SensorData data[200];
+    int stored = 0;
+    while (storedReadings.numBlocks < 3) {
+        storeAt(stored, data[stored]);
+        stored++;
+    }
+    TEST_ASSERT_EQUAL(stored, storedReadingCount());
+
+    // Every block starts with a fresh codec state, so each decodes on its own
+    StoredReadingReader reader;
+    StoredReading reading;
+    for (int i = 0; i < stored; i++) {
+        TEST_ASSERT_TRUE(reader.next(reading));
+        assertSameReading(data[i], START + i * 60, reading);
+    }
+    TEST_ASSERT_FALSE(reader.next(reading));
+
+    char message[96];
+    snprintf(message, sizeof(message), "%d readings of %d metrics: %.2f bytes/reading (%u bytes as floats)",
+             stored, data[0].numDataPoints, static_cast<float>(storageBytesUsed()) / stored,
+             static_cast<unsigned>(sizeof(uint32_t) + data[0].numDataPoints * sizeof(float)));
+    TEST_MESSAGE(message);
+}
+
+void test_partial_ack_skips_sent_readings(void) {
+    SensorData data[200];
+    int stored = 0;
+    while (storedReadings.numBlocks < 2 || storedReadings.blocks[1].count < 3) {
+        storeAt(stored, data[stored]);
+        stored++;
+    }
+
+    // Part of the first block, then across the block boundary (the ring starts at 0 after setUp)
+    const int firstAck = 3;
+    acknowledgeStoredReadings(firstAck);
+    TEST_ASSERT_EQUAL(stored - firstAck, storedReadingCount());
+
+    StoredReadingReader reader;
+    StoredReading reading;
+    TEST_ASSERT_TRUE(reader.next(reading));
+    assertSameReading(data[firstAck], START + firstAck * 60, reading);
+
+    const int firstBlock = storedReadings.blocks[storedReadings.headBlock].count;
+    acknowledgeStoredReadings(firstBlock - firstAck + 1);
+    StoredReadingReader nextReader;
+    TEST_ASSERT_TRUE(nextReader.next(reading));
+    assertSameReading(data[firstBlock + 1], START + (firstBlock + 1) * 60, reading);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_reading_is_absolute);
+    RUN_TEST(test_skipped_metrics_round_trip);
+    RUN_TEST(test_full_buffer_leaves_stream_unchanged);
+    RUN_TEST(test_block_rollover);
+    RUN_TEST(test_partial_ack_skips_sent_readings);
+    return UNITY_END();
+}
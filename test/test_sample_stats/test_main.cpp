@@ -0,0 +1,113 @@
+// Robust statistics over ADC sample bursts
+#include <unity.h>
+#include "sample_stats.hpp"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_empty_burst_is_rejected(void) {
+    uint16_t samples[1] = {0};
+    SampleStats stats;
+    TEST_ASSERT_FALSE(computeSampleStats(samples, 0, 0.1f, stats));
+}
+
+void test_odd_count(void) {
+    uint16_t samples[] = {30, 10, 50, 20, 40};
+    SampleStats stats;
+    TEST_ASSERT_TRUE(computeSampleStats(samples, 5, 0.0f, stats));
+    TEST_ASSERT_EQUAL(5, stats.count);
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, stats.median);
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, stats.trimmedMean);
+    TEST_ASSERT_EQUAL_FLOAT(250.0f, stats.variance);
+    TEST_ASSERT_EQUAL(10, stats.min);
+    TEST_ASSERT_EQUAL(50, stats.max);
+
+    // Sorted in place
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(10 * (i + 1), samples[i]);
+    }
+}
+
+void test_even_count_median_averages_middle_pair(void) {
+    uint16_t samples[] = {4, 1, 3, 2};
+    SampleStats stats;
+    TEST_ASSERT_TRUE(computeSampleStats(samples, 4, 0.0f, stats));
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, stats.median);
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, stats.trimmedMean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 5.0f / 3.0f, stats.variance);
+}
+
+void test_single_sample(void) {
+    uint16_t samples[] = {1234};
+    SampleStats stats;
+    TEST_ASSERT_TRUE(computeSampleStats(samples, 1, 0.5f, stats));
+    TEST_ASSERT_EQUAL_FLOAT(1234.0f, stats.median);
+    TEST_ASSERT_EQUAL_FLOAT(1234.0f, stats.trimmedMean);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.variance);
+}
+
+void test_all_equal_samples(void) {
+    uint16_t samples[64];
+    for (int i = 0; i < 64; i++) {
+        samples[i] = 2048;
+    }
+    SampleStats stats;
+    TEST_ASSERT_TRUE(computeSampleStats(samples, 64, 0.1f, stats));
+    TEST_ASSERT_EQUAL_FLOAT(2048.0f, stats.median);
+    TEST_ASSERT_EQUAL_FLOAT(2048.0f, stats.trimmedMean);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.variance);  // No cancellation error at a large offset
+    TEST_ASSERT_EQUAL(2048, stats.min);
+    TEST_ASSERT_EQUAL(2048, stats.max);
+}
+
+void test_trimmed_mean_rejects_outliers(void) {
+    // Twenty samples around 1000 with one spike at each end, as a WiFi burst
+    // couples into the ADC
+    uint16_t samples[20];
+    for (int i = 0; i < 20; i++) {
+        samples[i] = 998 + i % 5;
+    }
+    samples[3] = 0;
+    samples[11] = 4095;
+
+    SampleStats stats;
+    TEST_ASSERT_TRUE(computeSampleStats(samples, 20, 0.1f, stats));
+    TEST_ASSERT_EQUAL(0, stats.min);
+    TEST_ASSERT_EQUAL(4095, stats.max);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 1000.0f, stats.median);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 1000.0f, stats.trimmedMean);
+
+    // The variance is over all samples, so it still shows the spikes
+    TEST_ASSERT_GREATER_THAN(100000, static_cast<int>(stats.variance));
+}
+
+void test_trim_fraction_is_clamped(void) {
+    uint16_t samples[] = {1, 2, 3, 100};
+    SampleStats stats;
+
+    // Half or more from each end keeps the middle pair
+    TEST_ASSERT_TRUE(computeSampleStats(samples, 4, 0.9f, stats));
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, stats.trimmedMean);
+
+    uint16_t odd[] = {1, 2, 3, 4, 100};
+    TEST_ASSERT_TRUE(computeSampleStats(odd, 5, 0.5f, stats));
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, stats.trimmedMean);
+
+    // Negative means no trimming
+    uint16_t untrimmed[] = {1, 2, 3, 100};
+    TEST_ASSERT_TRUE(computeSampleStats(untrimmed, 4, -1.0f, stats));
+    TEST_ASSERT_EQUAL_FLOAT(26.5f, stats.trimmedMean);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_burst_is_rejected);
+    RUN_TEST(test_odd_count);
+    RUN_TEST(test_even_count_median_averages_middle_pair);
+    RUN_TEST(test_single_sample);
+    RUN_TEST(test_all_equal_samples);
+    RUN_TEST(test_trimmed_mean_rejects_outliers);
+    RUN_TEST(test_trim_fraction_is_clamped);
+    return UNITY_END();
+}
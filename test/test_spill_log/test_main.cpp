@@ -0,0 +1,289 @@
+// Spill log on the host filesystem: compaction, recovery after power loss
+// or a torn write, and flush throughput
+#include <unity.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "spill_log.hpp"
+
+static const char* TEST_DIR = "sim_fs/test_spill";
+static const int READINGS_PER_BLOCK = 5;
+
+static ReadingBlock makeBlock(int index) {
+    ReadingBlock block;
+    memset(block.data, index & 0xFF, sizeof(block.data));
+    block.bitsUsed = 100 + index % 50;
+    block.count = READINGS_PER_BLOCK;
+    block.skip = 0;
+    return block;
+}
+
+static void appendBlocks(int first, int count) {
+    for (int i = first; i < first + count; i++) {
+        TEST_ASSERT_TRUE(spillLogAppend(makeBlock(i)));
+    }
+    TEST_ASSERT_TRUE(spillLogFlush());
+}
+
+static std::string segmentPath(uint32_t segment) {
+    char path[64];
+    snprintf(path, sizeof(path), "%s/seg_%06lu.bin", TEST_DIR, static_cast<unsigned long>(segment));
+    return path;
+}
+
+static std::string statePath(const char* name) {
+    return std::string(TEST_DIR) + "/" + name;
+}
+
+static bool fileExists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+static std::vector<uint8_t> readFile(const std::string& path) {
+    std::vector<uint8_t> bytes;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) return bytes;
+    uint8_t buffer[512];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) bytes.insert(bytes.end(), buffer, buffer + n);
+    fclose(file);
+    return bytes;
+}
+
+static void writeFile(const std::string& path, const std::vector<uint8_t>& bytes, const char* mode = "wb") {
+    FILE* file = fopen(path.c_str(), mode);
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+// RTC memory is lost, only flash remains
+static void powerCycle() {
+    spillLogFlush();
+    memset(&spillLogState, 0, sizeof(spillLogState));
+    TEST_ASSERT_TRUE(spillLogBegin(false, TEST_DIR));
+}
+
+// Reads every pending record, checking they come back in append order
+static int readAll(int firstIndex) {
+    SpillLogReader reader;
+    ReadingBlock block;
+    int records = 0;
+    while (reader.next(block)) {
+        TEST_ASSERT_EQUAL((firstIndex + records) & 0xFF, block.data[0]);
+        TEST_ASSERT_EQUAL(100 + (firstIndex + records) % 50, block.bitsUsed);
+        records++;
+    }
+    return records;
+}
+
+void setUp(void) {
+    mkdir("sim_fs", 0755);
+    mkdir(TEST_DIR, 0755);
+    DIR* dir = opendir(TEST_DIR);
+    if (dir != nullptr) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (entry->d_name[0] != '.') remove(statePath(entry->d_name).c_str());
+        }
+        closedir(dir);
+    }
+    memset(&spillLogState, 0, sizeof(spillLogState));
+    TEST_ASSERT_TRUE(spillLogBegin(false, TEST_DIR));
+}
+
+void tearDown(void) {
+    spillLogFlush();
+}
+
+void test_append_and_read_across_segments(void) {
+    appendBlocks(0, 2 * SPILL_SEGMENT_RECORDS + 10);
+    TEST_ASSERT_EQUAL(2 * SPILL_SEGMENT_RECORDS + 10, spillLogPendingRecords());
+    TEST_ASSERT_EQUAL((2 * SPILL_SEGMENT_RECORDS + 10) * READINGS_PER_BLOCK, spillLogPendingReadings());
+    TEST_ASSERT_EQUAL(2 * SPILL_SEGMENT_RECORDS + 10, readAll(0));
+}
+
+void test_commit_compacts_consumed_segments(void) {
+    appendBlocks(0, 2 * SPILL_SEGMENT_RECORDS + 10);
+
+    // Halfway into the second segment: the first one is deleted
+    SpillLogReader reader;
+    ReadingBlock block;
+    for (int i = 0; i < SPILL_SEGMENT_RECORDS + 5; i++) TEST_ASSERT_TRUE(reader.next(block));
+    TEST_ASSERT_TRUE(spillLogCommit(reader.position(), reader.readingsRead()));
+
+    TEST_ASSERT_FALSE(fileExists(segmentPath(0)));
+    TEST_ASSERT_TRUE(fileExists(segmentPath(1)));
+    TEST_ASSERT_EQUAL(SPILL_SEGMENT_RECORDS + 5, spillLogPendingRecords());
+    TEST_ASSERT_EQUAL((SPILL_SEGMENT_RECORDS + 5) * READINGS_PER_BLOCK, spillLogPendingReadings());
+    TEST_ASSERT_EQUAL(SPILL_SEGMENT_RECORDS + 5, readAll(SPILL_SEGMENT_RECORDS + 5));
+
+    // Exactly at a segment end moves on to the next segment
+    SpillLogReader second;
+    for (int i = 0; i < 10; i++) TEST_ASSERT_TRUE(second.next(block));
+    TEST_ASSERT_TRUE(spillLogCommit(second.position(), second.readingsRead()));
+    TEST_ASSERT_FALSE(fileExists(segmentPath(1)));
+    TEST_ASSERT_EQUAL(2, static_cast<int>(spillLogState.cursor.segment));
+    TEST_ASSERT_EQUAL(0, spillLogState.cursor.record);
+}
+
+void test_segment_limit_drops_oldest(void) {
+    appendBlocks(0, (SPILL_MAX_SEGMENTS + 1) * SPILL_SEGMENT_RECORDS);
+
+    // Appending the first record of segment 65 dropped segment 0
+    TEST_ASSERT_FALSE(fileExists(segmentPath(0)));
+    TEST_ASSERT_EQUAL(SPILL_MAX_SEGMENTS * SPILL_SEGMENT_RECORDS, spillLogPendingRecords());
+    TEST_ASSERT_EQUAL(SPILL_MAX_SEGMENTS * SPILL_SEGMENT_RECORDS * READINGS_PER_BLOCK, spillLogPendingReadings());
+    TEST_ASSERT_EQUAL(SPILL_MAX_SEGMENTS * SPILL_SEGMENT_RECORDS, readAll(SPILL_SEGMENT_RECORDS));
+}
+
+void test_recovery_after_power_loss(void) {
+    appendBlocks(0, SPILL_SEGMENT_RECORDS + 8);
+    SpillLogReader reader;
+    ReadingBlock block;
+    for (int i = 0; i < 7; i++) TEST_ASSERT_TRUE(reader.next(block));
+    TEST_ASSERT_TRUE(spillLogCommit(reader.position(), reader.readingsRead()));
+    const uint32_t nextSequence = spillLogState.nextSequence;
+
+    powerCycle();
+    TEST_ASSERT_EQUAL(0, static_cast<int>(spillLogState.cursor.segment));
+    TEST_ASSERT_EQUAL(7, spillLogState.cursor.record);
+    TEST_ASSERT_EQUAL(1, static_cast<int>(spillLogState.headSegment));
+    TEST_ASSERT_EQUAL(8, spillLogState.headRecords);
+    TEST_ASSERT_EQUAL(nextSequence, spillLogState.nextSequence);
+    TEST_ASSERT_EQUAL(SPILL_SEGMENT_RECORDS + 1, spillLogPendingRecords());
+    TEST_ASSERT_EQUAL((SPILL_SEGMENT_RECORDS + 1) * READINGS_PER_BLOCK, spillLogPendingReadings());
+
+    // Appending carries on in the head segment
+    appendBlocks(SPILL_SEGMENT_RECORDS + 8, 2);
+    TEST_ASSERT_EQUAL(SPILL_SEGMENT_RECORDS + 3, readAll(7));
+}
+
+void test_torn_record_keeps_valid_prefix(void) {
+    appendBlocks(0, 10);
+
+    // Power lost halfway through writing the eleventh record
+    std::vector<uint8_t> partial(RAW_BLOCK_BYTES / 2, 0xA5);
+    writeFile(segmentPath(0), partial, "ab");
+
+    powerCycle();
+    TEST_ASSERT_EQUAL(10 * READINGS_PER_BLOCK, spillLogPendingReadings());
+    TEST_ASSERT_EQUAL(1, static_cast<int>(spillLogState.headSegment));  // Never appends behind the tear
+    TEST_ASSERT_EQUAL(0, spillLogState.headRecords);
+    TEST_ASSERT_EQUAL(10, readAll(0));
+
+    // New records follow in a fresh segment and are read after the valid prefix
+    appendBlocks(10, 3);
+    TEST_ASSERT_EQUAL(13, readAll(0));
+    TEST_ASSERT_EQUAL(13 * READINGS_PER_BLOCK, spillLogPendingReadings());
+    TEST_ASSERT_EQUAL(13, spillLogPendingRecords());  // The short segment is not counted as full
+
+    // Still counted right across power loss and once the short segment is consumed
+    powerCycle();
+    TEST_ASSERT_EQUAL(13, spillLogPendingRecords());
+    SpillLogReader reader;
+    ReadingBlock block;
+    for (int i = 0; i < 11; i++) TEST_ASSERT_TRUE(reader.next(block));
+    TEST_ASSERT_TRUE(spillLogCommit(reader.position(), reader.readingsRead()));
+    TEST_ASSERT_EQUAL(2, spillLogPendingRecords());
+    TEST_ASSERT_EQUAL(2, readAll(11));
+}
+
+void test_corrupt_record_ends_its_segment(void) {
+    appendBlocks(0, SPILL_SEGMENT_RECORDS + 3);
+
+    // Flip a data byte of the fifth record, its CRC no longer matches
+    std::vector<uint8_t> segment = readFile(segmentPath(0));
+    const size_t recordBytes = segment.size() / SPILL_SEGMENT_RECORDS;
+    segment[4 * recordBytes + 32] ^= 0xFF;
+    writeFile(segmentPath(0), segment);
+
+    SpillLogReader reader;
+    ReadingBlock block;
+    for (int i = 0; i < 4; i++) TEST_ASSERT_TRUE(reader.next(block));
+    TEST_ASSERT_TRUE(reader.next(block));
+    TEST_ASSERT_EQUAL(SPILL_SEGMENT_RECORDS & 0xFF, block.data[0]);  // Resumes at the next segment
+    TEST_ASSERT_EQUAL(1, static_cast<int>(reader.position().segment));
+}
+
+void test_interrupted_cursor_rename(void) {
+    appendBlocks(0, 2 * SPILL_SEGMENT_RECORDS);
+    SpillLogReader reader;
+    ReadingBlock block;
+    for (int i = 0; i < 5; i++) TEST_ASSERT_TRUE(reader.next(block));
+    TEST_ASSERT_TRUE(spillLogCommit(reader.position(), reader.readingsRead()));
+    const std::vector<uint8_t> oldCursor = readFile(statePath("cursor.bin"));
+    const std::vector<uint8_t> firstSegment = readFile(segmentPath(0));
+
+    // Commit past the first segment, then put flash back to the moment the
+    // new cursor was written to cursor.tmp but not renamed yet
+    SpillLogReader second;
+    for (int i = 0; i < SPILL_SEGMENT_RECORDS - 5; i++) TEST_ASSERT_TRUE(second.next(block));
+    TEST_ASSERT_TRUE(spillLogCommit(second.position(), second.readingsRead()));
+    const std::vector<uint8_t> newCursor = readFile(statePath("cursor.bin"));
+    writeFile(statePath("cursor.bin"), oldCursor);
+    writeFile(statePath("cursor.tmp"), newCursor);
+    writeFile(segmentPath(0), firstSegment);
+
+    powerCycle();
+    TEST_ASSERT_EQUAL(0, static_cast<int>(spillLogState.cursor.segment));
+    TEST_ASSERT_EQUAL(5, spillLogState.cursor.record);
+    TEST_ASSERT_EQUAL((2 * SPILL_SEGMENT_RECORDS - 5) * READINGS_PER_BLOCK, spillLogPendingReadings());
+    TEST_ASSERT_EQUAL(2 * SPILL_SEGMENT_RECORDS - 5, readAll(5));
+}
+
+void test_crash_between_rename_and_compaction(void) {
+    appendBlocks(0, 2 * SPILL_SEGMENT_RECORDS);
+    const std::vector<uint8_t> firstSegment = readFile(segmentPath(0));
+
+    SpillLogReader reader;
+    ReadingBlock block;
+    for (int i = 0; i < SPILL_SEGMENT_RECORDS; i++) TEST_ASSERT_TRUE(reader.next(block));
+    TEST_ASSERT_TRUE(spillLogCommit(reader.position(), reader.readingsRead()));
+
+    // The cursor made it to flash, deleting the consumed segment did not
+    writeFile(segmentPath(0), firstSegment);
+
+    powerCycle();
+    TEST_ASSERT_FALSE(fileExists(segmentPath(0)));
+    TEST_ASSERT_EQUAL(1, static_cast<int>(spillLogState.cursor.segment));
+    TEST_ASSERT_EQUAL(SPILL_SEGMENT_RECORDS * READINGS_PER_BLOCK, spillLogPendingReadings());
+    TEST_ASSERT_EQUAL(SPILL_SEGMENT_RECORDS, readAll(SPILL_SEGMENT_RECORDS));
+}
+
+void test_flush_throughput(void) {
+    const int batches = 50;
+    struct timespec start;
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < batches; i++) appendBlocks(i * SPILL_FLUSH_BLOCKS, SPILL_FLUSH_BLOCKS);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    const double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    const double kilobytes = batches * SPILL_FLUSH_BLOCKS * RAW_BLOCK_BYTES / 1024.0;
+    char message[96];
+    snprintf(message, sizeof(message), "%d flushes of %d blocks: %.2f ms per flush, %.0f KB/s on the host",
+             batches, SPILL_FLUSH_BLOCKS, seconds * 1000 / batches, kilobytes / seconds);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL(batches * SPILL_FLUSH_BLOCKS, readAll(0));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_append_and_read_across_segments);
+    RUN_TEST(test_commit_compacts_consumed_segments);
+    RUN_TEST(test_segment_limit_drops_oldest);
+    RUN_TEST(test_recovery_after_power_loss);
+    RUN_TEST(test_torn_record_keeps_valid_prefix);
+    RUN_TEST(test_corrupt_record_ends_its_segment);
+    RUN_TEST(test_interrupted_cursor_rename);
+    RUN_TEST(test_crash_between_rename_and_compaction);
+    RUN_TEST(test_flush_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,177 @@
+// Upload decision of the cost model, and the oldest-unsent age it is fed
+#include <unity.h>
+#include "upload_scheduler.hpp"
+#include "data_manager.hpp"
+#include "time_manager.hpp"
+
+static const CostModelScheduler::Parameters PARAMS = {
+    6 * 3600,   // maxLatencySeconds
+    0.8f,       // fillThreshold
+    25.0f,      // targetReadingsPerSecond
+    3000,       // defaultConnectMs
+    2.0f,       // msPerReading
+    20.0f,      // lowBatteryPercent
+    2.0f        // lowBatteryLatencyFactor
+};
+
+// A young backlog on a good link and a full battery
+static UploadInputs quietInputs() {
+    UploadInputs inputs;
+    inputs.storageFill = 0.1f;
+    inputs.oldestAgeSeconds = 600;
+    inputs.pendingReadings = 40;
+    inputs.lastRssi = -60;
+    inputs.batteryPercent = 100.0f;
+    inputs.expectedConnectMs = 2000;
+    inputs.wakeIntervalSeconds = 60;
+    inputs.isNight = false;
+    return inputs;
+}
+
+static void storeAt(time_t timestamp) {
+    SensorData data;
+    data.numDataPoints = 1;
+    data.dataPoints[0] = {MetricId::TEMPERATURE, 20.0f + timestamp % 7};
+    timeState.lastKnownTime = timestamp;
+    storeReading(data);
+}
+
+void setUp(void) {
+    clearStoredReadings();
+}
+
+void tearDown(void) {}
+
+void test_nothing_pending_never_uploads(void) {
+    UploadInputs inputs = quietInputs();
+    inputs.pendingReadings = 0;
+    inputs.storageFill = 1.0f;
+    TEST_ASSERT_FALSE(CostModelScheduler(PARAMS).decide(inputs).upload);
+}
+
+void test_small_backlog_is_deferred(void) {
+    const UploadDecision decision = CostModelScheduler(PARAMS).decide(quietInputs());
+    TEST_ASSERT_FALSE(decision.upload);
+    TEST_ASSERT_EQUAL_STRING("deferring", decision.reason);
+}
+
+void test_latency_trigger_fires_on_last_wake_within_bound(void) {
+    const CostModelScheduler scheduler(PARAMS);
+    UploadInputs inputs = quietInputs();
+
+    // The next wake would still be within the bound
+    inputs.oldestAgeSeconds = PARAMS.maxLatencySeconds - inputs.wakeIntervalSeconds;
+    TEST_ASSERT_FALSE(scheduler.decide(inputs).upload);
+
+    inputs.oldestAgeSeconds++;
+    const UploadDecision decision = scheduler.decide(inputs);
+    TEST_ASSERT_TRUE(decision.upload);
+    TEST_ASSERT_EQUAL_STRING("latency bound reached", decision.reason);
+}
+
+void test_low_battery_stretches_latency_bound(void) {
+    const CostModelScheduler scheduler(PARAMS);
+    UploadInputs inputs = quietInputs();
+    inputs.oldestAgeSeconds = PARAMS.maxLatencySeconds;
+    inputs.batteryPercent = 10.0f;
+    TEST_ASSERT_FALSE(scheduler.decide(inputs).upload);
+
+    inputs.oldestAgeSeconds = PARAMS.maxLatencySeconds * 2;
+    TEST_ASSERT_TRUE(scheduler.decide(inputs).upload);
+}
+
+void test_fill_trigger_ignores_cost(void) {
+    const CostModelScheduler scheduler(PARAMS);
+    UploadInputs inputs = quietInputs();
+    inputs.pendingReadings = 1;
+    inputs.storageFill = PARAMS.fillThreshold;
+
+    const UploadDecision decision = scheduler.decide(inputs);
+    TEST_ASSERT_TRUE(decision.upload);
+    TEST_ASSERT_EQUAL_STRING("buffer nearly full", decision.reason);
+
+    inputs.storageFill = PARAMS.fillThreshold - 0.01f;
+    TEST_ASSERT_FALSE(scheduler.decide(inputs).upload);
+}
+
+void test_cost_threshold(void) {
+    const CostModelScheduler scheduler(PARAMS);
+    UploadInputs inputs = quietInputs();
+
+    // 2000 ms to connect plus 2 ms per reading: n / (2 + 0.002 n) >= 25 from n = 53
+    inputs.pendingReadings = 52;
+    TEST_ASSERT_FALSE(scheduler.decide(inputs).upload);
+    inputs.pendingReadings = 53;
+    const UploadDecision decision = scheduler.decide(inputs);
+    TEST_ASSERT_TRUE(decision.upload);
+    TEST_ASSERT_EQUAL_STRING("enough readings to amortise the connection", decision.reason);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 53 * 1000.0f / 2106.0f, decision.readingsPerRadioSecond);
+}
+
+void test_weak_signal_and_low_battery_raise_the_bar(void) {
+    const CostModelScheduler scheduler(PARAMS);
+    UploadInputs inputs = quietInputs();
+    inputs.pendingReadings = 60;
+    TEST_ASSERT_TRUE(scheduler.decide(inputs).upload);
+
+    inputs.lastRssi = -87;  // 20 dB below good, twice the airtime
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 2.0f * (2000 + 120), scheduler.estimateRadioMs(inputs));
+    TEST_ASSERT_FALSE(scheduler.decide(inputs).upload);
+
+    inputs.lastRssi = -60;
+    inputs.batteryPercent = 50.0f;  // Target doubles to 50 readings per second
+    TEST_ASSERT_FALSE(scheduler.decide(inputs).upload);
+}
+
+void test_unmeasured_connect_uses_default(void) {
+    const CostModelScheduler scheduler(PARAMS);
+    UploadInputs inputs = quietInputs();
+    inputs.expectedConnectMs = 0;
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, PARAMS.defaultConnectMs + 2.0f * inputs.pendingReadings,
+                             scheduler.estimateRadioMs(inputs));
+}
+
+void test_fixed_rule(void) {
+    const FixedRuleScheduler scheduler;
+    UploadInputs inputs = quietInputs();
+    TEST_ASSERT_TRUE(scheduler.decide(inputs).upload);
+
+    inputs.isNight = true;
+    TEST_ASSERT_FALSE(scheduler.decide(inputs).upload);
+
+    inputs.storageFill = UPLOAD_FILL_THRESHOLD;
+    TEST_ASSERT_TRUE(scheduler.decide(inputs).upload);
+}
+
+void test_oldest_unsent_follows_acknowledgements(void) {
+    const time_t start = 1704067200;
+    TEST_ASSERT_EQUAL(0, oldestUnsentTime());
+
+    for (int i = 0; i < 10; i++) storeAt(start + i * 60);
+    TEST_ASSERT_EQUAL(start, oldestUnsentTime());
+
+    // A partial upload leaves the fourth reading as the oldest
+    acknowledgeStoredReadings(3);
+    TEST_ASSERT_EQUAL(start + 3 * 60, oldestUnsentTime());
+
+    acknowledgeStoredReadings(7);
+    TEST_ASSERT_EQUAL(0, oldestUnsentTime());
+
+    storeAt(start + 3600);
+    TEST_ASSERT_EQUAL(start + 3600, oldestUnsentTime());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_nothing_pending_never_uploads);
+    RUN_TEST(test_small_backlog_is_deferred);
+    RUN_TEST(test_latency_trigger_fires_on_last_wake_within_bound);
+    RUN_TEST(test_low_battery_stretches_latency_bound);
+    RUN_TEST(test_fill_trigger_ignores_cost);
+    RUN_TEST(test_cost_threshold);
+    RUN_TEST(test_weak_signal_and_low_battery_raise_the_bar);
+    RUN_TEST(test_unmeasured_connect_uses_default);
+    RUN_TEST(test_fixed_rule);
+    RUN_TEST(test_oldest_unsent_follows_acknowledgements);
+    return UNITY_END();
+}
@@ -0,0 +1,207 @@
+// Reference decoder for the CBOR upload schema (see payload_encoder.hpp).
+// Reads one payload from stdin and prints the equivalent JSON upload body.
+//
+// Build on a Linux host from the repository root:
+//   g++ -std=c++11 -I include tools/decode_payload.cpp src/metrics.cpp -o decode_payload
+//   ./decode_payload < payload.cbor
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+#include "metrics.hpp"
+
+class CborReader {
+public:
+    CborReader(const std::vector<uint8_t>& data) : data(data), pos(0) {}
+
+    bool atBreak() const { return pos < data.size() && data[pos] == 0xFF; }
+    bool readBreak() { if (!atBreak()) return false; pos++; return true; }
+
+    // Returns false on truncated input; indefinite is set for length 31 heads
+    bool readHead(uint8_t& major, uint32_t& value, bool& indefinite) {
+        if (pos >= data.size()) return false;
+        const uint8_t initial = data[pos++];
+        major = initial >> 5;
+        const uint8_t info = initial & 0x1F;
+        indefinite = info == 31;
+
+        if (info < 24 || indefinite) {
+            value = info;
+            return true;
+        }
+        const int bytes = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : -1;
+        if (bytes < 0 || pos + bytes > data.size()) return false;
+
+        value = 0;
+        for (int i = 0; i < bytes; i++) value = (value << 8) | data[pos++];
+        return true;
+    }
+
+    bool readUint(uint32_t& value) {
+        uint8_t major;
+        bool indefinite;
+        return readHead(major, value, indefinite) && major == 0 && !indefinite;
+    }
+
+    bool readFloat(float& value) {
+        if (pos + 5 > data.size() || data[pos] != 0xFA) return false;
+        const uint32_t bits = (uint32_t(data[pos + 1]) << 24) | (uint32_t(data[pos + 2]) << 16) |
+                              (uint32_t(data[pos + 3]) << 8) | data[pos + 4];
+        memcpy(&value, &bits, sizeof(value));
+        pos += 5;
+        return true;
+    }
+
+    bool readText(std::string& text) {
+        uint8_t major;
+        uint32_t length;
+        bool indefinite;
+        if (!readHead(major, length, indefinite) || major != 3 || indefinite) return false;
+        if (pos + length > data.size()) return false;
+        text.assign(reinterpret_cast<const char*>(&data[pos]), length);
+        pos += length;
+        return true;
+    }
+
+    bool readArrayHead(uint32_t& size, bool& indefinite) {
+        uint8_t major;
+        return readHead(major, size, indefinite) && major == 4;
+    }
+
+private:
+    const std::vector<uint8_t>& data;
+    size_t pos;
+};
+
+static const char* sensorName(SensorId sensor) {
+    switch (sensor) {
+        case SensorId::BME680: return "bme680";
+        case SensorId::SOIL_MOISTURE: return "soil_moisture";
+        case SensorId::BATTERY: return "battery";
+        case SensorId::NETWORK: return "network";
+        default: return "unknown";
+    }
+}
+
+static void printPoint(bool& first, const std::string& deviceId, uint32_t metric,
+                       uint32_t timestamp, float value, const char* extra) {
+    char timeStr[30];
+    time_t t = timestamp;
+    struct tm utc;
+    gmtime_r(&t, &utc);
+    strftime(timeStr, sizeof(timeStr), "%Y-%m-%dT%H:%M:%S.000Z", &utc);
+
+    const MetricId id = static_cast<MetricId>(metric);
+    printf("%s{\"type\":\"%s\",\"value\":%.7g%s,\"sensor\":\"%s\",\"deviceId\":\"%s\",\"timestamp\":\"%s\"}",
+           first ? "" : ",", getMetricName(id), value, extra,
+           sensorName(getMetricSensor(id)), deviceId.c_str(), timeStr);
+    first = false;
+}
+
+static bool decodeBuckets(CborReader& cbor, const std::string& deviceId, bool& first) {
+    uint32_t count;
+    bool indefinite;
+    if (!cbor.readArrayHead(count, indefinite)) return false;
+
+    for (uint32_t i = 0; indefinite ? !cbor.atBreak() : i < count; i++) {
+        uint32_t items;
+        bool itemsIndefinite;
+        uint32_t start;
+        uint32_t span;
+        if (!cbor.readArrayHead(items, itemsIndefinite) || itemsIndefinite || items < 2 ||
+            (items - 2) % 5 != 0 || !cbor.readUint(start) || !cbor.readUint(span)) {
+            return false;
+        }
+
+        for (uint32_t j = 0; j < (items - 2) / 5; j++) {
+            uint32_t metric;
+            uint32_t samples;
+            float mean;
+            float min;
+            float max;
+            if (!cbor.readUint(metric) || !cbor.readUint(samples) || !cbor.readFloat(mean) ||
+                !cbor.readFloat(min) || !cbor.readFloat(max)) {
+                return false;
+            }
+
+            char extra[96];
+            snprintf(extra, sizeof(extra), ",\"min\":%.7g,\"max\":%.7g,\"samples\":%u,\"interval\":%u",
+                     min, max, samples, span);
+            printPoint(first, deviceId, metric, start, mean, extra);
+        }
+    }
+    return !indefinite || cbor.readBreak();
+}
+
+static bool decodeReadings(CborReader& cbor, const std::string& deviceId, bool& first) {
+    uint32_t count;
+    bool indefinite;
+    if (!cbor.readArrayHead(count, indefinite)) return false;
+
+    for (uint32_t i = 0; indefinite ? !cbor.atBreak() : i < count; i++) {
+        uint32_t items;
+        bool itemsIndefinite;
+        uint32_t timestamp;
+        if (!cbor.readArrayHead(items, itemsIndefinite) || itemsIndefinite || items < 1 ||
+            (items - 1) % 2 != 0 || !cbor.readUint(timestamp)) {
+            return false;
+        }
+
+        for (uint32_t j = 0; j < (items - 1) / 2; j++) {
+            uint32_t metric;
+            float value;
+            if (!cbor.readUint(metric) || !cbor.readFloat(value)) return false;
+            printPoint(first, deviceId, metric, timestamp, value, "");
+        }
+    }
+    return !indefinite || cbor.readBreak();
+}
+
+int main() {
+    std::vector<uint8_t> data;
+    int c;
+    while ((c = getchar()) != EOF) data.push_back(static_cast<uint8_t>(c));
+
+    CborReader cbor(data);
+    uint8_t major;
+    uint32_t entries;
+    bool indefinite;
+    if (!cbor.readHead(major, entries, indefinite) || major != 5) {
+        fprintf(stderr, "Payload is not a CBOR map\n");
+        return 1;
+    }
+
+    std::string deviceId;
+    bool first = true;
+    printf("[");
+
+    for (uint32_t i = 0; indefinite ? !cbor.atBreak() : i < entries; i++) {
+        uint32_t key;
+        uint32_t version;
+        bool ok;
+        if (!cbor.readUint(key)) {
+            ok = false;
+        } else if (key == 0) {
+            ok = cbor.readUint(version) && version == 1;
+        } else if (key == 1) {
+            ok = cbor.readText(deviceId);
+        } else if (key == 2) {
+            ok = decodeBuckets(cbor, deviceId, first);
+        } else if (key == 3) {
+            ok = decodeReadings(cbor, deviceId, first);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "\nMalformed payload at map entry %u\n", i);
+            return 1;
+        }
+    }
+
+    printf("]\n");
+    return 0;
+}
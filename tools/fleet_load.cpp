@@ -0,0 +1,408 @@
+// Replays a fleet of loggers flushing their backlog at the same moment, e.g.
+// when night mode ends, against an ingest endpoint such as
+// tools/ingest_server.cpp. Every virtual device encodes its readings with the
+// firmware's PayloadEncoder (and GzipWriter when compression is configured),
+// sends them with postChunked() in chunks of UPLOAD_CHUNK_READINGS, keeps the
+// connection alive and retries like sendWithRetries(). Plain HTTP only.
+//
+// Build on a Linux host from the repository root:
+//   g++ -std=gnu++11 -O2 -pthread -I sim/include -I include -D WAKE_PROFILER_ENABLED=0 tools/fleet_load.cpp
+//       src/payload_encoder.cpp src/json_writer.cpp src/cbor_writer.cpp src/gzip_writer.cpp
+//       src/checksum.cpp src/http_stream.cpp src/metrics.cpp -o fleet_load
+//   ./fleet_load --url http://127.0.0.1:8080/ingest --devices 300 --readings 500
+//
+// Options:
+//   --url URL             Ingest endpoint, http:// only
+//   --devices N           Virtual devices, one thread each
+//   --readings N          Backlog per device
+//   --points N            Data points per reading (1..10)
+//   --spread-ms N         Devices start uniformly within this window, 0 for all at once
+//   --format json|cbor    Defaults to UPLOAD_FORMAT
+//   --gzip LEVEL          Defaults to UPLOAD_COMPRESSION_LEVEL, 0 disables it
+//   --retry-delay-ms N    Defaults to RETRY_DELAY
+//   --token T             Bearer token sent with every request
+//   --seed N
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#undef INADDR_NONE  // Redefined by the Arduino IPAddress stand-in
+#include "config.hpp"
+#include "gzip_writer.hpp"
+#include "http_stream.hpp"
+#include "payload_encoder.hpp"
+
+// ---- Host stand-ins for the Arduino core calls made by the project code ----
+
+static const std::chrono::steady_clock::time_point startedAt = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startedAt).count();
+}
+
+// Fractional milliseconds for the report
+static double elapsedMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startedAt).count();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+size_t Print::printf(const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    return write(reinterpret_cast<const uint8_t*>(buffer),
+                 length < static_cast<int>(sizeof(buffer)) ? length : sizeof(buffer) - 1);
+}
+
+// Blocking TCP socket behind the Arduino Client interface
+class SocketClient : public Client {
+public:
+    SocketClient() : fd(-1), head(0), tail(0), peerClosed(false) {}
+    ~SocketClient() { stop(); }
+
+    int connect(IPAddress ip, uint16_t port) override {
+        const uint32_t address = ip;
+        char host[16];
+        snprintf(host, sizeof(host), "%u.%u.%u.%u", address & 0xFF, (address >> 8) & 0xFF,
+                 (address >> 16) & 0xFF, address >> 24);
+        return connect(host, port);
+    }
+
+    int connect(const char* host, uint16_t port) override {
+        stop();
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* found = nullptr;
+        char service[8];
+        snprintf(service, sizeof(service), "%u", port);
+        if (getaddrinfo(host, service, &hints, &found) != 0) return 0;
+
+        fd = socket(found->ai_family, found->ai_socktype, found->ai_protocol);
+        const bool connected = fd >= 0 && ::connect(fd, found->ai_addr, found->ai_addrlen) == 0;
+        freeaddrinfo(found);
+        if (!connected) {
+            stop();
+            return 0;
+        }
+        const int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        return 1;
+    }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        size_t sent = 0;
+        while (fd >= 0 && sent < size) {
+            const ssize_t n = send(fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                peerClosed = true;
+                break;
+            }
+            sent += n;
+        }
+        return sent;
+    }
+
+    // Waits up to a millisecond for data, so polling callers do not spin
+    int available() override {
+        if (head == tail && fd >= 0 && !peerClosed) {
+            pollfd waiting = {fd, POLLIN, 0};
+            if (poll(&waiting, 1, 1) > 0) {
+                const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    peerClosed = true;
+                } else {
+                    head = 0;
+                    tail = n;
+                }
+            }
+        }
+        return static_cast<int>(tail - head);
+    }
+
+    int read() override {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+    int read(uint8_t* out, size_t size) override {
+        if (available() <= 0) return -1;
+        const size_t count = std::min(size, tail - head);
+        memcpy(out, buffer + head, count);
+        head += count;
+        return static_cast<int>(count);
+    }
+
+    int peek() override { return available() > 0 ? buffer[head] : -1; }
+    void flush() override {}
+
+    void stop() override {
+        if (fd >= 0) close(fd);
+        fd = -1;
+        head = tail = 0;
+        peerClosed = false;
+    }
+
+    // Like lwIP, unread bytes keep a closed connection readable
+    uint8_t connected() override { return fd >= 0 && (!peerClosed || head < tail); }
+    operator bool() override { return fd >= 0; }
+    using Print::write;
+
+private:
+    int fd;
+    uint8_t buffer[2048];
+    size_t head;
+    size_t tail;
+    bool peerClosed;
+};
+
+// ---- Fleet -----------------------------------------------------------------
+
+struct Options {
+    const char* url = "http://127.0.0.1:8080/ingest";
+    int devices = 100;
+    int readings = 500;
+    int points = 5;
+    unsigned long spreadMs = 0;
+    PayloadFormat format = UPLOAD_FORMAT;
+    int gzipLevel = UPLOAD_COMPRESSION_LEVEL;
+    unsigned long retryDelayMs = RETRY_DELAY;
+    const char* token = "fleet";
+    unsigned seed = 1;
+};
+
+static Options options;
+static ParsedUrl endpoint;
+
+// Default sensor set first, so --points 5 matches the stock build
+static const MetricId FLEET_METRICS[MAX_DATA_POINTS_PER_READING] = {
+    MetricId::SOIL_MOISTURE_RAW, MetricId::SOIL_MOISTURE_PERCENT, MetricId::WIFI_RSSI,
+    MetricId::STORED_READINGS_COUNT, MetricId::STORED_BUCKETS_COUNT, MetricId::TEMPERATURE,
+    MetricId::HUMIDITY, MetricId::PRESSURE, MetricId::GAS, MetricId::BATTERY_VOLTAGE
+};
+
+struct DeviceResult {
+    int chunks = 0;            // Chunks the device tried to deliver
+    int delivered = 0;
+    int requests = 0;          // Including retries and resends
+    int connections = 0;
+    int readingsDelivered = 0;
+    size_t bodyBytes = 0;
+    double flushMs = 0;        // First request to the last response
+    std::vector<double> requestMs;
+    std::map<int, int> statuses;
+};
+
+// One logger's backlog, slowly varying like the real signals
+static std::vector<StoredReading> makeBacklog(int device, std::mt19937& random) {
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    const uint32_t interval = SCHEDULE_WINDOWS[0].intervalSeconds;
+    const time_t end = time(nullptr);
+
+    std::vector<StoredReading> backlog(options.readings);
+    for (int i = 0; i < options.readings; i++) {
+        StoredReading& reading = backlog[i];
+        reading.timestamp = end - static_cast<time_t>(options.readings - i) * interval;
+        reading.numDataPoints = options.points;
+        for (int p = 0; p < options.points; p++) {
+            const float base = 100.0f * (p + 1) + device;
+            reading.dataPoints[p] = {FLEET_METRICS[p], base + 10.0f * sinf(i / 240.0f + p) + noise(random)};
+        }
+    }
+    return backlog;
+}
+
+static void encodeChunk(Print& out, const char* deviceId, const StoredReading* readings, int count) {
+    const auto produce = [&](PayloadEncoder& encoder) {
+        encoder.begin();
+        for (int i = 0; i < count; i++) encoder.writeReading(readings[i]);
+        encoder.end();
+    };
+    if (options.format == PayloadFormat::CBOR) {
+        CborPayloadEncoder encoder(out, deviceId);
+        produce(encoder);
+    } else {
+        JsonPayloadEncoder encoder(out, deviceId);
+        produce(encoder);
+    }
+}
+
+// One POST on the kept connection, resent once on a fresh connection if the
+// server closed the old one, as sendHttpRequest() does
+static int postOnce(SocketClient& client, bool& open, const UploadHeaders& headers,
+                    const BodyWriter& writeBody, DeviceResult& result) {
+    HttpResult http;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        const bool reused = open;
+        if (!open) {
+            result.connections++;
+            open = client.connect(endpoint.host, endpoint.port) == 1;
+            if (!open) return -1;
+        }
+
+        const double start = elapsedMs();
+        postChunked(client, endpoint, headers, writeBody, http);
+        result.requests++;
+        result.requestMs.push_back(elapsedMs() - start);
+        result.bodyBytes += http.bodyBytes;
+
+        open = http.keepAlive;
+        if (!open) client.stop();
+        if (http.status != -1 || !reused) break;
+    }
+    return http.status;
+}
+
+static void runDevice(int index, DeviceResult& result) {
+    std::mt19937 random(options.seed * 7919 + index);
+    char deviceId[24];
+    snprintf(deviceId, sizeof(deviceId), "fleet-%04d", index);
+    const std::vector<StoredReading> backlog = makeBacklog(index, random);
+
+    if (options.spreadMs > 0) {
+        delay(std::uniform_int_distribution<unsigned long>(0, options.spreadMs)(random));
+    }
+
+    GzipWriter compressor;
+    SocketClient client;
+    bool open = false;
+    uint32_t sequence = 0;
+    const double start = elapsedMs();
+
+    for (int first = 0; first < options.readings; first += UPLOAD_CHUNK_READINGS) {
+        const int count = std::min(UPLOAD_CHUNK_READINGS, options.readings - first);
+        const UploadHeaders headers = {
+            getPayloadContentType(options.format), options.gzipLevel > 0 ? "gzip" : nullptr,
+            options.token, deviceId, ++sequence
+        };
+        const BodyWriter writeBody = [&](Print& out) {
+            if (options.gzipLevel <= 0) {
+                encodeChunk(out, deviceId, &backlog[first], count);
+                return;
+            }
+            compressor.begin(out, options.gzipLevel);
+            encodeChunk(compressor, deviceId, &backlog[first], count);
+            compressor.finish();
+        };
+
+        result.chunks++;
+        bool sent = false;
+        for (int retry = 0; retry < MAX_RETRIES && !sent; retry++) {
+            if (retry > 0) delay(options.retryDelayMs);
+            const int status = postOnce(client, open, headers, writeBody, result);
+            result.statuses[status]++;
+            sent = status == 200 || status == 201;
+        }
+
+        // Like the firmware, a chunk that runs out of retries ends the upload
+        if (!sent) break;
+        result.delivered++;
+        result.readingsDelivered += count;
+    }
+    result.flushMs = elapsedMs() - start;
+}
+
+static double percentile(std::vector<double>& values, double fraction) {
+    if (values.empty()) return 0;
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+static bool parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* name = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+
+        if (strcmp(name, "--url") == 0) options.url = value;
+        else if (strcmp(name, "--devices") == 0) options.devices = atoi(value);
+        else if (strcmp(name, "--readings") == 0) options.readings = atoi(value);
+        else if (strcmp(name, "--points") == 0) options.points = atoi(value);
+        else if (strcmp(name, "--spread-ms") == 0) options.spreadMs = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--format") == 0) {
+            if (strcmp(value, "cbor") == 0) options.format = PayloadFormat::CBOR;
+            else if (strcmp(value, "json") == 0) options.format = PayloadFormat::JSON;
+            else return false;
+        }
+        else if (strcmp(name, "--gzip") == 0) options.gzipLevel = atoi(value);
+        else if (strcmp(name, "--retry-delay-ms") == 0) options.retryDelayMs = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--token") == 0) options.token = value;
+        else if (strcmp(name, "--seed") == 0) options.seed = strtoul(value, nullptr, 10);
+        else return false;
+    }
+    return options.devices > 0 && options.readings > 0 &&
+           options.points > 0 && options.points <= MAX_DATA_POINTS_PER_READING;
+}
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv) || !parseUrl(options.url, endpoint) || endpoint.secure) {
+        fprintf(stderr, "usage: %s [--url http://HOST:PORT/PATH] [--devices N] [--readings N] [--points N]\n"
+                        "       [--spread-ms N] [--format json|cbor] [--gzip LEVEL] [--retry-delay-ms N] [--token T] [--seed N]\n",
+                argv[0]);
+        return 2;
+    }
+
+    printf("%d devices x %d readings (%d points) to %s, %s%s, chunks of %d, %d attempts %lu ms apart\n",
+           options.devices, options.readings, options.points, options.url,
+           options.format == PayloadFormat::CBOR ? "cbor" : "json", options.gzipLevel > 0 ? "+gzip" : "",
+           UPLOAD_CHUNK_READINGS, MAX_RETRIES, options.retryDelayMs);
+    fflush(stdout);
+
+    std::vector<DeviceResult> results(options.devices);
+    std::vector<std::thread> devices;
+    const double start = elapsedMs();
+    for (int i = 0; i < options.devices; i++) devices.emplace_back(runDevice, i, std::ref(results[i]));
+    for (std::thread& device : devices) device.join();
+    const double seconds = (elapsedMs() - start) / 1000;
+
+    DeviceResult total;
+    std::vector<double> flushMs;
+    for (const DeviceResult& result : results) {
+        total.chunks += result.chunks;
+        total.delivered += result.delivered;
+        total.requests += result.requests;
+        total.connections += result.connections;
+        total.readingsDelivered += result.readingsDelivered;
+        total.bodyBytes += result.bodyBytes;
+        total.requestMs.insert(total.requestMs.end(), result.requestMs.begin(), result.requestMs.end());
+        for (const auto& status : result.statuses) total.statuses[status.first] += status.second;
+        flushMs.push_back(result.flushMs);
+    }
+
+    const int attemptedChunks = total.chunks;
+    const int backlogChunks = options.devices * ((options.readings + UPLOAD_CHUNK_READINGS - 1) / UPLOAD_CHUNK_READINGS);
+    printf("chunks      %d of %d delivered, %d readings undelivered\n", total.delivered, backlogChunks,
+           options.devices * options.readings - total.readingsDelivered);
+    printf("requests    %d on %d connections, retry amplification %.2f requests per chunk\n",
+           total.requests, total.connections, attemptedChunks > 0 ? static_cast<double>(total.requests) / attemptedChunks : 0.0);
+    printf("throughput  %.1f s, %.0f readings/s, %.1f requests/s, %.2f MB/s of body\n", seconds,
+           total.readingsDelivered / seconds, total.requests / seconds, total.bodyBytes / 1e6 / seconds);
+    printf("request ms  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n", percentile(total.requestMs, 0.5),
+           percentile(total.requestMs, 0.9), percentile(total.requestMs, 0.99), percentile(total.requestMs, 1.0));
+    printf("flush s     p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n", percentile(flushMs, 0.5) / 1000,
+           percentile(flushMs, 0.9) / 1000, percentile(flushMs, 0.99) / 1000, percentile(flushMs, 1.0) / 1000);
+    printf("statuses   ");
+    for (const auto& status : total.statuses) printf(" %d: %d", status.first, status.second);
+    printf("  (-1: no response)\n");
+    return total.delivered == backlogChunks ? 0 : 1;
+}
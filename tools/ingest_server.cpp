@@ -0,0 +1,623 @@
+// Stand-in for the ingest endpoint on a Linux host, for reproducing outages,
+// slow responses and error storms without the cloud service. Speaks plain
+// HTTP/1.1 (no TLS) with Content-Length or chunked bodies and accepts the
+// JSON and CBOR upload schemas (see payload_encoder.hpp), gzip compressed or
+// not. Chunks are deduplicated by X-Device-Id and X-Upload-Sequence.
+//
+// Build on a Linux host from the repository root:
+//   g++ -std=c++11 -O2 -pthread tools/ingest_server.cpp -lz -o ingest_server
+//   ./ingest_server --port 8080 --latency-ms 40 --jitter-ms 100 --error-rate 0.05
+//
+// Point a logger at it with apiEndpoint = "http://<host>:8080/ingest" in
+// auth_config.h, or drive it with tools/fleet_load.cpp.
+//
+// Faults, each drawn per request:
+//   --latency-ms N        Fixed delay before every response
+//   --jitter-ms N         Plus an exponentially distributed delay with this mean
+//   --error-rate P        Answer 503
+//   --drop-rate P         Accept the chunk, then close without answering
+//   --truncate-rate P     Accept the chunk, then close halfway through the response
+//   --reset-rate P        Close halfway through reading the request body
+//   --storm PERIOD:LEN    Answer 503 to everything for LEN of every PERIOD seconds
+//   --capacity N          Requests handled at once, later ones queue (0: unlimited)
+//   --token T             Require "Authorization: Bearer T", 401 otherwise
+//   --report-s N          Seconds between statistics lines, 0 for totals only
+//   --seed N
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Options {
+    int port = 8080;
+    double latencyMs = 0;
+    double jitterMs = 0;
+    double errorRate = 0;
+    double dropRate = 0;
+    double truncateRate = 0;
+    double resetRate = 0;
+    double stormPeriodS = 0;
+    double stormLengthS = 0;
+    int capacity = 0;
+    std::string token;
+    int reportS = 10;
+    unsigned seed = 1;
+};
+
+static Options options;
+static std::atomic<bool> stopping(false);
+static const std::chrono::steady_clock::time_point startedAt = std::chrono::steady_clock::now();
+
+static double secondsSinceStart() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startedAt).count();
+}
+
+// Counters since the start, the reporter prints differences
+struct Stats {
+    std::atomic<uint64_t> connections{0};
+    std::atomic<int> openConnections{0};
+    std::atomic<int> maxOpenConnections{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint64_t> duplicates{0};
+    std::atomic<uint64_t> errors{0};        // 503, injected or storm
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> truncated{0};
+    std::atomic<uint64_t> resets{0};
+    std::atomic<uint64_t> rejected{0};      // 400 and 401
+    std::atomic<uint64_t> dataPoints{0};    // In accepted chunks
+    std::atomic<uint64_t> bodyBytes{0};     // As received, before decompression
+    std::atomic<uint64_t> queuedUs{0};      // Waiting for capacity
+};
+
+static Stats stats;
+
+// ---- Fault injection -------------------------------------------------------
+
+static std::mutex randomMutex;
+static std::mt19937 randomEngine;
+
+static double uniform() {
+    std::lock_guard<std::mutex> lock(randomMutex);
+    return std::uniform_real_distribution<double>(0.0, 1.0)(randomEngine);
+}
+
+static double responseDelayMs() {
+    if (options.jitterMs <= 0) return options.latencyMs;
+    std::lock_guard<std::mutex> lock(randomMutex);
+    return options.latencyMs + std::exponential_distribution<double>(1.0 / options.jitterMs)(randomEngine);
+}
+
+static bool inStorm() {
+    if (options.stormPeriodS <= 0) return false;
+    return fmod(secondsSinceStart(), options.stormPeriodS) < options.stormLengthS;
+}
+
+// Counting semaphore for --capacity
+static std::mutex capacityMutex;
+static std::condition_variable capacityFreed;
+static int busy = 0;
+
+static void acquireCapacity() {
+    if (options.capacity <= 0) return;
+    const auto queuedAt = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(capacityMutex);
+    capacityFreed.wait(lock, [] { return busy < options.capacity; });
+    busy++;
+    stats.queuedUs += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - queuedAt).count();
+}
+
+static void releaseCapacity() {
+    if (options.capacity <= 0) return;
+    std::lock_guard<std::mutex> lock(capacityMutex);
+    busy--;
+    capacityFreed.notify_one();
+}
+
+// ---- Payload validation ----------------------------------------------------
+
+// Walks CBOR items, counting data points in the readings and buckets sections
+class CborCounter {
+public:
+    CborCounter(const std::string& data) : data(data), pos(0) {}
+
+    // Returns the number of data points, -1 if the body is not the upload schema
+    long count() {
+        uint8_t major;
+        uint64_t length;
+        bool indefinite;
+        if (!head(major, length, indefinite) || major != 5 || !indefinite) return -1;
+
+        long points = 0;
+        while (!atBreak()) {
+            uint64_t key;
+            if (!head(major, key, indefinite) || major != 0) return -1;
+            if (key == 2 || key == 3) {
+                // Indefinite array of [time, (id, value...)...] items
+                const long items = countSection(key == 2 ? 5 : 2);
+                if (items < 0) return -1;
+                points += items;
+            } else if (!skip()) {
+                return -1;
+            }
+        }
+        return pos + 1 == data.size() ? points : -1;
+    }
+
+private:
+    bool head(uint8_t& major, uint64_t& value, bool& indefinite) {
+        if (pos >= data.size()) return false;
+        const uint8_t initial = data[pos++];
+        major = initial >> 5;
+        const uint8_t info = initial & 0x1F;
+        indefinite = info == 31;
+        if (info < 24 || indefinite) {
+            value = info;
+            return true;
+        }
+        const int bytes = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : info == 27 ? 8 : -1;
+        if (bytes < 0 || pos + bytes > data.size()) return false;
+        value = 0;
+        for (int i = 0; i < bytes; i++) value = (value << 8) | static_cast<uint8_t>(data[pos++]);
+        return true;
+    }
+
+    bool atBreak() const { return pos < data.size() && static_cast<uint8_t>(data[pos]) == 0xFF; }
+
+    bool skip() {
+        uint8_t major;
+        uint64_t value;
+        bool indefinite;
+        if (!head(major, value, indefinite)) return false;
+
+        switch (major) {
+            case 0: case 1: case 7:
+                return !indefinite || major == 7;
+            case 2: case 3:
+                if (indefinite || pos + value > data.size()) return false;
+                pos += value;
+                return true;
+            case 4: case 5: {
+                const uint64_t items = major == 5 ? value * 2 : value;
+                if (indefinite) {
+                    while (!atBreak()) if (!skip()) return false;
+                    pos++;
+                    return true;
+                }
+                for (uint64_t i = 0; i < items; i++) if (!skip()) return false;
+                return true;
+            }
+            default:
+                return skip();  // Tag, followed by its item
+        }
+    }
+
+    // Items of a section hold a fixed header and then `fields` per data point
+    long countSection(int fields) {
+        uint8_t major;
+        uint64_t length;
+        bool indefinite;
+        if (!head(major, length, indefinite) || major != 4 || !indefinite) return -1;
+
+        long points = 0;
+        while (!atBreak()) {
+            if (!head(major, length, indefinite) || major != 4 || indefinite) return -1;
+            const uint64_t headerFields = fields == 5 ? 2 : 1;
+            if (length < headerFields || (length - headerFields) % fields != 0) return -1;
+            points += (length - headerFields) / fields;
+            for (uint64_t i = 0; i < length; i++) if (!skip()) return -1;
+        }
+        pos++;
+        return points;
+    }
+
+    const std::string& data;
+    size_t pos;
+};
+
+// Objects at depth one of the JSON array, -1 if the body is not an array
+static long countJsonObjects(const std::string& body) {
+    long objects = 0;
+    int depth = 0;
+    bool inString = false;
+    bool started = false;
+
+    for (size_t i = 0; i < body.size(); i++) {
+        const char c = body[i];
+        if (inString) {
+            if (c == '\\') i++;
+            else if (c == '"') inString = false;
+            continue;
+        }
+        switch (c) {
+            case '"': inString = true; break;
+            case '[':
+            case '{':
+                if (depth == 0 && c != '[') return -1;
+                if (depth == 1 && c == '{') objects++;
+                depth++;
+                started = true;
+                break;
+            case ']':
+            case '}':
+                if (--depth < 0) return -1;
+                break;
+            default: break;
+        }
+    }
+    return started && depth == 0 && !inString ? objects : -1;
+}
+
+static bool gunzip(const std::string& in, std::string& out) {
+    z_stream stream = {};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) return false;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    stream.avail_in = in.size();
+
+    char buffer[4096];
+    int result;
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        result = inflate(&stream, Z_NO_FLUSH);
+        out.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (result == Z_OK);
+    inflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
+
+// ---- HTTP ------------------------------------------------------------------
+
+class Connection {
+public:
+    explicit Connection(int fd) : fd(fd), head(0), tail(0) {}
+
+    bool readLine(std::string& line) {
+        line.clear();
+        while (true) {
+            if (head == tail && !fill()) return false;
+            const char c = buffer[head++];
+            if (c == '\n') {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                return true;
+            }
+            if (line.size() > 8192) return false;
+            line += c;
+        }
+    }
+
+    bool readBytes(std::string& out, size_t count) {
+        while (count > 0) {
+            if (head == tail && !fill()) return false;
+            const size_t take = std::min(count, tail - head);
+            out.append(buffer + head, take);
+            head += take;
+            count -= take;
+        }
+        return true;
+    }
+
+    bool send(const std::string& text) {
+        size_t sent = 0;
+        while (sent < text.size()) {
+            const ssize_t n = ::send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            sent += n;
+        }
+        return true;
+    }
+
+private:
+    bool fill() {
+        const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) return false;
+        head = 0;
+        tail = n;
+        return true;
+    }
+
+    int fd;
+    char buffer[4096];
+    size_t head;
+    size_t tail;
+};
+
+struct Request {
+    std::string method;
+    std::string contentType;
+    std::string contentEncoding;
+    std::string authorization;
+    std::string deviceId;
+    bool hasSequence = false;
+    uint32_t sequence = 0;
+    bool chunked = false;
+    long contentLength = 0;
+    bool keepAlive = true;
+    std::string body;
+};
+
+static bool readHeaders(Connection& connection, Request& request) {
+    std::string line;
+    if (!connection.readLine(line)) return false;
+    if (line.empty() && !connection.readLine(line)) return false;  // Stray CRLF between requests
+
+    char method[16];
+    int minor = 1;
+    if (sscanf(line.c_str(), "%15s %*s HTTP/1.%d", method, &minor) != 2) return false;
+    request.method = method;
+    request.keepAlive = minor >= 1;
+
+    while (connection.readLine(line)) {
+        if (line.empty()) return true;
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        const std::string name = line.substr(0, colon);
+        size_t start = colon + 1;
+        while (start < line.size() && line[start] == ' ') start++;
+        const std::string value = line.substr(start);
+
+        if (strcasecmp(name.c_str(), "Content-Length") == 0) request.contentLength = atol(value.c_str());
+        else if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0) request.chunked = value.find("chunked") != std::string::npos;
+        else if (strcasecmp(name.c_str(), "Connection") == 0) request.keepAlive = strcasecmp(value.c_str(), "close") != 0;
+        else if (strcasecmp(name.c_str(), "Content-Type") == 0) request.contentType = value;
+        else if (strcasecmp(name.c_str(), "Content-Encoding") == 0) request.contentEncoding = value;
+        else if (strcasecmp(name.c_str(), "Authorization") == 0) request.authorization = value;
+        else if (strcasecmp(name.c_str(), "X-Device-Id") == 0) request.deviceId = value;
+        else if (strcasecmp(name.c_str(), "X-Upload-Sequence") == 0) {
+            request.hasSequence = true;
+            request.sequence = strtoul(value.c_str(), nullptr, 10);
+        }
+    }
+    return false;
+}
+
+// Reads the body; with reset set, gives up halfway as if the connection broke
+static bool readBody(Connection& connection, Request& request, bool reset) {
+    if (!request.chunked) {
+        if (reset) {
+            connection.readBytes(request.body, request.contentLength / 2);
+            return false;
+        }
+        return connection.readBytes(request.body, request.contentLength);
+    }
+
+    std::string line;
+    while (connection.readLine(line)) {
+        const size_t size = strtoul(line.c_str(), nullptr, 16);
+        if (size == 0) {
+            while (connection.readLine(line)) if (line.empty()) return true;
+            return false;
+        }
+        if (reset && request.body.size() > 0) return false;
+        if (!connection.readBytes(request.body, size) || !connection.readLine(line)) return false;
+    }
+    return false;
+}
+
+static std::mutex acceptedMutex;
+static std::map<std::string, std::set<uint32_t>> acceptedChunks;
+
+// Commits the chunk, false if it had been accepted before
+static bool commitChunk(const Request& request) {
+    if (!request.hasSequence) return true;
+    std::lock_guard<std::mutex> lock(acceptedMutex);
+    return acceptedChunks[request.deviceId].insert(request.sequence).second;
+}
+
+static std::string response(int status, const char* reason, bool keepAlive) {
+    char text[160];
+    snprintf(text, sizeof(text), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n",
+             status, reason, keepAlive ? "keep-alive" : "close");
+    return text;
+}
+
+static long countDataPoints(const Request& request) {
+    std::string decoded;
+    const std::string* body = &request.body;
+    if (strcasecmp(request.contentEncoding.c_str(), "gzip") == 0) {
+        if (!gunzip(request.body, decoded)) return -1;
+        body = &decoded;
+    }
+    if (request.contentType.find("cbor") != std::string::npos) return CborCounter(*body).count();
+    return countJsonObjects(*body);
+}
+
+// Serves requests on one connection until either side closes it
+static void serve(int fd) {
+    Connection connection(fd);
+    stats.connections++;
+    const int open = ++stats.openConnections;
+    int seen = stats.maxOpenConnections;
+    while (open > seen && !stats.maxOpenConnections.compare_exchange_weak(seen, open)) {}
+
+    while (!stopping) {
+        Request request;
+        if (!readHeaders(connection, request)) break;
+
+        const bool reset = uniform() < options.resetRate;
+        if (!readBody(connection, request, reset)) {
+            if (reset) stats.resets++;
+            break;
+        }
+        stats.requests++;
+        stats.bodyBytes += request.body.size();
+
+        acquireCapacity();
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(responseDelayMs()));
+
+        std::string answer;
+        bool close = !request.keepAlive;
+        bool truncate = false;
+        const long points = countDataPoints(request);
+
+        if (!options.token.empty() && request.authorization != "Bearer " + options.token) {
+            stats.rejected++;
+            answer = response(401, "Unauthorized", !close);
+        } else if (request.method != "POST" || points < 0) {
+            stats.rejected++;
+            answer = response(400, "Bad Request", !close);
+        } else if (inStorm() || uniform() < options.errorRate) {
+            stats.errors++;
+            answer = response(503, "Service Unavailable", !close);
+        } else {
+            // The chunk is stored before the answer can get lost
+            if (commitChunk(request)) {
+                stats.accepted++;
+                stats.dataPoints += points;
+            } else {
+                stats.duplicates++;
+            }
+            answer = response(200, "OK", !close);
+
+            if (uniform() < options.dropRate) {
+                stats.dropped++;
+                answer.clear();
+                close = true;
+            } else if (uniform() < options.truncateRate) {
+                stats.truncated++;
+                truncate = true;
+                close = true;
+            }
+        }
+        releaseCapacity();
+
+        if (truncate) answer.resize(answer.size() / 2);
+        if (!answer.empty() && !connection.send(answer)) break;
+        if (close) break;
+    }
+
+    stats.openConnections--;
+    ::close(fd);
+}
+
+// ---- Main ------------------------------------------------------------------
+
+static void printStats(const char* label, double seconds, uint64_t requests) {
+    printf("%-8s %7.1f s  open %4d (max %4d)  conns %7llu  reqs %8llu (%7.1f/s)  ok %8llu  dup %6llu  "
+           "503 %6llu  drop %5llu  trunc %5llu  reset %5llu  bad %4llu  points %9llu  body %8.2f MB  "
+           "queued %.1f s\n",
+           label, secondsSinceStart(), stats.openConnections.load(), stats.maxOpenConnections.load(),
+           (unsigned long long)stats.connections, (unsigned long long)stats.requests,
+           seconds > 0 ? requests / seconds : 0.0, (unsigned long long)stats.accepted,
+           (unsigned long long)stats.duplicates, (unsigned long long)stats.errors,
+           (unsigned long long)stats.dropped, (unsigned long long)stats.truncated,
+           (unsigned long long)stats.resets, (unsigned long long)stats.rejected,
+           (unsigned long long)stats.dataPoints, stats.bodyBytes / 1e6, stats.queuedUs / 1e6);
+    fflush(stdout);
+}
+
+static void reporter() {
+    uint64_t lastRequests = 0;
+    double last = 0;
+    while (!stopping) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        const double now = secondsSinceStart();
+        if (now - last < options.reportS) continue;
+        const uint64_t requests = stats.requests;
+        printStats("interval", now - last, requests - lastRequests);
+        lastRequests = requests;
+        last = now;
+    }
+}
+
+static bool parseRate(const char* text, double& rate) {
+    rate = atof(text);
+    return rate >= 0 && rate <= 1;
+}
+
+static bool parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* name = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+
+        if (strcmp(name, "--port") == 0) options.port = atoi(value);
+        else if (strcmp(name, "--latency-ms") == 0) options.latencyMs = atof(value);
+        else if (strcmp(name, "--jitter-ms") == 0) options.jitterMs = atof(value);
+        else if (strcmp(name, "--error-rate") == 0) { if (!parseRate(value, options.errorRate)) return false; }
+        else if (strcmp(name, "--drop-rate") == 0) { if (!parseRate(value, options.dropRate)) return false; }
+        else if (strcmp(name, "--truncate-rate") == 0) { if (!parseRate(value, options.truncateRate)) return false; }
+        else if (strcmp(name, "--reset-rate") == 0) { if (!parseRate(value, options.resetRate)) return false; }
+        else if (strcmp(name, "--storm") == 0) {
+            if (sscanf(value, "%lf:%lf", &options.stormPeriodS, &options.stormLengthS) != 2) return false;
+        }
+        else if (strcmp(name, "--capacity") == 0) options.capacity = atoi(value);
+        else if (strcmp(name, "--token") == 0) options.token = value;
+        else if (strcmp(name, "--report-s") == 0) options.reportS = atoi(value);
+        else if (strcmp(name, "--seed") == 0) options.seed = strtoul(value, nullptr, 10);
+        else return false;
+    }
+    return true;
+}
+
+static void onSignal(int) {
+    stopping = true;
+}
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv)) {
+        fprintf(stderr, "usage: %s [--port N] [--latency-ms N] [--jitter-ms N] [--error-rate P] [--drop-rate P]\n"
+                        "       [--truncate-rate P] [--reset-rate P] [--storm PERIOD:LEN] [--capacity N]\n"
+                        "       [--token T] [--report-s N] [--seed N]\n", argv[0]);
+        return 2;
+    }
+    randomEngine.seed(options.seed);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    const int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(options.port);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 1024) != 0) {
+        perror("listen");
+        return 1;
+    }
+    printf("Ingest stand-in listening on port %d\n", options.port);
+    fflush(stdout);
+
+    std::thread report;
+    if (options.reportS > 0) report = std::thread(reporter);
+
+    while (!stopping) {
+        pollfd waiting = {listener, POLLIN, 0};
+        if (poll(&waiting, 1, 200) <= 0) continue;
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        // Idle keep-alive connections are closed after a while, like a real endpoint
+        timeval idle = {30, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+        std::thread(serve, fd).detach();
+    }
+
+    if (report.joinable()) report.join();
+    close(listener);
+    printStats("total", secondsSinceStart(), stats.requests);
+    return 0;
+}